@@ -0,0 +1,5 @@
+DEPENDENCIES += tp_utils
+DEPENDENCIES += lib_glm
+
+INCLUDEPATHS += general_performance_stats_viewer/inc/
+INCLUDEPATHS += general_performance_stats_viewer/benchmark/inc/
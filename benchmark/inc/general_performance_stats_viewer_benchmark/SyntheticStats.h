@@ -0,0 +1,31 @@
+#ifndef general_performance_stats_viewer_benchmark_SyntheticStats_h
+#define general_performance_stats_viewer_benchmark_SyntheticStats_h
+
+#include <cstdint>
+#include <string>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+struct SyntheticStatsParams
+{
+  size_t traceCount{100};  //!< The number of distinct traces.
+  size_t sampleCount{1000};//!< The number of separator delimited blocks.
+  size_t nameLength{32};   //!< The length of each trace name in characters.
+  uint32_t seed{1};
+};
+
+//##################################################################################################
+//! Write a stats file in the format produced by tp_utils::KeyValueLogStatsTimer.
+/*!
+Each sample writes a separator followed by a value for every trace. Values are a random walk with
+occasional spikes so that the LOD pyramid has something to preserve.
+
+\return The number of bytes written or 0 on failure.
+*/
+size_t writeSyntheticStats(const std::string& path, const SyntheticStatsParams& params);
+
+}
+
+#endif
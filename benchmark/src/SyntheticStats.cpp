@@ -0,0 +1,78 @@
+#include "general_performance_stats_viewer_benchmark/SyntheticStats.h"
+
+#include "general_performance_stats_viewer/StatsParser.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//##################################################################################################
+std::string traceName(size_t t, size_t nameLength)
+{
+  std::string name = "trace_" + std::to_string(t) + "_";
+  while(name.size()<nameLength)
+    name.push_back(char('a' + (name.size()+t) % 26));
+  return name;
+}
+}
+
+//##################################################################################################
+size_t writeSyntheticStats(const std::string& path, const SyntheticStatsParams& params)
+{
+  std::ofstream out(path, std::ios::binary|std::ios::trunc);
+  if(!out)
+    return 0;
+
+  std::vector<std::string> prefixes(params.traceCount);
+  for(size_t t=0; t<params.traceCount; t++)
+    prefixes.at(t) = std::string(statsLineStart) + traceName(t, params.nameLength) + std::string(statsDelimiter);
+
+  std::string separator = std::string(statsLineStart) + std::string(statsSeparator) + std::string(statsLineEnd) + '\n';
+
+  std::mt19937 rng(params.seed);
+  std::uniform_int_distribution<int64_t> step(-50, 50);
+  std::uniform_int_distribution<int> spike(0, 999);
+  std::vector<int64_t> values(params.traceCount);
+  for(auto& value : values)
+    value = std::uniform_int_distribution<int64_t>(100, 10000)(rng);
+
+  //Lines are batched into a buffer to keep the stream overhead out of large runs.
+  std::string buffer;
+  buffer.reserve(1<<20);
+  size_t written=0;
+  auto flush = [&]
+  {
+    out.write(buffer.data(), std::streamsize(buffer.size()));
+    written += buffer.size();
+    buffer.clear();
+  };
+
+  for(size_t s=0; s<params.sampleCount; s++)
+  {
+    buffer += separator;
+    for(size_t t=0; t<params.traceCount; t++)
+    {
+      auto& value = values.at(t);
+      value = std::max(int64_t(0), value + step(rng));
+
+      buffer += prefixes.at(t);
+      buffer += std::to_string(spike(rng)==0?value*10:value);
+      buffer += statsLineEnd;
+      buffer += '\n';
+    }
+
+    if(buffer.size()>=(1<<20))
+      flush();
+  }
+
+  flush();
+  return out?written:0;
+}
+
+}
@@ -0,0 +1,449 @@
+#include "general_performance_stats_viewer_benchmark/SyntheticStats.h"
+
+#include "general_performance_stats_viewer/MappedFile.h"
+#include "general_performance_stats_viewer/StatsLoader.h"
+#include "general_performance_stats_viewer/TraceCache.h"
+#include "general_performance_stats_viewer/TraceExpression.h"
+#include "general_performance_stats_viewer/TraceGeometry.h"
+#include "general_performance_stats_viewer/TraceRangeMax.h"
+#include "general_performance_stats_viewer/TraceStats.h"
+#include "general_performance_stats_viewer/Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+using namespace general_performance_stats_viewer;
+
+namespace
+{
+
+//##################################################################################################
+size_t peakRSS()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return size_t(counters.PeakWorkingSetSize);
+  return 0;
+#else
+  rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage)!=0)
+    return 0;
+#  ifdef __APPLE__
+  return size_t(usage.ru_maxrss);
+#  else
+  return size_t(usage.ru_maxrss) * 1024;
+#  endif
+#endif
+}
+
+//##################################################################################################
+//! Times a stage and prints it when it goes out of scope.
+struct Stage_lt
+{
+  const char* name;
+  std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+
+  //################################################################################################
+  Stage_lt(const char* name_):
+    name(name_)
+  {
+
+  }
+
+  //################################################################################################
+  double seconds() const
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  //################################################################################################
+  ~Stage_lt()
+  {
+    std::printf("%-20s %10.3f ms\n", name, seconds()*1000.0);
+  }
+};
+
+//##################################################################################################
+//! Build the vertices of every trace for a view, as the viewer does when the view changes.
+size_t prepareGeometry(const TraceStore& store, const std::vector<TraceLOD>& lods, double viewFirst, double viewLast, size_t width)
+{
+  float xScale = 8.0f / float(std::max(size_t(1), store.sampleCount()));
+  double samplesPerPixel = (viewLast - viewFirst) / double(std::max(size_t(1), width));
+
+  std::vector<TraceVertex> vertices;
+  SampleBuffer buffer;
+  size_t vertexCount=0;
+  for(TraceID t=0; t<store.traceCount(); t++)
+  {
+    const auto& trace = store.trace(t);
+    auto view = traceViewSamples(trace, lods.at(t), viewFirst, viewLast, samplesPerPixel, buffer);
+    buildTraceVertices(view.samples, xScale, 1.0f / float(trace.maxValue), float(t), vertices);
+    vertexCount += vertices.size();
+  }
+  return vertexCount;
+}
+
+//##################################################################################################
+//! Build the vertices of every full trace with a kernel, returning the vertices per second.
+/*!
+Only the kernel is timed, not decoding the samples.
+*/
+template<typename Kernel>
+double vertexThroughput(const TraceStore& store, std::vector<TraceVertex>& vertices, Kernel kernel)
+{
+  SampleBuffer buffer;
+  size_t vertexCount=0;
+  double seconds=0.0;
+  for(TraceID t=0; t<store.traceCount(); t++)
+  {
+    const auto& trace = store.trace(t);
+    auto samples = trace.samples(buffer);
+
+    auto start = std::chrono::steady_clock::now();
+    kernel(samples, 8.0f / float(std::max(size_t(1), store.sampleCount())), 1.0f / float(trace.maxValue), float(t), vertices);
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    vertexCount += vertices.size();
+  }
+  return double(vertexCount) / std::max(1e-9, seconds);
+}
+
+//##################################################################################################
+//! Compare the vertex kernel with the scalar reference on the loaded traces.
+bool benchmarkVertexKernel(const TraceStore& store)
+{
+  std::vector<TraceVertex> scalar;
+  std::vector<TraceVertex> simd;
+  SampleBuffer buffer;
+
+  //Warm up and check that both give identical vertices.
+  for(TraceID t=0; t<store.traceCount(); t++)
+  {
+    const auto& trace = store.trace(t);
+    auto samples = trace.samples(buffer);
+    buildTraceVerticesScalar(samples, 0.5f, 1.0f / float(trace.maxValue), float(t), scalar);
+    buildTraceVertices(samples, 0.5f, 1.0f / float(trace.maxValue), float(t), simd);
+    if(scalar.size()!=simd.size() || std::memcmp(scalar.data(), simd.data(), scalar.size()*sizeof(TraceVertex))!=0)
+    {
+      std::cerr << "Vertex kernel mismatch in trace: " << trace.name << std::endl;
+      return false;
+    }
+  }
+
+  double scalarRate = vertexThroughput(store, scalar, buildTraceVerticesScalar);
+  double simdRate = vertexThroughput(store, simd, [](auto samples, float xScale, float yScale, float trace, auto& vertices)
+  {
+    buildTraceVertices(samples, xScale, yScale, trace, vertices);
+  });
+  std::printf("vertices scalar M/s  %10.1f\n", scalarRate / 1e6);
+  std::printf("vertices kernel M/s  %10.1f\n", simdRate / 1e6);
+  return true;
+}
+
+//##################################################################################################
+void printUsage()
+{
+  std::cout <<
+    "Usage: general_performance_stats_viewer_benchmark [options] <stats file>\n"
+    "\n"
+    "Runs the load and geometry stages of the viewer on a stats file and reports timings.\n"
+    "\n"
+    "  --generate           Write a synthetic stats file to <stats file> first.\n"
+    "  --traces <n>         Number of traces to generate (default 100).\n"
+    "  --samples <n>        Number of samples to generate (default 1000).\n"
+    "  --name-length <n>    Length of generated trace names (default 32).\n"
+    "  --threads <n>        Worker threads, 0 for one per core (default 0).\n"
+    "  --width <n>          Width of the view in pixels (default 1920).\n"
+    "  --cache              Also time writing and reading the binary cache.\n"
+    "  --paged-budget <n>   MB of the cache kept resident when it is paged (default 16).\n";
+}
+
+}
+
+//##################################################################################################
+int main(int argc, char* argv[])
+{
+  std::string path;
+  bool generate=false;
+  bool cache=false;
+  SyntheticStatsParams params;
+  size_t threadCount=0;
+  size_t width=1920;
+  size_t pagedBudget=16;
+
+  for(int i=1; i<argc; i++)
+  {
+    auto arg = argv[i];
+    auto next = [&]
+    {
+      if(i+1>=argc)
+      {
+        std::cerr << "Missing value for: " << arg << std::endl;
+        std::exit(1);
+      }
+      return size_t(std::stoull(argv[++i]));
+    };
+
+    if(std::strcmp(arg, "--generate")==0)
+      generate = true;
+    else if(std::strcmp(arg, "--cache")==0)
+      cache = true;
+    else if(std::strcmp(arg, "--traces")==0)
+      params.traceCount = next();
+    else if(std::strcmp(arg, "--samples")==0)
+      params.sampleCount = next();
+    else if(std::strcmp(arg, "--name-length")==0)
+      params.nameLength = next();
+    else if(std::strcmp(arg, "--threads")==0)
+      threadCount = next();
+    else if(std::strcmp(arg, "--width")==0)
+      width = next();
+    else if(std::strcmp(arg, "--paged-budget")==0)
+      pagedBudget = next();
+    else if(std::strcmp(arg, "--help")==0)
+    {
+      printUsage();
+      return 0;
+    }
+    else if(arg[0]=='-' || !path.empty())
+    {
+      printUsage();
+      return 1;
+    }
+    else
+      path = arg;
+  }
+
+  if(path.empty())
+  {
+    printUsage();
+    return 1;
+  }
+
+  if(generate)
+  {
+    Stage_lt stage("generate");
+    if(!writeSyntheticStats(path, params))
+    {
+      std::cerr << "Failed to write: " << path << std::endl;
+      return 1;
+    }
+  }
+
+  std::printf("threads              %10zu\n", threadCount?threadCount:defaultThreadCount());
+
+  TraceStore store;
+  std::vector<TraceLOD> lods;
+  size_t bytes=0;
+  double parseSeconds=0.0;
+  double totalSeconds=0.0;
+
+  {
+    Stage_lt total("load");
+    MappedFile file(path);
+    if(!file.isOpen())
+    {
+      std::cerr << "Failed to open: " << path << std::endl;
+      return 1;
+    }
+    bytes = file.size();
+
+    {
+      Stage_lt stage("  parse");
+      if(!loadStats(file.view(), store, threadCount))
+      {
+        std::cerr << "Failed to load: " << path << std::endl;
+        return 1;
+      }
+      parseSeconds = stage.seconds();
+    }
+
+    {
+      Stage_lt stage("  lod");
+      lods.resize(store.traceCount());
+      parallelFor(lods.size(), [&](size_t t)
+      {
+        lods.at(t).update(store.trace(TraceID(t)));
+      }, threadCount);
+    }
+
+    totalSeconds = total.seconds();
+  }
+
+  double decodeSeconds=0.0;
+  {
+    Stage_lt stage("decode");
+    std::vector<uint64_t> sums(store.traceCount(), 0);
+    parallelFor(sums.size(), [&](size_t t)
+    {
+      SampleBuffer buffer;
+      const auto& trace = store.trace(TraceID(t));
+      trace.forEachSpan(0, trace.size(), buffer, [&](const SampleSpan& span)
+      {
+        for(size_t p=0; p<span.size; p++)
+          sums.at(t) += span.values[p];
+      });
+    }, threadCount);
+    decodeSeconds = stage.seconds();
+  }
+
+  {
+    Stage_lt stage("geometry overview");
+    double last = double(store.sampleCount());
+    prepareGeometry(store, lods, 0.0, last, width);
+  }
+
+  {
+    Stage_lt stage("geometry zoomed");
+    double middle = double(store.sampleCount()) / 2.0;
+    double half = std::max(1.0, double(store.sampleCount()) / 64.0);
+    prepareGeometry(store, lods, middle-half, middle+half, width);
+  }
+
+  {
+    std::vector<TraceRangeMax> rangeMaxes(store.traceCount());
+    {
+      Stage_lt stage("range max build");
+      parallelFor(rangeMaxes.size(), [&](size_t t)
+      {
+        rangeMaxes.at(t).update(store.trace(TraceID(t)));
+      }, threadCount);
+    }
+
+    //One autoscale of every trace per frame while zooming in on the middle.
+    Stage_lt stage("autoscale 100 views");
+    uint64_t globalMax=0;
+    double middle = double(store.sampleCount()) / 2.0;
+    for(size_t f=0; f<100; f++)
+    {
+      double half = std::max(1.0, middle / double(f+1));
+      for(TraceID t=0; t<store.traceCount(); t++)
+        globalMax = std::max(globalMax, rangeMaxes.at(t).max(store.trace(t), uint64_t(middle-half), uint64_t(middle+half)));
+    }
+
+    if(globalMax>store.maxValue())
+    {
+      std::cerr << "Range max exceeds the max of the store." << std::endl;
+      return 1;
+    }
+  }
+
+  {
+    Stage_lt stage("stats");
+    std::vector<TraceStats> stats(store.traceCount());
+    parallelFor(stats.size(), [&](size_t t)
+    {
+      const auto& trace = store.trace(TraceID(t));
+      stats.at(t) = computeTraceStats(trace, 0, trace.size());
+    }, threadCount);
+  }
+
+  if(!benchmarkVertexKernel(store))
+    return 1;
+
+  if(cache)
+  {
+    {
+      Stage_lt stage("cache write");
+      if(!writeTraceCache(path, store, lods, bytes))
+        std::cerr << "Failed to write cache." << std::endl;
+    }
+
+    {
+      Stage_lt stage("cache read");
+      TraceStore cachedStore;
+      std::vector<TraceLOD> cachedLODs;
+      size_t parsedBytes=0;
+      if(!readTraceCache(path, cachedStore, cachedLODs, parsedBytes))
+        std::cerr << "Failed to read cache." << std::endl;
+    }
+
+    TraceStore pagedStore;
+    std::vector<TraceLOD> pagedLODs;
+    {
+      Stage_lt stage("cache paged read");
+      size_t parsedBytes=0;
+      if(!readTraceCache(path, pagedStore, pagedLODs, parsedBytes, std::max(size_t(1), pagedBudget)<<20))
+      {
+        std::cerr << "Failed to read cache." << std::endl;
+        return 1;
+      }
+    }
+
+    //Pan a zoomed view across the capture, trimming to the budget after each view like the viewer.
+    {
+      Stage_lt stage("paged pan 100 views");
+      double half = std::max(1.0, double(store.sampleCount()) / 64.0);
+      for(size_t f=0; f<100; f++)
+      {
+        double middle = double(store.sampleCount()) * (double(f)+0.5) / 100.0;
+        size_t paged = prepareGeometry(pagedStore, pagedLODs, middle-half, middle+half, width);
+        pagedStore.pagedFile()->trim();
+
+        if(f%10==0 && paged!=prepareGeometry(store, lods, middle-half, middle+half, width))
+        {
+          std::cerr << "Paged geometry differs from the geometry in memory." << std::endl;
+          return 1;
+        }
+      }
+    }
+
+    auto paged = pagedStore.pagedFile()->stats();
+    std::printf("paged file MB        %10.1f\n", double(paged.fileBytes) / double(1<<20));
+    std::printf("paged resident MB    %10.1f\n", double(paged.residentBytes) / double(1<<20));
+    std::printf("paged evicted MB     %10.1f\n", double(paged.evictedBytes) / double(1<<20));
+  }
+
+  //Adds a derived trace to the store so it runs after the stages that expect only parsed traces.
+  size_t traceCount = store.traceCount();
+  double derivedSeconds=0.0;
+  {
+    Stage_lt stage("derived sum of all");
+    TraceExpression expression("sum(matching \".*\")");
+    expression.update(store);
+    derivedSeconds = stage.seconds();
+
+    if(store.sampleCount() && store.trace(expression.traceID()).size()==0)
+    {
+      std::cerr << "Derived trace is empty." << std::endl;
+      return 1;
+    }
+  }
+
+  double mb = double(bytes) / double(1<<20);
+  double points = double(store.pointCount());
+  std::printf("bytes                %10zu\n", bytes);
+  std::printf("traces               %10zu\n", traceCount);
+  std::printf("samples              %10zu\n", store.sampleCount());
+  std::printf("points               %10zu\n", store.pointCount());
+  std::printf("parse MB/s           %10.1f\n", mb / std::max(1e-9, parseSeconds));
+  std::printf("parse points/s       %10.0f\n", points / std::max(1e-9, parseSeconds));
+  std::printf("load MB/s            %10.1f\n", mb / std::max(1e-9, totalSeconds));
+  std::printf("decode points/s      %10.0f\n", points / std::max(1e-9, decodeSeconds));
+  std::printf("derived points/s     %10.0f\n", points / std::max(1e-9, derivedSeconds));
+  auto memory = store.memoryStats();
+  size_t lodBytes=0;
+  for(const auto& lod : lods)
+    for(const auto& level : lod.levels)
+      lodBytes += level.samples.encoded.capacity() + level.samples.blocks.capacity()*sizeof(SampleBlock);
+  std::printf("store MB             %10.1f\n", double(memory.reservedBytes) / double(1<<20));
+  std::printf("store bytes/point    %10.2f\n", double(memory.allocatedBytes) / std::max(1.0, points));
+  std::printf("lod MB               %10.1f\n", double(lodBytes) / double(1<<20));
+  std::printf("store abandoned MB   %10.1f\n", double(memory.abandonedBytes) / double(1<<20));
+  std::printf("store allocations    %10zu\n", memory.allocationCount);
+  std::printf("peak RSS MB          %10.1f\n", double(peakRSS()) / double(1<<20));
+
+  return 0;
+}
@@ -0,0 +1,26 @@
+TARGET = general_performance_stats_viewer_benchmark
+TEMPLATE = app
+CONFIG += console
+
+SOURCES += src/main.cpp
+
+HEADERS += inc/general_performance_stats_viewer_benchmark/SyntheticStats.h
+SOURCES += src/SyntheticStats.cpp
+
+#The headless stages are built from the sources of the viewer.
+SOURCES += ../src/Globals.cpp
+SOURCES += ../src/MappedFile.cpp
+SOURCES += ../src/PagedFile.cpp
+SOURCES += ../src/StatsParser.cpp
+SOURCES += ../src/SampleTimes.cpp
+SOURCES += ../src/Parallel.cpp
+SOURCES += ../src/StatsLoader.cpp
+SOURCES += ../src/Arena.cpp
+SOURCES += ../src/SampleCodec.cpp
+SOURCES += ../src/TraceStore.cpp
+SOURCES += ../src/TraceLOD.cpp
+SOURCES += ../src/TraceCache.cpp
+SOURCES += ../src/TraceGeometry.cpp
+SOURCES += ../src/TraceStats.cpp
+SOURCES += ../src/TraceRangeMax.cpp
+SOURCES += ../src/TraceExpression.cpp
@@ -0,0 +1,4 @@
+DEPENDENCIES += tp_utils
+
+INCLUDEPATHS += general_performance_stats_viewer/inc/
+INCLUDEPATHS += general_performance_stats_viewer/checks/inc/
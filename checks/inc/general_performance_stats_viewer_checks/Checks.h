@@ -0,0 +1,86 @@
+#ifndef general_performance_stats_viewer_checks_Checks_h
+#define general_performance_stats_viewer_checks_Checks_h
+
+#include "general_performance_stats_viewer/TraceStore.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! The values written before each separator of a stats file, see writeStatsFile().
+using StatsSample = std::vector<std::pair<std::string, uint64_t>>;
+
+//##################################################################################################
+//! Counts the checks that were made and prints the ones that failed.
+/*!
+Files written by the checks go in a temporary directory that is removed with the Checks.
+*/
+class Checks
+{
+  TP_NONCOPYABLE(Checks);
+public:
+  //################################################################################################
+  Checks();
+
+  //################################################################################################
+  ~Checks();
+
+  //################################################################################################
+  //! Count a check, printing what if it failed.
+  bool check(bool ok, const std::string& what);
+
+  //################################################################################################
+  size_t count() const;
+
+  //################################################################################################
+  size_t failures() const;
+
+  //################################################################################################
+  //! The path of name in the temporary directory.
+  std::string path(const std::string& name) const;
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+//##################################################################################################
+//! Write a stats file holding samples, each sample is followed by a separator.
+/*!
+The values of sample N therefore have the index N. If times is true each line is prefixed with a
+timestamp, N seconds past midnight for sample N.
+
+\return false if the file could not be written.
+*/
+bool writeStatsFile(const std::string& path, const std::vector<StatsSample>& samples, bool times=false);
+
+//##################################################################################################
+//! The samples of a trace as index value pairs, empty if the store has no trace called name.
+std::vector<std::pair<uint32_t, uint64_t>> traceSamples(const TraceStore& store, std::string_view name);
+
+//##################################################################################################
+//! Loading several files with loadStatsFiles() in each StatsMergeMode.
+void checkStatsMerge(Checks& checks);
+
+//##################################################################################################
+//! Round trips through encodeSampleBlock() and the Trace that is built on it.
+void checkSampleCodec(Checks& checks);
+
+//##################################################################################################
+//! Round trips through the cache, in memory and paged, and the rejection of stale caches.
+void checkTraceCache(Checks& checks);
+
+//##################################################################################################
+//! Parsing, evaluating and updating derived traces.
+void checkTraceExpression(Checks& checks);
+
+}
+
+#endif
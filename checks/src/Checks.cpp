@@ -0,0 +1,122 @@
+#include "general_performance_stats_viewer_checks/Checks.h"
+
+#include "general_performance_stats_viewer/StatsParser.h"
+
+#include "tp_utils/RefCount.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+struct Checks::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::Checks::Private");
+  TP_NONCOPYABLE(Private);
+
+  size_t count{0};
+  size_t failures{0};
+  std::filesystem::path directory;
+
+  //################################################################################################
+  Private()
+  {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    directory = std::filesystem::temp_directory_path() / ("gpsv_checks_" + std::to_string(now));
+    std::filesystem::create_directories(directory);
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+  }
+};
+
+//##################################################################################################
+Checks::Checks():
+  d(new Private())
+{
+
+}
+
+//##################################################################################################
+Checks::~Checks()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool Checks::check(bool ok, const std::string& what)
+{
+  d->count++;
+  if(!ok)
+  {
+    d->failures++;
+    std::cerr << "Failed: " << what << std::endl;
+  }
+  return ok;
+}
+
+//##################################################################################################
+size_t Checks::count() const
+{
+  return d->count;
+}
+
+//##################################################################################################
+size_t Checks::failures() const
+{
+  return d->failures;
+}
+
+//##################################################################################################
+std::string Checks::path(const std::string& name) const
+{
+  return (d->directory / name).string();
+}
+
+//##################################################################################################
+bool writeStatsFile(const std::string& path, const std::vector<StatsSample>& samples, bool times)
+{
+  std::ofstream out(path, std::ios::binary);
+  if(!out)
+    return false;
+
+  char prefix[32]={};
+  for(size_t s=0; s<samples.size(); s++)
+  {
+    if(times)
+      std::snprintf(prefix, sizeof(prefix), "%02zu:%02zu:%02zu.000 ", (s/3600)%24, (s/60)%60, s%60);
+
+    for(const auto& [name, value] : samples.at(s))
+      out << prefix << statsLineStart << name << statsDelimiter << value << statsLineEnd << '\n';
+
+    out << prefix << statsLineStart << statsSeparator << statsLineEnd << '\n';
+  }
+
+  return bool(out);
+}
+
+//##################################################################################################
+std::vector<std::pair<uint32_t, uint64_t>> traceSamples(const TraceStore& store, std::string_view name)
+{
+  std::vector<std::pair<uint32_t, uint64_t>> result;
+  auto traceID = store.findTrace(name);
+  if(traceID==invalidTraceID)
+    return result;
+
+  SampleBuffer buffer;
+  auto samples = store.trace(traceID).samples(buffer);
+  for(size_t i=0; i<samples.size; i++)
+    result.emplace_back(samples.indexes[i], samples.values[i]);
+  return result;
+}
+
+}
@@ -0,0 +1,165 @@
+#include "general_performance_stats_viewer_checks/Checks.h"
+
+#include "general_performance_stats_viewer/SampleCodec.h"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//##################################################################################################
+//! Sample columns shaped like the traces the codec is tuned for, and some it is not.
+struct Columns_lt
+{
+  std::string name;
+  std::vector<uint32_t> indexes;
+  std::vector<uint64_t> values;
+
+  //################################################################################################
+  SampleSpan span() const
+  {
+    return {indexes.data(), values.data(), indexes.size()};
+  }
+};
+
+//##################################################################################################
+std::vector<Columns_lt> makeColumns(size_t count)
+{
+  constexpr uint64_t maxValue = std::numeric_limits<uint64_t>::max();
+  constexpr uint32_t maxIndex = std::numeric_limits<uint32_t>::max();
+
+  std::mt19937_64 random(count);
+  std::vector<Columns_lt> result;
+  auto add = [&](const std::string& name, auto index, auto value)
+  {
+    auto& columns = result.emplace_back();
+    columns.name = name + " x" + std::to_string(count);
+    for(size_t i=0; i<count; i++)
+    {
+      columns.indexes.push_back(index(i));
+      columns.values.push_back(value(i));
+    }
+  };
+
+  auto sequential = [](size_t i){return uint32_t(i);};
+  add("constant", sequential, [](size_t){return uint64_t(42);});
+  add("counter", sequential, [](size_t i){return 1000000+i*37+i%5;});
+  add("falling", [](size_t i){return uint32_t(1000+i*3);}, [](size_t i){return 5000000-i*i;});
+  add("random", sequential, [&](size_t){return random();});
+  add("extremes", sequential, [&](size_t i){return (i%2)?maxValue:uint64_t(0);});
+  add("spikes", sequential, [&](size_t){return (random()%17)?random()%8:random();});
+
+  auto gaps = [&](size_t i){return uint32_t(i*(maxIndex/count));};
+  add("gaps", gaps, [](size_t i){return uint64_t(i);});
+
+  auto last = [&](size_t i){return maxIndex-uint32_t(count-1-i);};
+  add("last index", last, [&](size_t){return maxValue;});
+  return result;
+}
+
+//##################################################################################################
+//! Encode and decode a block of each size and shape, and decode it again with too little data.
+void checkBlocks(Checks& checks)
+{
+  for(size_t count : {1, 2, 7, 64, 128, 255, 256})
+  {
+    for(const auto& columns : makeColumns(count))
+    {
+      std::vector<uint8_t> encoded(maxEncodedBlockSize(count)+sampleCodecPadding);
+      size_t size = encodeSampleBlock(columns.span(), encoded.data());
+      if(!checks.check(size>0 && size<=maxEncodedBlockSize(count), "Block size of " + columns.name))
+        continue;
+
+      std::vector<uint32_t> indexes(count);
+      std::vector<uint64_t> values(count);
+      const uint8_t* end = encoded.data()+size+sampleCodecPadding;
+      bool decoded = decodeSampleBlock(encoded.data(), end, count, indexes.data(), values.data());
+      checks.check(decoded && indexes==columns.indexes && values==columns.values,
+                   "Round trip of " + columns.name);
+
+      end = encoded.data()+size/2;
+      decoded = decodeSampleBlock(encoded.data(), end, count, indexes.data(), values.data());
+      bool zeroed = std::all_of(indexes.begin(), indexes.end(), [](uint32_t i){return i==0;}) &&
+                    std::all_of(values.begin(), values.end(), [](uint64_t v){return v==0;});
+      checks.check(!decoded && zeroed, "Truncated block is rejected for " + columns.name);
+    }
+  }
+}
+
+//##################################################################################################
+//! The samples of a trace built in different ways, read back whole, in ranges and by index.
+void checkTrace(Checks& checks)
+{
+  auto columns = makeColumns(1000);
+  for(const auto& c : columns)
+  {
+    Trace appended;
+    for(size_t i=0; i<c.indexes.size(); i++)
+      appended.append(c.indexes.at(i), c.values.at(i));
+
+    Trace assigned;
+    assigned.assign(c.span());
+
+    Trace spans;
+    spans.append(c.span().subspan(0, 300));
+    spans.append(c.span().subspan(300, 700));
+
+    SampleBuffer buffer;
+    auto equal = [&](const Trace& trace, size_t first, size_t count)
+    {
+      auto samples = trace.samples(first, count, buffer);
+      auto offset = std::ptrdiff_t(first);
+      return samples.size==count &&
+          std::equal(samples.indexes, samples.indexes+count, c.indexes.begin()+offset) &&
+          std::equal(samples.values, samples.values+count, c.values.begin()+offset);
+    };
+
+    checks.check(appended.size()==1000 && equal(appended, 0, 1000), "Appended trace of " + c.name);
+    checks.check(assigned.size()==1000 && equal(assigned, 0, 1000), "Assigned trace of " + c.name);
+    checks.check(spans.size()==1000 && equal(spans, 0, 1000), "Trace of spans of " + c.name);
+    checks.check(equal(assigned, 127, 2) && equal(assigned, 500, 500) && equal(assigned, 999, 1),
+                 "Ranges of the trace of " + c.name);
+
+    bool bounds=true;
+    for(size_t i : {size_t(0), size_t(127), size_t(128), size_t(640), size_t(999)})
+    {
+      bounds = bounds &&
+          assigned.lowerBound(c.indexes.at(i))==i &&
+          assigned.upperBound(c.indexes.at(i))==i+1;
+      size_t last = std::min(size_t(999), i+200);
+      auto crop = assigned.crop(c.indexes.at(i), c.indexes.at(last), buffer);
+      bounds = bounds && crop.size==last-i+1 && crop.indexes[0]==c.indexes.at(i);
+    }
+    checks.check(bounds, "Bounds and crop of the trace of " + c.name);
+
+    appended.truncate(300);
+    for(size_t i=300; i<c.indexes.size(); i++)
+      appended.append(c.indexes.at(i), c.values.at(i));
+    checks.check(appended.size()==1000 && equal(appended, 0, 1000),
+                 "Truncated and appended again " + c.name);
+  }
+
+  const auto& c = columns.front();
+  Trace offset;
+  offset.append(c.span(), 10);
+  SampleBuffer buffer;
+  auto samples = offset.samples(buffer);
+  bool ok = samples.size==c.indexes.size();
+  for(size_t i=0; ok && i<samples.size; i++)
+    ok = samples.indexes[i]==c.indexes.at(i)+10 && samples.values[i]==c.values.at(i);
+  checks.check(ok, "Appending with an index offset.");
+}
+}
+
+//##################################################################################################
+void checkSampleCodec(Checks& checks)
+{
+  checkBlocks(checks);
+  checkTrace(checks);
+}
+
+}
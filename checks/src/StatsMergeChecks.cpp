@@ -0,0 +1,224 @@
+#include "general_performance_stats_viewer_checks/Checks.h"
+
+#include "general_performance_stats_viewer/StatsMerge.h"
+
+#include <filesystem>
+#include <mutex>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+using Samples_lt = std::vector<std::pair<uint32_t, uint64_t>>;
+
+//##################################################################################################
+//! x counts up and y is only written on even samples.
+std::vector<StatsSample> firstFile()
+{
+  std::vector<StatsSample> samples;
+  for(uint64_t s=0; s<5; s++)
+  {
+    auto& sample = samples.emplace_back();
+    sample.emplace_back("x", s);
+    if(s%2==0)
+      sample.emplace_back("y", 10);
+  }
+  return samples;
+}
+
+//##################################################################################################
+//! Shorter than firstFile(), x is constant and z is only in this file.
+std::vector<StatsSample> secondFile()
+{
+  std::vector<StatsSample> samples;
+  for(uint64_t s=0; s<3; s++)
+    samples.push_back({{"x", 100}, {"z", 7}});
+  return samples;
+}
+}
+
+//##################################################################################################
+void checkStatsMerge(Checks& checks)
+{
+  std::filesystem::create_directories(checks.path("one"));
+  std::filesystem::create_directories(checks.path("two"));
+
+  auto first = checks.path("first.txt");
+  auto second = checks.path("second.txt");
+  auto sameName0 = checks.path("one/stats.txt");
+  auto sameName1 = checks.path("two/stats.txt");
+  if(!checks.check(writeStatsFile(first, firstFile()) &&
+                   writeStatsFile(second, secondFile()) &&
+                   writeStatsFile(sameName0, firstFile()) &&
+                   writeStatsFile(sameName1, secondFile()), "Write the merge stats files."))
+    return;
+
+  Samples_lt x0{{0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}};
+  Samples_lt y0{{0, 10}, {2, 10}, {4, 10}};
+  Samples_lt x1{{0, 100}, {1, 100}, {2, 100}};
+  Samples_lt z1{{0, 7}, {1, 7}, {2, 7}};
+
+  TraceStore store;
+  std::vector<TraceDelta> deltas;
+
+  //-- Namespaced ----------------------------------------------------------------------------------
+  {
+    bool loaded = loadStatsFiles({first, second}, StatsMergeMode::Namespaced, store, deltas, 2);
+    checks.check(loaded, "Namespaced merge loads.");
+    checks.check(store.traceCount()==4, "Namespaced merge keeps the traces of each file apart.");
+    checks.check(store.sampleCount()==5, "The merged sample count is that of the longest file.");
+    checks.check(traceSamples(store, "first.txt/x")==x0, "Namespaced first.txt/x.");
+    checks.check(traceSamples(store, "first.txt/y")==y0, "Namespaced first.txt/y keeps its gaps.");
+    checks.check(traceSamples(store, "second.txt/x")==x1, "Namespaced second.txt/x.");
+    checks.check(traceSamples(store, "second.txt/z")==z1, "Namespaced second.txt/z.");
+    checks.check(deltas.empty(), "Namespaced merge gives no deltas.");
+  }
+
+  //-- Summed --------------------------------------------------------------------------------------
+  {
+    bool loaded = loadStatsFiles({first, second}, StatsMergeMode::Summed, store, deltas, 2);
+    checks.check(loaded, "Summed merge loads.");
+    checks.check(store.traceCount()==3, "Summed merge joins traces by name.");
+    checks.check(store.sampleCount()==5, "Summed sample count.");
+    checks.check(traceSamples(store, "x")==Samples_lt{{0, 100}, {1, 101}, {2, 102}, {3, 3}, {4, 4}},
+                 "Summed x is the sum at each sample index.");
+    checks.check(traceSamples(store, "y")==y0, "Summed y is copied from the only file with it.");
+    checks.check(traceSamples(store, "z")==z1, "Summed z is copied from the only file with it.");
+  }
+
+  //-- Summed samples with the same index in one file ----------------------------------------------
+  {
+    auto duplicates = checks.path("duplicates.txt");
+    writeStatsFile(duplicates, {{{"x", 1}, {"x", 2}}, {{"x", 5}}});
+    bool loaded = loadStatsFiles({duplicates, second}, StatsMergeMode::Summed, store, deltas, 2);
+    Samples_lt expected{{0, 101}, {0, 102}, {1, 105}, {2, 100}};
+    checks.check(loaded && traceSamples(store, "x")==expected,
+                 "Samples with the same index in one file are not summed with each other.");
+  }
+
+  //-- Summed traces longer than the spans they are decoded in -------------------------------------
+  {
+    std::vector<StatsSample> single;
+    std::vector<StatsSample> twice;
+    Samples_lt expected;
+    for(uint64_t s=0; s<10000; s++)
+    {
+      single.push_back({{"x", s}});
+      twice.push_back({{"x", s*2}});
+      expected.emplace_back(uint32_t(s), s*3);
+    }
+
+    auto singlePath = checks.path("single.txt");
+    auto twicePath = checks.path("twice.txt");
+    writeStatsFile(singlePath, single);
+    writeStatsFile(twicePath, twice);
+    bool loaded = loadStatsFiles({singlePath, twicePath}, StatsMergeMode::Summed, store, deltas, 2);
+    checks.check(loaded && traceSamples(store, "x")==expected, "Summed long traces.");
+  }
+
+  //-- Difference ----------------------------------------------------------------------------------
+  {
+    //Index 3 is the sample after the last separator of the shorter file, the second file holds x.
+    bool loaded = loadStatsFiles({first, second}, StatsMergeMode::Difference, store, deltas, 2);
+    checks.check(loaded, "Difference loads.");
+    if(checks.check(deltas.size()==store.traceCount(), "Difference gives a delta for each trace."))
+    {
+      auto traceID = store.findTrace("x");
+      bool ok = traceID!=invalidTraceID &&
+          deltas.at(traceID).bias==0 &&
+          traceSamples(store, "x")==Samples_lt{{0, 100}, {1, 99}, {2, 98}, {3, 97}};
+      checks.check(ok, "Difference x is the last file minus the first, holding the shorter file.");
+      checks.check(traceSamples(store, "y").empty() && traceSamples(store, "z").empty(),
+                   "A trace that is only in one file has no difference.");
+    }
+
+    loaded = loadStatsFiles({second, first}, StatsMergeMode::Difference, store, deltas, 2);
+    auto traceID = store.findTrace("x");
+    bool ok = loaded && traceID!=invalidTraceID &&
+        deltas.at(traceID).bias==100 &&
+        traceSamples(store, "x")==Samples_lt{{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+    checks.check(ok, "Negative differences are offset by the bias.");
+  }
+
+  //-- Progress and cancellation -------------------------------------------------------------------
+  {
+    std::atomic_bool cancelled{false};
+    std::mutex mutex;
+    std::vector<size_t> bytes(2, 0);
+    std::vector<size_t> finished(2, 0);
+    auto progress = [&](size_t f, size_t parsed, bool done)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      bytes.at(f) += parsed;
+      finished.at(f) += done?1:0;
+    };
+
+    bool loaded = loadStatsFiles({first, second}, StatsMergeMode::Summed, store, deltas, 2, std::string(), &cancelled, progress);
+    checks.check(loaded &&
+                 bytes.at(0)==std::filesystem::file_size(first) &&
+                 bytes.at(1)==std::filesystem::file_size(second) &&
+                 finished==std::vector<size_t>{1, 1}, "Progress is reported for each file.");
+
+    cancelled = true;
+    loaded = loadStatsFiles({first, second}, StatsMergeMode::Summed, store, deltas, 2, std::string(), &cancelled);
+    checks.check(!loaded && store.traceCount()==0, "A cancelled merge stops before parsing.");
+
+    loaded = loadStatsFiles({first, second}, StatsMergeMode::Difference, store, deltas, 2, std::string(), &cancelled);
+    checks.check(!loaded && deltas.empty(), "A cancelled difference stops before comparing.");
+  }
+
+  //-- Files merged side by side -------------------------------------------------------------------
+  {
+    TraceStore shorter;
+    for(const auto& [index, value] : z1)
+      shorter.appendSample(shorter.addTrace("z"), index, value);
+    shorter.setSampleCount(3);
+
+    TraceStore longer;
+    for(const auto& [index, value] : y0)
+      longer.appendSample(longer.addTrace("y"), index, value);
+    longer.setSampleCount(5);
+    longer.setSampleTimes({10, 20, 30, 40, 50, 60});
+
+    //The sample count and times come from the longer store whichever is merged first.
+    std::vector<TraceID> changed;
+    TraceStore merged;
+    merged.mergeStore(shorter, changed);
+    merged.mergeStore(longer, changed);
+    checks.check(merged.traceCount()==2 && changed.size()==2 && merged.sampleCount()==5 &&
+                 merged.sampleTimes()==longer.sampleTimes() && merged.pointCount()==6,
+                 "Merging stores side by side keeps the longer sample count and times.");
+    checks.check(traceSamples(merged, "y")==y0 && traceSamples(merged, "z")==z1,
+                 "Merged traces keep their sample indexes.");
+  }
+
+  //-- Files with the same name --------------------------------------------------------------------
+  {
+    auto labels = statsFileLabels({first, sameName0, sameName1});
+    checks.check(labels==std::vector<std::string>{"first.txt", sameName0, sameName1},
+                 "Files with the same name are labelled with their paths.");
+
+    bool loaded = loadStatsFiles({sameName0, sameName1}, StatsMergeMode::Namespaced, store, deltas);
+    checks.check(loaded &&
+                 traceSamples(store, sameName0+"/x")==x0 &&
+                 traceSamples(store, sameName1+"/x")==x1,
+                 "Namespaced merge of files with the same name.");
+  }
+
+  //-- A missing file ------------------------------------------------------------------------------
+  {
+    auto missing = checks.path("missing.txt");
+    bool loaded = loadStatsFiles({first, missing, second}, StatsMergeMode::Summed, store, deltas);
+    checks.check(!loaded, "A missing file fails the merge.");
+    checks.check(store.traceCount()==3 && traceSamples(store, "z")==z1,
+                 "The files that exist are still merged.");
+
+    std::vector<std::unique_ptr<TraceStore>> stores;
+    loaded = loadStatsFileStores({first, missing}, stores, 2);
+    checks.check(!loaded && stores.size()==2 && stores.at(1)->traceCount()==0 &&
+                 traceSamples(*stores.at(0), "x")==x0, "A missing file gives an empty store.");
+  }
+}
+
+}
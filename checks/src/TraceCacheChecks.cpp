@@ -0,0 +1,297 @@
+#include "general_performance_stats_viewer_checks/Checks.h"
+
+#include "general_performance_stats_viewer/TraceCache.h"
+#include "general_performance_stats_viewer/StatsLoader.h"
+#include "general_performance_stats_viewer/MappedFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//The offsets of fields in the cache, see CacheHeader_lt and CacheTrace_lt in TraceCache.cpp.
+constexpr size_t versionOffset = 8;
+constexpr size_t firstTraceOffset = 80;
+constexpr size_t firstBlocksOffset = firstTraceOffset + 32;
+
+//##################################################################################################
+//! A counter, a spiky gauge written every third sample and a constant written rarely.
+std::vector<StatsSample> cacheStats(size_t count)
+{
+  std::mt19937_64 random(1);
+  std::vector<StatsSample> samples(count);
+  uint64_t a=0;
+  for(size_t s=0; s<count; s++)
+  {
+    auto& sample = samples.at(s);
+    a += random()%1000;
+    sample.emplace_back("a", a);
+    if(s%3==0)
+      sample.emplace_back("b", (random()%50==0)?random():random()%100);
+    if(s%1000==0)
+      sample.emplace_back("c with spaces", 7);
+  }
+  return samples;
+}
+
+//##################################################################################################
+bool sameSamples(const Trace& a, const Trace& b)
+{
+  SampleBuffer bufferA;
+  SampleBuffer bufferB;
+  auto spanA = a.samples(bufferA);
+  auto spanB = b.samples(bufferB);
+  return spanA.size==spanB.size &&
+      std::equal(spanA.indexes, spanA.indexes+spanA.size, spanB.indexes) &&
+      std::equal(spanA.values, spanA.values+spanA.size, spanB.values);
+}
+
+//##################################################################################################
+//! True if the store and LODs read from the cache match those that were written.
+bool sameStore(const TraceStore& expected,
+               const std::vector<TraceLOD>& expectedLODs,
+               const TraceStore& store,
+               const std::vector<TraceLOD>& lods)
+{
+  if(store.traceCount()!=expected.traceCount() ||
+     store.sampleCount()!=expected.sampleCount() ||
+     store.sampleTimes()!=expected.sampleTimes() ||
+     lods.size()!=expectedLODs.size())
+    return false;
+
+  for(TraceID t=0; t<store.traceCount(); t++)
+  {
+    const auto& trace = store.trace(t);
+    const auto& expectedTrace = expected.trace(t);
+    if(trace.name!=expectedTrace.name ||
+       trace.maxValue!=expectedTrace.maxValue ||
+       !sameSamples(trace, expectedTrace) ||
+       lods.at(t).levelCount()!=expectedLODs.at(t).levelCount())
+      return false;
+
+    const auto& levels = lods.at(t).levels;
+    const auto& expectedLevels = expectedLODs.at(t).levels;
+    for(size_t l=0; l<levels.size(); l++)
+      if(levels.at(l).bucketWidth!=expectedLevels.at(l).bucketWidth ||
+         !sameSamples(levels.at(l).samples, expectedLevels.at(l).samples))
+        return false;
+  }
+
+  return true;
+}
+
+//##################################################################################################
+//! Overwrite 8 bytes of a file.
+void patchFile(const std::string& path, size_t offset, uint64_t value)
+{
+  std::fstream file(path, std::ios::in|std::ios::out|std::ios::binary);
+  file.seekp(std::streamoff(offset));
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+//##################################################################################################
+uint64_t readFile(const std::string& path, size_t offset)
+{
+  uint64_t value{0};
+  std::ifstream file(path, std::ios::binary);
+  file.seekg(std::streamoff(offset));
+  file.read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+}
+
+//##################################################################################################
+void checkTraceCache(Checks& checks)
+{
+  auto path = checks.path("cached.txt");
+  auto cachePath = traceCachePath(path);
+  auto samples = cacheStats(20000);
+  if(!checks.check(writeStatsFile(path, samples, true), "Write the cache stats file."))
+    return;
+
+  TraceStore store;
+  std::vector<TraceLOD> lods;
+  size_t bytes = std::filesystem::file_size(path);
+  {
+    MappedFile file(path);
+    if(!checks.check(file.isOpen() && loadStats(file.view(), store, 2), "Load the stats file."))
+      return;
+  }
+
+  lods.resize(store.traceCount());
+  for(TraceID t=0; t<store.traceCount(); t++)
+    lods.at(t).update(store.trace(t));
+
+  checks.check(store.traceCount()==3 &&
+               store.sampleCount()==samples.size() &&
+               store.sampleTimes().size()==samples.size()+1 &&
+               lods.at(0).levelCount()>2, "The cache stats file has traces, times and LOD levels.");
+
+  //Derived traces are not cached.
+  auto derivedID = store.addTrace("= a * 2");
+  store.trace(derivedID).derived = true;
+  store.appendSample(derivedID, 0, 1);
+  lods.resize(store.traceCount());
+
+  //-- Round trip ----------------------------------------------------------------------------------
+  checks.check(writeTraceCache(path, store, lods, bytes), "Write the cache.");
+
+  //Compare against the store as it was loaded, without the derived trace.
+  lods.pop_back();
+  TraceStore loaded;
+  {
+    MappedFile file(path);
+    loadStats(file.view(), loaded, 2);
+  }
+
+  {
+    TraceStore cached;
+    std::vector<TraceLOD> cachedLODs;
+    size_t parsedBytes=0;
+    bool read = readTraceCache(path, cached, cachedLODs, parsedBytes);
+    checks.check(read, "Read the cache into memory.");
+    checks.check(parsedBytes==bytes, "The cache holds the parsed bytes.");
+    checks.check(cached.findTrace("= a * 2")==invalidTraceID, "Derived traces are not cached.");
+    checks.check(sameStore(loaded, lods, cached, cachedLODs), "The cache in memory matches.");
+  }
+
+  {
+    TraceStore paged;
+    std::vector<TraceLOD> pagedLODs;
+    size_t parsedBytes=0;
+    bool read = readTraceCache(path, paged, pagedLODs, parsedBytes, 4096);
+    checks.check(read && paged.pagedFile(), "Read the cache paged.");
+    checks.check(parsedBytes==bytes && sameStore(loaded, lods, paged, pagedLODs),
+                 "The paged cache matches, with a budget smaller than the cache.");
+
+    //Append more than a block to a paged trace and to the same trace in memory, as following does.
+    TraceStore memory;
+    std::vector<TraceLOD> memoryLODs;
+    readTraceCache(path, memory, memoryLODs, parsedBytes);
+    auto a = paged.findTrace("a");
+    const auto& pagedTrace = paged.trace(a);
+    size_t pagedBlocks = pagedTrace.pagedBlockCount();
+    size_t size = pagedTrace.size();
+    uint64_t last = traceSamples(paged, "a").back().second;
+    for(uint32_t i=0; i<3*sampleBlockSize; i++)
+    {
+      paged.appendSample(a, uint32_t(samples.size()+i), last+i);
+      memory.appendSample(a, uint32_t(samples.size()+i), last+i);
+    }
+
+    checks.check(pagedTrace.paged.file && pagedTrace.pagedBlockCount()==pagedBlocks &&
+                 pagedTrace.blockCount()>pagedBlocks,
+                 "Blocks sealed after paging are kept in memory after the paged blocks.");
+    checks.check(sameSamples(pagedTrace, memory.trace(a)), "Appended paged samples match.");
+
+    bool bounds=true;
+    SampleBuffer pagedBuffer;
+    SampleBuffer memoryBuffer;
+    for(uint32_t index : {uint32_t(0), uint32_t(samples.size()-1), uint32_t(samples.size()+200)})
+    {
+      const auto& m = memory.trace(a);
+      bounds = bounds &&
+          pagedTrace.lowerBound(index)==m.lowerBound(index) &&
+          pagedTrace.upperBound(index)==m.upperBound(index);
+      auto pagedCrop = pagedTrace.crop(index, index+300, pagedBuffer);
+      auto memoryCrop = m.crop(index, index+300, memoryBuffer);
+      bounds = bounds && pagedCrop.size==memoryCrop.size &&
+          std::equal(pagedCrop.values, pagedCrop.values+pagedCrop.size, memoryCrop.values);
+    }
+    checks.check(bounds, "Bounds and crops span the paged and appended blocks.");
+
+    paged.trace(a).truncate(size+sampleBlockSize+10);
+    memory.trace(a).truncate(size+sampleBlockSize+10);
+    checks.check(pagedTrace.paged.file && sameSamples(pagedTrace, memory.trace(a)),
+                 "Truncating appended blocks keeps the paged blocks.");
+
+    //The cache written from a paged store with appended blocks holds all of them.
+    auto appendedPath = checks.path("appended.txt");
+    {
+      std::ofstream out(appendedPath, std::ios::binary);
+    }
+    std::vector<TraceLOD> noLODs(paged.traceCount());
+    TraceStore reread;
+    std::vector<TraceLOD> rereadLODs;
+    bool cached = writeTraceCache(appendedPath, paged, noLODs, 0) &&
+        readTraceCache(appendedPath, reread, rereadLODs, parsedBytes);
+    checks.check(cached && sameSamples(reread.trace(reread.findTrace("a")), memory.trace(a)),
+                 "A paged trace with appended blocks is cached whole.");
+
+    paged.trace(a).truncate(10);
+    memory.trace(a).truncate(10);
+    checks.check(!pagedTrace.paged.file && sameSamples(pagedTrace, memory.trace(a)),
+                 "Truncating into the paged blocks copies them into memory.");
+  }
+
+  //-- Stale and corrupt caches are rejected -------------------------------------------------------
+  auto rejected = [&](const std::string& what)
+  {
+    size_t parsedBytes=0;
+    TraceStore stale;
+    std::vector<TraceLOD> staleLODs;
+    bool inMemory = readTraceCache(path, stale, staleLODs, parsedBytes);
+    bool paged = readTraceCache(path, stale, staleLODs, parsedBytes, 4096);
+    checks.check(!inMemory && !paged && stale.traceCount()==0 && staleLODs.empty(), what);
+  };
+
+  auto rewrite = [&]
+  {
+    return checks.check(writeTraceCache(path, loaded, lods, bytes), "Write the cache again.");
+  };
+
+  {
+    std::ofstream out(path, std::ios::binary|std::ios::app);
+    out << "More stats\n";
+  }
+  rejected("A cache is rejected when the stats file grows.");
+
+  std::filesystem::resize_file(path, bytes);
+  rewrite();
+  auto mtime = std::filesystem::last_write_time(path);
+  std::filesystem::last_write_time(path, mtime + std::chrono::hours(1));
+  rejected("A cache is rejected when the stats file is modified.");
+  std::filesystem::last_write_time(path, mtime);
+
+  if(rewrite())
+  {
+    patchFile(cachePath, versionOffset, readFile(cachePath, versionOffset)+1);
+    rejected("A cache with another version is rejected.");
+  }
+
+  if(rewrite())
+  {
+    std::filesystem::resize_file(cachePath, std::filesystem::file_size(cachePath)/2);
+    rejected("A truncated cache is rejected.");
+  }
+
+  if(rewrite())
+  {
+    patchFile(cachePath, firstBlocksOffset, std::filesystem::file_size(cachePath));
+    rejected("A cache with blocks outside the file is rejected.");
+  }
+
+  if(rewrite())
+  {
+    //The first field of the first SampleBlock is its offset in the encoded blocks.
+    patchFile(cachePath, readFile(cachePath, firstBlocksOffset), uint64_t(1)<<40);
+    rejected("A cache with a block outside the encoded data is rejected.");
+  }
+
+  if(rewrite())
+  {
+    TraceStore valid;
+    std::vector<TraceLOD> validLODs;
+    size_t parsedBytes=0;
+    bool read = readTraceCache(path, valid, validLODs, parsedBytes);
+    checks.check(read, "The rewritten cache is read.");
+  }
+}
+
+}
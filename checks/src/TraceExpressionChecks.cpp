@@ -0,0 +1,387 @@
+#include "general_performance_stats_viewer_checks/Checks.h"
+
+#include "general_performance_stats_viewer/TraceExpression.h"
+#include "general_performance_stats_viewer/TraceLOD.h"
+#include "general_performance_stats_viewer/TraceRangeMax.h"
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <random>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+using Samples_lt = std::vector<std::pair<uint32_t, uint64_t>>;
+using Results_lt = std::vector<std::pair<uint32_t, int64_t>>;
+
+//##################################################################################################
+//! The samples of some traces and the times of each sample.
+struct Capture_lt
+{
+  std::map<std::string, Samples_lt> traces;
+  std::vector<int64_t> times;
+  size_t sampleCount{0};
+};
+
+//##################################################################################################
+//! Counters, gauges with gaps and a trace that only starts half way through.
+Capture_lt makeCapture(size_t sampleCount)
+{
+  Capture_lt capture;
+  capture.sampleCount = sampleCount;
+  std::mt19937 random(1);
+  uint64_t a=0;
+  uint64_t b=0;
+  for(uint32_t i=0; i<sampleCount; i++)
+  {
+    a += random()%1000;
+    capture.traces["a"].emplace_back(i, a);
+    if(random()%3)
+    {
+      b += random()%50+1;
+      capture.traces["b"].emplace_back(i, b);
+    }
+    if(i%7==0)
+      capture.traces["db.x"].emplace_back(i, random()%100);
+    if(i>sampleCount/2 && i%5==0)
+      capture.traces["db.late"].emplace_back(i, random()%100);
+    capture.traces["other name"].emplace_back(i, 5);
+  }
+
+  int64_t time=1000000000;
+  for(size_t i=0; i<=sampleCount; i++)
+  {
+    capture.times.push_back(time);
+    time += 1000000 + int64_t(random()%1000000);
+  }
+  return capture;
+}
+
+//##################################################################################################
+//! Append the samples from first to last to store, as StatsFollower does.
+void appendCapture(TraceStore& store, const Capture_lt& capture, size_t first, size_t last)
+{
+  TraceStore other;
+  for(const auto& [name, samples] : capture.traces)
+  {
+    auto traceID = other.addTrace(name);
+    for(const auto& [index, value] : samples)
+      if(index>=first && index<last)
+        other.appendSample(traceID, uint32_t(index-first), value);
+  }
+  other.setSampleCount(last-first);
+  auto times = capture.times.begin();
+  other.setSampleTimes({times+std::ptrdiff_t(first), times+std::ptrdiff_t(last+1)});
+
+  std::vector<TraceID> changed;
+  store.appendStore(other, changed);
+}
+
+//##################################################################################################
+//! What the previous sample left for rate() and delta().
+struct State_lt
+{
+  double previous{NAN};
+  double previousTime{0.0};
+};
+
+//##################################################################################################
+//! Calculates a result from the value each trace holds, the time in seconds and the state.
+using Function_lt = std::function<double(const std::vector<double>&, double, State_lt&)>;
+
+//##################################################################################################
+//! Evaluate an expression a sample at a time, holding the last value of each trace.
+/*!
+Results are rounded to the fixed point of derived traces, those that are not finite are left out.
+*/
+Results_lt reference(const Capture_lt& capture,
+                     const std::vector<std::string>& names,
+                     const Function_lt& function)
+{
+  Results_lt result;
+  std::vector<double> held(names.size(), NAN);
+  std::vector<size_t> positions(names.size(), 0);
+  State_lt state;
+  for(uint32_t i=0; i<capture.sampleCount; i++)
+  {
+    bool any=false;
+    for(size_t n=0; n<names.size(); n++)
+    {
+      const auto& samples = capture.traces.at(names.at(n));
+      auto& p = positions.at(n);
+      if(p<samples.size() && samples.at(p).first==i)
+      {
+        held.at(n) = double(samples.at(p).second);
+        p++;
+        any = true;
+      }
+    }
+
+    if(!any)
+      continue;
+
+    double time = double(capture.times.at(i)-capture.times.front())*1e-9;
+    double value = function(held, time, state) * double(derivedValueScale);
+    if(std::isfinite(value))
+      result.emplace_back(i, int64_t(std::round(value)));
+  }
+  return result;
+}
+
+//##################################################################################################
+//! The signed results of an expression, its values less its bias.
+Results_lt results(const TraceStore& store, const TraceExpression& expression)
+{
+  Results_lt result;
+  for(const auto& [index, value] : traceSamples(store, expression.name()))
+    result.emplace_back(index, int64_t(value-expression.bias()));
+  return result;
+}
+
+//##################################################################################################
+void checkErrors(Checks& checks)
+{
+  std::vector<std::pair<std::string, std::string>> errors
+  {
+    {"a +"              , "Expected a value at character 4."           },
+    {"foo(a)"           , "Unknown function 'foo' at character 1."     },
+    {"(a"               , "Expected ')' at character 3."               },
+    {"a b"              , "Unexpected 'b' at character 3."             },
+    {"\"abc"            , "Expected a closing '\"' at character 5."    },
+    {"sum(matching \"[\")", "Invalid regex \"[\" at character 5."      },
+    {""                 , "Expected a value at character 1."           }
+  };
+
+  for(const auto& [text, error] : errors)
+  {
+    TraceExpression expression(text);
+    checks.check(expression.error()==error, "Error for \"" + text + "\": " + expression.error());
+  }
+
+  TraceExpression valid("rate(\"a b\") / max(c, 2.5e3) - -d");
+  checks.check(valid.error().empty() && valid.name()=="= rate(\"a b\") / max(c, 2.5e3) - -d",
+               "A valid expression parses.");
+}
+
+//##################################################################################################
+//! Evaluate each expression over the whole capture and incrementally, against reference().
+void checkEvaluation(Checks& checks)
+{
+  //Long enough for several batches of evaluation windows.
+  auto capture = makeCapture(40000);
+
+  struct Case_lt
+  {
+    std::string text;
+    std::vector<std::string> names;
+    Function_lt function;
+  };
+
+  std::vector<Case_lt> cases
+  {
+    {"a / b", {"a", "b"}, [](const auto& h, double, auto&)
+    {
+      return h[0]/h[1];
+    }},
+    {"rate(a)", {"a"}, [](const auto& h, double time, auto& state)
+    {
+      double rate = (h[0]-state.previous)/(time-state.previousTime);
+      state.previous = h[0];
+      state.previousTime = time;
+      return rate;
+    }},
+    {"delta(b - a)", {"a", "b"}, [](const auto& h, double, auto& state)
+    {
+      double delta = (h[1]-h[0])-state.previous;
+      state.previous = h[1]-h[0];
+      return delta;
+    }},
+    {"2*-(b - a) + \"other name\"*0.5", {"a", "b", "other name"}, [](const auto& h, double, auto&)
+    {
+      return 2*-(h[1]-h[0])+h[2]*0.5;
+    }},
+    {"max(a, b*10) - min(b, 3)", {"a", "b"}, [](const auto& h, double, auto&)
+    {
+      return std::fmax(h[0], h[1]*10)-std::fmin(h[1], 3.0);
+    }},
+    {"sum(matching \"db\\..*\")", {"db.x", "db.late"}, [](const auto& h, double, auto&)
+    {
+      return std::isnan(h[1])?h[0]:h[0]+h[1];
+    }},
+    {"avg(matching \"db.*\")", {"db.x", "db.late"}, [](const auto& h, double, auto&)
+    {
+      return std::isnan(h[1])?h[0]:(h[0]+h[1])/2;
+    }},
+    {"max(matching \"db.*\") - min(matching \"db.*\")", {"db.x", "db.late"}, [](const auto& h, double, auto&)
+    {
+      return std::fmax(h[0], h[1])-std::fmin(h[0], h[1]);
+    }},
+    {"db.x + sum(matching \"db.*\")", {"db.x", "db.late"}, [](const auto& h, double, auto&)
+    {
+      return h[0] + (std::isnan(h[1])?h[0]:h[0]+h[1]);
+    }},
+  };
+
+  for(const auto& c : cases)
+  {
+    auto expected = reference(capture, c.names, c.function);
+
+    TraceStore whole;
+    appendCapture(whole, capture, 0, capture.sampleCount);
+    TraceExpression wholeExpression(c.text);
+    auto update = wholeExpression.update(whole);
+    checks.check(update.changed && update.firstChanged==0 &&
+                 results(whole, wholeExpression)==expected, c.text + " over the whole capture.");
+    checks.check(!wholeExpression.update(whole).changed, c.text + " unchanged by a second update.");
+
+    TraceStore incremental;
+    TraceExpression incrementalExpression(c.text);
+    std::mt19937 random(7);
+    for(size_t first=0; first<capture.sampleCount;)
+    {
+      size_t last = std::min(capture.sampleCount, first+1+random()%1500);
+      appendCapture(incremental, capture, first, last);
+      incrementalExpression.update(incremental);
+      first = last;
+    }
+    checks.check(results(incremental, incrementalExpression)==expected,
+                 c.text + " updated as samples are appended.");
+    checks.check(incrementalExpression.bias()==wholeExpression.bias(),
+                 c.text + " has the same bias either way.");
+  }
+}
+
+//##################################################################################################
+//! The last sample index can still gain samples, and a negative result rewrites the trace.
+void checkUpdates(Checks& checks)
+{
+  TraceStore store;
+  auto a = store.addTrace("a");
+  auto b = store.addTrace("b");
+  for(uint32_t i=0; i<3; i++)
+    store.appendSample(a, i, 10+i);
+  store.appendSample(b, 0, 100);
+  store.setSampleCount(2);
+
+  TraceExpression expression("a + b");
+  expression.update(store);
+  Results_lt expected{{0, 110000}, {1, 111000}, {2, 112000}};
+  checks.check(expression.bias()==0 && results(store, expression)==expected,
+               "b is held after its last sample.");
+
+  //The first sample of other is the last sample of store.
+  auto appendB = [&](uint64_t value)
+  {
+    TraceStore other;
+    other.appendSample(other.addTrace("b"), 0, value);
+    other.setSampleCount(1);
+    std::vector<TraceID> changed;
+    store.appendStore(other, changed);
+  };
+
+  appendB(200);
+  auto update = expression.update(store);
+  expected.back().second = 212000;
+  checks.check(update.changed && update.firstChanged==2 && results(store, expression)==expected,
+               "The last sample index is evaluated again when it gains a sample.");
+
+  TraceExpression difference("a - b");
+  difference.update(store);
+  Results_lt negative{{0, -90000}, {1, -89000}, {2, -188000}};
+  checks.check(difference.bias()==(1<<18) && results(store, difference)==negative,
+               "Negative results are stored with a bias, the next power of two.");
+
+  appendB(10000);
+  store.appendSample(a, 3, 13);
+  update = difference.update(store);
+  checks.check(update.changed && update.firstChanged==0 && difference.bias()==(1<<24),
+               "A bigger bias evaluates every result again.");
+  negative.emplace_back(3, -9987000);
+  checks.check(results(store, difference)==negative, "The results are correct with the new bias.");
+
+  TraceExpression missing("missing * 2");
+  missing.update(store);
+  checks.check(missing.traceID()!=invalidTraceID && store.trace(missing.traceID()).size()==0,
+               "An expression of a trace that does not exist has no results.");
+
+  store.clear();
+  expression.reset();
+  checks.check(expression.traceID()==invalidTraceID, "Reset forgets the derived trace.");
+  appendB(5);
+  store.appendSample(store.addTrace("a"), 0, 1);
+  expression.update(store);
+  checks.check(expression.traceID()!=invalidTraceID &&
+               results(store, expression)==Results_lt{{0, 6000}},
+               "After a reset the derived trace is added again.");
+}
+
+//##################################################################################################
+//! Rewritten samples truncate the LOD and range max, which then match ones built from scratch.
+void checkTruncate(Checks& checks)
+{
+  std::mt19937 random(3);
+  Trace trace;
+  for(uint32_t i=0; i<20000; i++)
+    trace.append(i*2, random()%1000);
+
+  TraceLOD lod;
+  TraceRangeMax rangeMax;
+  lod.update(trace);
+  rangeMax.update(trace);
+
+  //Replace the samples from size on with fewer samples at other indexes, as a bias change can.
+  for(size_t size : {size_t(15000), size_t(4001), size_t(100)})
+  {
+    trace.truncate(size);
+    for(uint32_t i=0; i<1000; i++)
+      trace.append(uint32_t(size)*2+1+i*3, random()%5000);
+
+    lod.truncate(size);
+    rangeMax.truncate(size);
+    lod.update(trace);
+    rangeMax.update(trace);
+
+    TraceLOD expectedLOD;
+    TraceRangeMax expectedRangeMax;
+    expectedLOD.update(trace);
+    expectedRangeMax.update(trace);
+
+    SampleBuffer buffer;
+    auto samples = [&](const Trace& t)
+    {
+      auto span = t.samples(buffer);
+      Samples_lt result;
+      for(size_t p=0; p<span.size; p++)
+        result.emplace_back(span.indexes[p], span.values[p]);
+      return result;
+    };
+
+    bool same = lod.levelCount()==expectedLOD.levelCount();
+    for(size_t l=1; same && l<lod.levelCount(); l++)
+      same = samples(lod.levelSamples(trace, l))==samples(expectedLOD.levelSamples(trace, l));
+    checks.check(same, "The LOD of a truncated trace matches, from " + std::to_string(size) + ".");
+
+    bool max=true;
+    uint64_t last = trace.size()*3;
+    for(uint64_t first=0; first<last; first+=997)
+      max = max &&
+          rangeMax.max(trace, first, first+5000)==expectedRangeMax.max(trace, first, first+5000) &&
+          rangeMax.max(trace, first, last)==expectedRangeMax.max(trace, first, last);
+    checks.check(max, "The range max of a truncated trace matches, from " + std::to_string(size) + ".");
+  }
+}
+}
+
+//##################################################################################################
+void checkTraceExpression(Checks& checks)
+{
+  checkErrors(checks);
+  checkEvaluation(checks);
+  checkUpdates(checks);
+  checkTruncate(checks);
+}
+
+}
@@ -0,0 +1,18 @@
+#include "general_performance_stats_viewer_checks/Checks.h"
+
+#include <cstdio>
+
+using namespace general_performance_stats_viewer;
+
+//##################################################################################################
+int main()
+{
+  Checks checks;
+  checkStatsMerge(checks);
+  checkSampleCodec(checks);
+  checkTraceCache(checks);
+  checkTraceExpression(checks);
+
+  std::printf("%zu of %zu checks failed\n", checks.failures(), checks.count());
+  return checks.failures()?1:0;
+}
@@ -0,0 +1,31 @@
+TARGET = general_performance_stats_viewer_checks
+TEMPLATE = app
+CONFIG += console
+
+SOURCES += src/main.cpp
+
+HEADERS += inc/general_performance_stats_viewer_checks/Checks.h
+SOURCES += src/Checks.cpp
+SOURCES += src/StatsMergeChecks.cpp
+SOURCES += src/SampleCodecChecks.cpp
+SOURCES += src/TraceCacheChecks.cpp
+SOURCES += src/TraceExpressionChecks.cpp
+
+#The checks are built from the headless sources of the viewer.
+SOURCES += ../src/Globals.cpp
+SOURCES += ../src/MappedFile.cpp
+SOURCES += ../src/PagedFile.cpp
+SOURCES += ../src/StatsParser.cpp
+SOURCES += ../src/SampleTimes.cpp
+SOURCES += ../src/Parallel.cpp
+SOURCES += ../src/StatsLoader.cpp
+SOURCES += ../src/Arena.cpp
+SOURCES += ../src/SampleCodec.cpp
+SOURCES += ../src/TraceStore.cpp
+SOURCES += ../src/TraceLOD.cpp
+SOURCES += ../src/TraceRangeMax.cpp
+SOURCES += ../src/TraceCache.cpp
+SOURCES += ../src/TraceStats.cpp
+SOURCES += ../src/TraceDiff.cpp
+SOURCES += ../src/StatsMerge.cpp
+SOURCES += ../src/TraceExpression.cpp
@@ -0,0 +1,75 @@
+#ifndef general_performance_stats_viewer_Arena_h
+#define general_performance_stats_viewer_Arena_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include <memory_resource>
+#include <string_view>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! The memory used by an Arena.
+struct ArenaStats
+{
+  size_t blockCount{0};      //!< The number of blocks taken from the system.
+  size_t reservedBytes{0};   //!< The total size of those blocks.
+  size_t allocatedBytes{0};  //!< The bytes handed out, including those that have been abandoned.
+  size_t abandonedBytes{0};  //!< The bytes freed by containers, these are not reused until release().
+  size_t allocationCount{0};
+};
+
+//##################################################################################################
+//! A thread safe monotonic memory resource for storage that lives until the next load.
+/*!
+Allocations are carved from large blocks and deallocation does nothing, everything is returned to
+the system in one go by release(). This removes the allocator churn of growing many small columns
+and makes freeing a large capture cheap.
+
+Containers that grow in an arena abandon their old storage, so reserve where the final size is
+known. The abandoned bytes are reported by stats().
+*/
+class Arena : public std::pmr::memory_resource
+{
+  TP_NONCOPYABLE(Arena);
+public:
+  //################################################################################################
+  /*!
+  \param initialBlockSize - The size of the first block, later blocks grow geometrically.
+  */
+  Arena(size_t initialBlockSize=1<<16);
+
+  //################################################################################################
+  ~Arena() override;
+
+  //################################################################################################
+  //! Copy a string into the arena, the view stays valid until release().
+  std::string_view copyString(std::string_view text);
+
+  //################################################################################################
+  //! Free all of the blocks, every allocation made from the arena becomes invalid.
+  void release();
+
+  //################################################################################################
+  ArenaStats stats() const;
+
+protected:
+  //################################################################################################
+  void* do_allocate(size_t bytes, size_t alignment) override;
+
+  //################################################################################################
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+
+  //################################################################################################
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
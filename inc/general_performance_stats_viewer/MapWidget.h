@@ -7,12 +7,6 @@
 
 class QHelpEvent;
 
-namespace tp_maps
-{
-class PointsPickingResult;
-class LinesPickingResult;
-}
-
 namespace general_performance_stats_viewer
 {
 
@@ -28,10 +22,8 @@ public:
   ~MapWidget() override;
 
   //################################################################################################
-  Q_SIGNAL void pointsLayerToolTipEvent(QHelpEvent* helpEvent, tp_maps::PointsPickingResult* result);
-
-  //################################################################################################
-  Q_SIGNAL void linesLayerToolTipEvent(QHelpEvent* helpEvent, tp_maps::LinesPickingResult* result);
+  //! Emitted for tool tip events, these are answered on the CPU without a picking render.
+  Q_SIGNAL void toolTipEvent(QHelpEvent* helpEvent);
 
 protected:
   //################################################################################################
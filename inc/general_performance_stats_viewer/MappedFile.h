@@ -0,0 +1,44 @@
+#ifndef general_performance_stats_viewer_MappedFile_h
+#define general_performance_stats_viewer_MappedFile_h
+
+#include "tp_utils/Globals.h"
+
+#include <string>
+#include <string_view>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! A read only memory map of a file.
+class MappedFile
+{
+  TP_NONCOPYABLE(MappedFile);
+public:
+  //################################################################################################
+  MappedFile(const std::string& path);
+
+  //################################################################################################
+  ~MappedFile();
+
+  //################################################################################################
+  bool isOpen() const;
+
+  //################################################################################################
+  const char* data() const;
+
+  //################################################################################################
+  size_t size() const;
+
+  //################################################################################################
+  std::string_view view() const;
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef general_performance_stats_viewer_PagedFile_h
+#define general_performance_stats_viewer_PagedFile_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include <string>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! The residency of a PagedFile.
+struct PagedFileStats
+{
+  size_t fileBytes{0};
+  size_t residentBytes{0};  //!< The bytes of the tiles touched since they were last evicted.
+  size_t budgetBytes{0};
+  size_t evictedBytes{0};   //!< The total bytes evicted since the file was opened.
+};
+
+//##################################################################################################
+//! A read only memory map whose resident pages are kept within a budget.
+/*!
+The file is split into tiles and readers call touch() for the data they use. trim() evicts the
+least recently used tiles once the touched tiles exceed the budget, the OS reads them back in from
+the file if they are needed again. This lets a file much larger than RAM be browsed a few tiles at
+a time.
+
+touch() can be called from any thread, trim() from one thread at a time. Reads that race with an
+eviction are safe because the pages are backed by the file.
+*/
+class PagedFile
+{
+  TP_NONCOPYABLE(PagedFile);
+public:
+  //################################################################################################
+  /*!
+  \param path - The file to map.
+  \param tileSize - The granularity of eviction, rounded up to a multiple of 64KB.
+  */
+  PagedFile(const std::string& path, size_t tileSize=1<<18);
+
+  //################################################################################################
+  ~PagedFile();
+
+  //################################################################################################
+  bool isOpen() const;
+
+  //################################################################################################
+  const char* data() const;
+
+  //################################################################################################
+  size_t size() const;
+
+  //################################################################################################
+  //! Mark the tiles holding size bytes from data as used, pointers outside the file are ignored.
+  void touch(const void* data, size_t size) const;
+
+  //################################################################################################
+  //! The number of bytes that trim() keeps resident.
+  void setBudget(size_t budget);
+
+  //################################################################################################
+  //! Evict the least recently used tiles until the touched tiles fit in the budget.
+  void trim();
+
+  //################################################################################################
+  PagedFileStats stats() const;
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef general_performance_stats_viewer_Parallel_h
+#define general_performance_stats_viewer_Parallel_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include <functional>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! The number of worker threads to use when the caller does not specify one.
+size_t defaultThreadCount();
+
+//##################################################################################################
+//! Call closure(index) for each index in [0, count) using a pool of worker threads.
+/*!
+Indexes are handed out dynamically so uneven work is balanced across the threads. This blocks
+until all of the work is complete, if threadCount is 1 everything runs on the calling thread.
+
+\param count - The number of work items.
+\param closure - Called once for each work item, possibly concurrently.
+\param threadCount - The number of worker threads, 0 to use defaultThreadCount().
+*/
+void parallelFor(size_t count, const std::function<void(size_t)>& closure, size_t threadCount=0);
+
+}
+
+#endif
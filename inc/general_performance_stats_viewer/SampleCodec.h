@@ -0,0 +1,72 @@
+#ifndef general_performance_stats_viewer_SampleCodec_h
+#define general_performance_stats_viewer_SampleCodec_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! A view of a run of samples, the pointers are only valid until the source is modified.
+struct SampleSpan
+{
+  const uint32_t* indexes{nullptr};
+  const uint64_t* values{nullptr};
+  size_t size{0};
+
+  //################################################################################################
+  SampleSpan subspan(size_t first, size_t count) const
+  {
+    return {indexes+first, values+first, count};
+  }
+};
+
+//##################################################################################################
+//! The number of samples in each encoded block of a Trace.
+constexpr size_t sampleBlockSize = 128;
+
+//##################################################################################################
+//! The bytes that must be readable after the last encoded block, the decoder loads whole words.
+constexpr size_t sampleCodecPadding = 16;
+
+//##################################################################################################
+//! The most bytes that encodeSampleBlock() can write for count samples.
+constexpr size_t maxEncodedBlockSize(size_t count)
+{
+  return 32 + count*40;
+}
+
+//##################################################################################################
+//! Compress a block of at most 256 samples, returning the number of bytes written to out.
+/*!
+The first index and value are stored as varints, the rest as deltas from the sample before. Each
+column of deltas is stored frame of reference: the smallest delta followed by the offset of each
+delta from it, bit packed at a width chosen for the block. Deltas too wide for that width are
+patched in afterwards as exceptions, so that a single spike does not widen the whole block.
+
+Slow moving counters, gauges and the sample indexes of a trace that is written every sample
+typically pack into a few bits per sample, against 12 bytes uncompressed.
+
+\param samples - The samples to encode, 1 to 256 of them.
+\param out - Receives the encoded block, at least maxEncodedBlockSize(samples.size) bytes.
+*/
+size_t encodeSampleBlock(const SampleSpan& samples, uint8_t* out);
+
+//##################################################################################################
+//! Decompress a block written by encodeSampleBlock().
+/*!
+\param data - The start of the encoded block.
+\param end - The end of the readable data, including sampleCodecPadding bytes after the block.
+\param count - The number of samples that were encoded.
+\param indexes - Receives count indexes.
+\param values - Receives count values.
+\return false if the block would read past end, the output is then zero filled.
+*/
+bool decodeSampleBlock(const uint8_t* data, const uint8_t* end, size_t count, uint32_t* indexes, uint64_t* values);
+
+}
+
+#endif
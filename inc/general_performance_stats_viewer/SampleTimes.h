@@ -0,0 +1,75 @@
+#ifndef general_performance_stats_viewer_SampleTimes_h
+#define general_performance_stats_viewer_SampleTimes_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! Marks a sample whose time has not been found yet.
+constexpr int64_t noSampleTime = std::numeric_limits<int64_t>::min();
+
+//##################################################################################################
+//! Parse a timestamp in nanoseconds from the text that a logger wrote before a stats line.
+/*!
+The first "YYYY-MM-DD hh:mm:ss.fff" (or with a T) found in text is returned as nanoseconds since
+the epoch, otherwise the first "hh:mm:ss.fff" as nanoseconds since midnight. Text that is nothing
+but a number is taken to be seconds since the epoch. The fraction is optional in all cases.
+
+\return true if a timestamp was found.
+*/
+bool parseTimestamp(std::string_view text, int64_t& time);
+
+//##################################################################################################
+//! Finds timestamps with parseTimestamp(), optionally extracting them with a regex first.
+class TimestampParser
+{
+  TP_NONCOPYABLE(TimestampParser);
+public:
+  //################################################################################################
+  /*!
+  \param pattern - An ECMAScript regex, its first capture group (or the whole match if it has no
+  groups) is passed to parseTimestamp(). If empty the whole prefix is searched.
+  */
+  TimestampParser(const std::string& pattern=std::string());
+
+  //################################################################################################
+  ~TimestampParser();
+
+  //################################################################################################
+  //! Parse the time from the text before the start marker of a stats line.
+  bool parse(std::string_view prefix, int64_t& time) const;
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+//##################################################################################################
+//! The whole number of days to add to time so that it is not more than 12 hours before previous.
+/*!
+Timestamps that only hold the time of day wrap at midnight, this turns them back into a
+continuous time.
+*/
+int64_t sampleTimeWrap(int64_t previous, int64_t time);
+
+//##################################################################################################
+//! Make a column of sample times complete and non-decreasing.
+/*!
+Times that wrapped past midnight are unwrapped, samples with no time are interpolated from their
+neighbours or take the time of the nearest sample at either end. If no sample has a time, times is
+cleared.
+*/
+void finishSampleTimes(std::vector<int64_t>& times);
+
+}
+
+#endif
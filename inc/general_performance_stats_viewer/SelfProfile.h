@@ -0,0 +1,107 @@
+#ifndef general_performance_stats_viewer_SelfProfile_h
+#define general_performance_stats_viewer_SelfProfile_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+enum class ProfileEntryType
+{
+  Time,  //!< total is nanoseconds, count is the number of timed calls.
+  Count, //!< total is the sum of the counts added, count is the number of additions.
+  Value  //!< total is the last value set.
+};
+
+//##################################################################################################
+struct ProfileEntry
+{
+  const char* name{nullptr};
+  ProfileEntryType type{ProfileEntryType::Time};
+  uint64_t total{0};
+  uint64_t count{0};
+};
+
+//##################################################################################################
+//! Timings and counters of the viewer's own hot paths.
+/*!
+Entries are accumulated until takeSample() is called, typically a few times a second. Each sample
+can be written to a file in the format written by KeyValueLogStatsTimer, with a timestamp before
+each line, so that the viewer can open a profile of itself.
+
+Entries are looked up by name with a short linear search, so this is for coarse scopes like a
+frame or a load rather than inner loops. This is thread safe.
+*/
+class SelfProfile
+{
+  TP_NONCOPYABLE(SelfProfile);
+public:
+  //################################################################################################
+  SelfProfile();
+
+  //################################################################################################
+  ~SelfProfile();
+
+  //################################################################################################
+  //! Add a duration to a timer, name must outlive the profile, typically it is a literal.
+  void addTime(const char* name, std::chrono::steady_clock::duration duration);
+
+  //################################################################################################
+  //! Add to a counter, such as the number of vertices drawn.
+  void addCount(const char* name, uint64_t count);
+
+  //################################################################################################
+  //! Set a value that is reported until it is set again, such as the speed of the last load.
+  void setValue(const char* name, uint64_t value);
+
+  //################################################################################################
+  //! Start writing samples to path, or stop if path is empty.
+  /*!
+  \return false if the file could not be opened.
+  */
+  bool setRecordPath(const std::string& path);
+
+  //################################################################################################
+  bool recording() const;
+
+  //################################################################################################
+  //! Return the entries accumulated since the last call and reset them, writing them if recording.
+  std::vector<ProfileEntry> takeSample();
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+//##################################################################################################
+//! The profile that the viewer records into.
+SelfProfile& selfProfile();
+
+//##################################################################################################
+//! Adds the time between construction and destruction to a timer of a SelfProfile.
+class ProfileTimer
+{
+  TP_NONCOPYABLE(ProfileTimer);
+public:
+  //################################################################################################
+  ProfileTimer(const char* name, SelfProfile& profile=selfProfile());
+
+  //################################################################################################
+  ~ProfileTimer();
+
+private:
+  const char* m_name;
+  SelfProfile& m_profile;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+}
+
+#endif
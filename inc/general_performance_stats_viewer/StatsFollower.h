@@ -0,0 +1,57 @@
+#ifndef general_performance_stats_viewer_StatsFollower_h
+#define general_performance_stats_viewer_StatsFollower_h
+
+#include "general_performance_stats_viewer/TraceStore.h"
+
+#include <string>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! Parses the bytes appended to a stats file that is still being written.
+class StatsFollower
+{
+  TP_NONCOPYABLE(StatsFollower);
+public:
+  //################################################################################################
+  /*!
+  \param path - The file to follow.
+  \param offset - The number of bytes already parsed into the store, this must be on a line boundary.
+  \param timestampPattern - Passed to TimestampParser, empty to find timestamps automatically.
+  */
+  StatsFollower(const std::string& path, size_t offset, const std::string& timestampPattern=std::string());
+
+  //################################################################################################
+  ~StatsFollower();
+
+  //################################################################################################
+  const std::string& path() const;
+
+  //################################################################################################
+  //! The number of bytes parsed so far.
+  size_t offset() const;
+
+  //################################################################################################
+  //! Parse complete lines appended since the last call and append their samples to store.
+  /*!
+  At most maxBytes are read per call so that a large burst of data is spread over several calls.
+
+  \param store - The store that the earlier parts of the file were loaded into.
+  \param changedTraces - Cleared and then filled with the IDs of the traces that gained samples.
+  \param maxBytes - The maximum number of bytes to read.
+  \return false if the file has been truncated or removed and needs to be reloaded, or if the store
+  is full, see maxSampleCount.
+  */
+  bool poll(TraceStore& store, std::vector<TraceID>& changedTraces, size_t maxBytes=64<<20);
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef general_performance_stats_viewer_StatsLoadJob_h
+#define general_performance_stats_viewer_StatsLoadJob_h
+
+#include "general_performance_stats_viewer/StatsMerge.h"
+#include "general_performance_stats_viewer/TraceDiff.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! Parses a stats file on a background thread, handing out the samples a block at a time.
+/*!
+The file is parsed in blocks that start small, so that the first traces can be shown quickly, and
+grow so that later blocks make good use of the worker threads. Each block is parsed into its own
+TraceStore that can be appended to the displayed store with TraceStore::appendStore().
+
+When several files are loaded they are merged with loadStatsFiles() and handed out as one block.
+With StatsMergeMode::Difference the block holds the difference and takeTraceDeltas() the deltas.
+With StatsMergeMode::Namespaced each file is handed out as a block as soon as it has been parsed,
+see mergeBlocks().
+*/
+class StatsLoadJob
+{
+  TP_NONCOPYABLE(StatsLoadJob);
+public:
+  //################################################################################################
+  /*!
+  \param path - The file to load.
+  \param completeLinesOnly - Leave a partially written last line unparsed, used when following.
+  \param threadCount - The number of threads to parse each block with, 0 to use one per core.
+  \param timestampPattern - Passed to TimestampParser, empty to find timestamps automatically.
+  */
+  StatsLoadJob(const std::string& path,
+               bool completeLinesOnly,
+               size_t threadCount=0,
+               const std::string& timestampPattern=std::string());
+
+  //################################################################################################
+  /*!
+  \param paths - The files to load and merge.
+  \param mode - How traces with the same name in different files are combined.
+  \param threadCount - The number of threads to parse with, 0 to use one per core.
+  \param timestampPattern - Passed to TimestampParser, empty to find timestamps automatically.
+  */
+  StatsLoadJob(const std::vector<std::string>& paths,
+               StatsMergeMode mode,
+               size_t threadCount=0,
+               const std::string& timestampPattern=std::string());
+
+  //################################################################################################
+  //! Cancels the job and waits for the worker thread to exit.
+  ~StatsLoadJob();
+
+  //################################################################################################
+  //! Ask the worker to stop after the current block.
+  void cancel();
+
+  //################################################################################################
+  //! Move the blocks parsed since the last call to the end of blocks.
+  void takeBlocks(std::vector<std::unique_ptr<TraceStore>>& blocks);
+
+  //################################################################################################
+  //! Move the deltas of a StatsMergeMode::Difference load to deltas, these are ready with the block.
+  /*!
+  \return false if there are no deltas to take.
+  */
+  bool takeTraceDeltas(std::vector<TraceDelta>& deltas);
+
+  //################################################################################################
+  //! True if the blocks are files loaded side by side rather than consecutive parts of one file.
+  /*!
+  These blocks are added with TraceStore::mergeStore() rather than TraceStore::appendStore().
+  */
+  bool mergeBlocks() const;
+
+  //################################################################################################
+  //! True once the worker has exited, check failed() and takeBlocks() for the result.
+  bool finished() const;
+
+  //################################################################################################
+  //! True if a file could not be opened.
+  bool failed() const;
+
+  //################################################################################################
+  size_t fileSize() const;
+
+  //################################################################################################
+  //! The number of bytes in the blocks handed out by takeBlocks() so far.
+  size_t takenBytes() const;
+
+  //################################################################################################
+  //! The number of bytes parsed by the worker so far.
+  size_t parsedBytes() const;
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef general_performance_stats_viewer_StatsLoader_h
+#define general_performance_stats_viewer_StatsLoader_h
+
+#include "general_performance_stats_viewer/TraceStore.h"
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! Parse data using a pool of worker threads and replace the contents of store with the result.
+/*!
+The data is split on line boundaries and each chunk is parsed into its own local traces. The
+separator counts of the chunks are then prefix summed to give each chunk its global sample offset
+before the local traces are merged.
+
+The time of each sample is taken from the first line of the sample that has a timestamp before its
+start marker, see TimestampParser. If no line has one the store is left without sample times.
+
+\param data - The text to parse, typically a memory mapped file.
+\param store - Receives the parsed traces.
+\param threadCount - The number of worker threads, 0 to use one per core.
+\param timestampPattern - Passed to TimestampParser, empty to find timestamps automatically.
+\return false if the data has more than maxSampleCount samples, the store is then left empty.
+*/
+bool loadStats(std::string_view data, TraceStore& store, size_t threadCount=0, const std::string& timestampPattern=std::string());
+
+//##################################################################################################
+//! Called from the worker threads as several files are parsed, see loadStatsFileStores().
+/*!
+\param file - The index of the file in the list of paths.
+\param bytes - The number of bytes of the file parsed since the last call.
+\param finished - True on the last call for the file, its store is then complete.
+*/
+using StatsFileProgress = std::function<void(size_t file, size_t bytes, bool finished)>;
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef general_performance_stats_viewer_StatsMerge_h
+#define general_performance_stats_viewer_StatsMerge_h
+
+#include "general_performance_stats_viewer/TraceDiff.h"
+#include "general_performance_stats_viewer/StatsLoader.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! How traces with the same name in different files are combined.
+enum class StatsMergeMode
+{
+  Namespaced, //!< Each file keeps its own traces, named "<file name>/<trace name>".
+  Summed,     //!< Traces with the same name are summed at each sample index.
+  Difference  //!< The last file minus the first, see diffTraceStores().
+};
+
+//##################################################################################################
+//! The prefix given to the traces of a file when merging with StatsMergeMode::Namespaced.
+/*!
+This is the file name, or the full path if more than one of the files have the same file name.
+*/
+std::vector<std::string> statsFileLabels(const std::vector<std::string>& paths);
+
+//##################################################################################################
+//! Parse several stats files concurrently, each into its own store.
+/*!
+Each file is parsed in blocks so that a cancelled load stops part way through a file.
+
+\param paths - The files to load.
+\param stores - Replaced with one store for each path, a file that could not be opened or loaded
+gives an empty store.
+\param threadCount - The number of worker threads shared between the files in proportion to their
+sizes, 0 to use one per core.
+\param timestampPattern - Passed to TimestampParser, empty to find timestamps automatically.
+\param cancelled - If set the load stops when this becomes true, checked between blocks.
+\param progress - If set this is called as each block of each file is parsed.
+\return false if any of the files could not be opened or loaded, see loadStats(), or the load was
+cancelled.
+*/
+bool loadStatsFileStores(const std::vector<std::string>& paths,
+                         std::vector<std::unique_ptr<TraceStore>>& stores,
+                         size_t threadCount=0,
+                         const std::string& timestampPattern=std::string(),
+                         const std::atomic_bool* cancelled=nullptr,
+                         const StatsFileProgress& progress=StatsFileProgress());
+
+//##################################################################################################
+//! Parse several stats files concurrently and merge them into store.
+/*!
+The sample counters of the files are aligned, so sample N of every file is the Nth separator in that
+file. The sample times are taken from the file with the most samples. Each file is parsed into its
+own store using a share of the threads in proportion to its size, the traces are then merged with
+one job per destination trace so that no locking is needed. With StatsMergeMode::Difference the
+first file is the baseline and the last is the candidate, see loadTraceDiff().
+
+\param paths - The files to load.
+\param mode - How traces with the same name are combined.
+\param store - Cleared and then filled with the merged traces.
+\param deltas - With StatsMergeMode::Difference this receives the TraceDelta of each trace in store,
+which holds the bias to subtract from its values. Cleared for the other modes.
+\param threadCount - The number of worker threads, 0 to use one per core.
+\param timestampPattern - Passed to TimestampParser, empty to find timestamps automatically.
+\param cancelled - If set the load stops when this becomes true, see loadStatsFileStores().
+\param progress - If set this is called as each block of each file is parsed.
+\return false if any of the files could not be opened, the rest are still loaded, or if the load
+was cancelled.
+*/
+bool loadStatsFiles(const std::vector<std::string>& paths,
+                    StatsMergeMode mode,
+                    TraceStore& store,
+                    std::vector<TraceDelta>& deltas,
+                    size_t threadCount=0,
+                    const std::string& timestampPattern=std::string(),
+                    const std::atomic_bool* cancelled=nullptr,
+                    const StatsFileProgress& progress=StatsFileProgress());
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef general_performance_stats_viewer_StatsParser_h
+#define general_performance_stats_viewer_StatsParser_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include <string_view>
+#include <vector>
+#include <cstring>
+
+namespace general_performance_stats_viewer
+{
+
+//-- Markers written by tp_utils::KeyValueLogStatsTimer ---------------------------------------------
+constexpr std::string_view statsLineStart{"@LST@"};
+constexpr std::string_view statsLineEnd{"#LST#"};
+constexpr std::string_view statsSeparator{"=================="};
+constexpr std::string_view statsDelimiter{" ---> "};
+
+//##################################################################################################
+enum class StatsLineType
+{
+  Invalid,
+  Separator,
+  Value
+};
+
+//##################################################################################################
+struct StatsLine
+{
+  StatsLineType type{StatsLineType::Invalid};
+  std::string_view name;
+  size_t value{0};
+  std::string_view prefix; //!< The text before the start marker, where loggers put timestamps.
+};
+
+//##################################################################################################
+//! Parse a single line of a stats file, the returned name points into line.
+StatsLine parseStatsLine(std::string_view line);
+
+//##################################################################################################
+//! The length of data up to and including the last new line, this excludes a partially written line.
+size_t completeLinesSize(std::string_view data);
+
+//##################################################################################################
+//! Split data into roughly equal chunks that each start and end on a line boundary.
+std::vector<std::string_view> splitStatsChunks(std::string_view data, size_t chunkCount);
+
+//##################################################################################################
+//! Scan data in place calling separator() for each separator and value(name, value) for each value.
+/*!
+Nothing is copied or allocated, the names passed to value() point into data.
+
+\param data - The text to parse, typically a memory mapped file.
+\param separator - Called with no arguments for each "==================" line.
+\param value - Called with a std::string_view name and a size_t value for each data point.
+\param timestamp - Called with the text before the start marker of a separator or value line, after
+the separator or value callback for that line. Not called if there is no text before the marker.
+\param final - If false a trailing line that is not terminated with a new line will not be parsed.
+\return The number of bytes consumed, this is the start of the first unparsed line.
+*/
+template<typename SeparatorCallback, typename ValueCallback, typename TimestampCallback>
+size_t parseStats(std::string_view data,
+                  const SeparatorCallback& separator,
+                  const ValueCallback& value,
+                  const TimestampCallback& timestamp,
+                  bool final=true)
+{
+  const char* begin = data.data();
+  const char* end = begin + data.size();
+  const char* pos = begin;
+
+  while(pos<end)
+  {
+    const char* lineEnd = static_cast<const char*>(std::memchr(pos, '\n', size_t(end-pos)));
+    const char* next;
+    if(lineEnd)
+      next = lineEnd+1;
+    else if(final)
+      next = lineEnd = end;
+    else
+      break;
+
+    auto line = parseStatsLine(std::string_view(pos, size_t(lineEnd-pos)));
+    if(line.type == StatsLineType::Separator)
+      separator();
+    else if(line.type == StatsLineType::Value)
+      value(line.name, line.value);
+
+    if(line.type != StatsLineType::Invalid && !line.prefix.empty())
+      timestamp(line.prefix);
+
+    pos = next;
+  }
+
+  return size_t(pos-begin);
+}
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef general_performance_stats_viewer_TraceCache_h
+#define general_performance_stats_viewer_TraceCache_h
+
+#include "general_performance_stats_viewer/TraceLOD.h"
+
+#include <string>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! The path of the binary cache that sits next to a stats file.
+std::string traceCachePath(const std::string& path);
+
+//##################################################################################################
+//! Load the cache for a stats file if there is one that matches its current size and mtime.
+/*!
+The cache can be read into memory or left mapped, in which case the sealed blocks of the traces
+and LOD levels are paged in from the file as they are decoded. See TraceStore::pagedFile().
+
+\param path - The path of the stats file, not the cache.
+\param store - Receives the traces.
+\param lods - Receives the LOD pyramids, indexed by TraceID.
+\param parsedBytes - Receives the number of bytes of the stats file the cache represents.
+\param pagedBudget - The bytes of the cache to keep resident, or 0 to read it all into memory.
+\return true if the cache was valid and has been loaded.
+*/
+bool readTraceCache(const std::string& path, TraceStore& store, std::vector<TraceLOD>& lods, size_t& parsedBytes, size_t pagedBudget=0);
+
+//##################################################################################################
+//! Write the cache for a stats file, keyed by the current size and mtime of the file.
+/*!
+\param path - The path of the stats file, not the cache.
+\param store - The traces to write.
+\param lods - The LOD pyramids indexed by TraceID, this can be empty.
+\param parsedBytes - The number of bytes of the stats file that store represents.
+\return true if the cache was written.
+*/
+bool writeTraceCache(const std::string& path, const TraceStore& store, const std::vector<TraceLOD>& lods, size_t parsedBytes);
+
+}
+
+#endif
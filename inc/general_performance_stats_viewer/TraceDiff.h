@@ -0,0 +1,76 @@
+#ifndef general_performance_stats_viewer_TraceDiff_h
+#define general_performance_stats_viewer_TraceDiff_h
+
+#include "general_performance_stats_viewer/TraceStats.h"
+#include "general_performance_stats_viewer/StatsLoader.h"
+
+#include <atomic>
+#include <string>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! How a trace changed between a baseline and a candidate capture.
+struct TraceDelta
+{
+  TraceStats baseline;  //!< Empty if the trace is only in the candidate.
+  TraceStats candidate; //!< Empty if the trace is only in the baseline.
+
+  //! Subtracted from the values of the difference trace to give the signed difference.
+  uint64_t bias{0};
+
+  //! The relative change of the mean, positive for a regression, see rankTraceDeltas().
+  double score{0.0};
+
+  //################################################################################################
+  double max() const {return double(candidate.max) - double(baseline.max);}
+  double mean() const {return candidate.mean - baseline.mean;}
+  double p50() const {return candidate.p50 - baseline.p50;}
+  double p95() const {return candidate.p95 - baseline.p95;}
+  double p99() const {return candidate.p99 - baseline.p99;}
+  double total() const {return candidate.total - baseline.total;}
+};
+
+//##################################################################################################
+//! Compare two captures, joining their traces by name.
+/*!
+difference receives one trace for each name in either capture, holding candidate minus baseline at
+each sample index up to the last sample of the shorter capture. Where one capture has no sample at
+an index its previous value is held, as in TraceExpression. There is no difference before the first
+sample of either capture, so a trace that is only in one capture has no samples. The values of a
+trace are offset by its TraceDelta::bias so that they fit the unsigned columns. The sample times
+are taken from the candidate.
+
+The statistics and the difference of each trace are calculated in parallel, one job per trace.
+
+\return The delta of each trace in difference, indexed by TraceID.
+*/
+std::vector<TraceDelta> diffTraceStores(const TraceStore& baseline,
+                                        const TraceStore& candidate,
+                                        TraceStore& difference,
+                                        size_t threadCount=0);
+
+//##################################################################################################
+//! Load two captures concurrently and compare them with diffTraceStores().
+/*!
+The cancelled and progress arguments are passed to loadStatsFileStores().
+
+\return false if either file could not be opened or the load was cancelled.
+*/
+bool loadTraceDiff(const std::string& baselinePath,
+                   const std::string& candidatePath,
+                   TraceStore& difference,
+                   std::vector<TraceDelta>& deltas,
+                   size_t threadCount=0,
+                   const std::string& timestampPattern=std::string(),
+                   const std::atomic_bool* cancelled=nullptr,
+                   const StatsFileProgress& progress=StatsFileProgress());
+
+//##################################################################################################
+//! The indexes of deltas ordered by score, the biggest regression first.
+std::vector<size_t> rankTraceDeltas(const std::vector<TraceDelta>& deltas);
+
+}
+
+#endif
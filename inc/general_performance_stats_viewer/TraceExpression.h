@@ -0,0 +1,96 @@
+#ifndef general_performance_stats_viewer_TraceExpression_h
+#define general_performance_stats_viewer_TraceExpression_h
+
+#include "general_performance_stats_viewer/TraceStore.h"
+
+#include <string>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! The values of derived traces are stored in fixed point, multiplied by this.
+constexpr uint64_t derivedValueScale = 1000;
+
+//##################################################################################################
+//! What TraceExpression::update() changed in the derived trace.
+struct TraceExpressionUpdate
+{
+  bool changed{false};
+  size_t firstChanged{0}; //!< The position of the first sample that was replaced or appended.
+};
+
+//##################################################################################################
+//! A trace computed from the traces of a store by a small expression language.
+/*!
+An expression combines traces by name, for example rate(bytes_sent), a / b or
+sum(matching "db\..*"):
+  - A name is a letter or _ followed by letters, digits, _ . or :, other names are quoted.
+  - Numbers, + - * / and brackets.
+  - rate(x) is the change in x per second, or per sample if there are no sample times.
+  - delta(x) is the change in x from one sample to the next.
+  - sum, avg, min and max take a list of expressions, or matching "regex" for every parsed trace
+    whose whole name matches.
+
+The expression is evaluated at each sample index where any trace it reads has a sample, a trace
+without a sample at an index holds its previous value. Before its first sample a trace has no value,
+aggregates skip it and other results that need it are left out, as are results that are not finite.
+The rest are stored in a derived trace, see Trace::derived. Results can be negative, so they are
+stored offset by bias(), which grows to the next power of two when a result falls below it.
+
+Evaluation is a column at a time, each node of the expression runs as a loop over a window of
+samples, so the cost of interpreting it is paid per window rather than per sample. The sources are
+read a batch of windows at a time, one after another, and an aggregate over matching traces keeps a
+running value rather than a column for each trace, so its memory does not grow with their number.
+
+The derived trace caches the results. update() evaluates from where the previous call stopped,
+only the last sample index is evaluated again because traces can still gain samples at it. If the
+bias grows every result is evaluated again.
+*/
+class TraceExpression
+{
+  TP_NONCOPYABLE(TraceExpression);
+public:
+  //################################################################################################
+  //! Parse an expression, check error() to see if it was valid.
+  TraceExpression(const std::string& text);
+
+  //################################################################################################
+  ~TraceExpression();
+
+  //################################################################################################
+  const std::string& text() const;
+
+  //################################################################################################
+  //! A description of the first problem with the expression, empty if it parsed.
+  const std::string& error() const;
+
+  //################################################################################################
+  //! The name of the derived trace, "= " followed by the text.
+  const std::string& name() const;
+
+  //################################################################################################
+  //! The ID of the derived trace, invalidTraceID until the first call to update().
+  TraceID traceID() const;
+
+  //################################################################################################
+  //! Bring the derived trace up to date with the traces it reads, adding it on the first call.
+  TraceExpressionUpdate update(TraceStore& store);
+
+  //################################################################################################
+  //! Subtracted from the values of the derived trace to give the results in fixed point.
+  uint64_t bias() const;
+
+  //################################################################################################
+  //! Forget the derived trace, call this when the store has been cleared.
+  void reset();
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef general_performance_stats_viewer_TraceGeometry_h
+#define general_performance_stats_viewer_TraceGeometry_h
+
+#include "general_performance_stats_viewer/TraceLOD.h"
+
+#include "glm/glm.hpp"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+struct TraceVertex
+{
+  glm::vec2 position;
+  float trace;
+};
+
+//##################################################################################################
+//! Maps the raw Y of a vertex to the Y that is drawn, TracesLayer applies this in its shader.
+struct TraceYTransform
+{
+  float valueScale{1.0f}; //!< Applied to the raw Y first, this converts fixed point values.
+  float valueBias{0.0f};  //!< Subtracted after valueScale, for values stored with a bias.
+  float scale{1.0f};
+  float offset{0.0f};
+  bool log{false}; //!< Take log(1+|y|) with the sign of y before scaling.
+
+  //################################################################################################
+  float operator()(float y) const
+  {
+    y = y*valueScale - valueBias;
+    return (log?std::copysign(std::log(1.0f+std::fabs(y)), y):y)*scale + offset;
+  }
+};
+
+//##################################################################################################
+//! Maps sample indexes to X, either by the index itself or by the time of each sample.
+/*!
+A sample is drawn at (key-first)*scale in the scene, where key is the time of the sample or its
+index if there are no times. Timed vertices are built relative to origin rather than first so that
+they keep their precision when the view is far from the start of a long capture, rebaseMatrix()
+puts them back in the scene. Without times X is index*scale and origin and first are not used.
+*/
+struct TraceXAxis
+{
+  const int64_t* times{nullptr}; //!< The time of each sample index, or nullptr to use the index.
+  size_t timeCount{0};
+  int64_t first{0};
+  int64_t origin{0};
+  double scale{1.0};
+
+  //################################################################################################
+  //! The X of a vertex, relative to origin.
+  float vertexX(uint32_t index) const;
+
+  //################################################################################################
+  //! The scene X of the origin of the vertices, pass this to rebaseMatrix().
+  double originX() const;
+
+  //################################################################################################
+  //! The fractional sample index at a scene X, extrapolated beyond the samples.
+  double sceneToIndex(double x) const;
+};
+
+//##################################################################################################
+//! Move a view projection matrix so that it can draw vertices built relative to originX.
+/*!
+The translation is combined in double precision so that it does not cancel out the precision
+that building the vertices relative to the origin kept.
+*/
+glm::mat4 rebaseMatrix(const glm::mat4& matrix, double originX);
+
+//##################################################################################################
+//! The samples of a trace to draw for a view.
+struct TraceViewSamples
+{
+  size_t level{0};
+  double cropFirst{0.0};
+  double cropLast{0.0};
+  SampleSpan samples;
+};
+
+//##################################################################################################
+//! Select the LOD level and crop the samples of a trace for a view.
+/*!
+The level is chosen to give about two vertices per pixel and the samples are cropped to a window
+either side of the view, so that small pans don't need a new upload.
+
+\param viewFirst - The first sample index in the view.
+\param viewLast - The last sample index in the view.
+\param samplesPerPixel - The number of sample indexes covered by each pixel.
+\param buffer - Receives the decoded samples, the result points into this.
+*/
+TraceViewSamples traceViewSamples(const Trace& trace, const TraceLOD& lod, double viewFirst, double viewLast, double samplesPerPixel, SampleBuffer& buffer);
+
+//##################################################################################################
+//! Fill vertices with one vertex per sample, X is scaled by xScale and Y by yScale.
+/*!
+This converts the index and value columns straight into packed vertices, using SSE2 where it is
+available. Both paths give identical results.
+*/
+void buildTraceVertices(const SampleSpan& samples, float xScale, float yScale, float trace, std::vector<TraceVertex>& vertices);
+
+//##################################################################################################
+//! Fill vertices with one vertex per sample, with X mapped by xAxis and Y scaled by yScale.
+/*!
+Without times this is the same as the xScale version, with times X is looked up for each sample.
+*/
+void buildTraceVertices(const SampleSpan& samples, const TraceXAxis& xAxis, float yScale, float trace, std::vector<TraceVertex>& vertices);
+
+//##################################################################################################
+//! The scalar version of buildTraceVertices(), used as a reference and on other architectures.
+void buildTraceVerticesScalar(const SampleSpan& samples, float xScale, float yScale, float trace, std::vector<TraceVertex>& vertices);
+
+//##################################################################################################
+struct NearestSample
+{
+  size_t sample{std::numeric_limits<size_t>::max()}; //!< Index into the samples, max if none.
+  float distance{std::numeric_limits<float>::max()}; //!< Distance in pixels.
+};
+
+//##################################################################################################
+//! Find the sample of a trace nearest to a screen position, as drawn by buildTraceVertices().
+/*!
+Only samples within radius pixels horizontally are tested, these are found with a binary search on
+the sample index. If the cursor lies on the line between two samples the distance is measured to
+the line and the nearer of the two samples is returned.
+
+\param samples - The samples as they are drawn.
+\param matrix - The view projection matrix of the scene.
+\param viewport - The size of the view in pixels.
+\param position - The screen position in pixels with Y down.
+\param xAxis - The X axis passed to buildTraceVertices().
+\param yTransform - The Y transform the trace is drawn with, vertices are assumed to hold raw values.
+\param radius - The maximum distance in pixels.
+*/
+NearestSample findNearestSample(const SampleSpan& samples,
+                                const glm::mat4& matrix,
+                                const glm::vec2& viewport,
+                                const glm::vec2& position,
+                                const TraceXAxis& xAxis,
+                                const TraceYTransform& yTransform,
+                                float radius);
+
+}
+
+#endif
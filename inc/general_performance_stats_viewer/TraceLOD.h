@@ -0,0 +1,63 @@
+#ifndef general_performance_stats_viewer_TraceLOD_h
+#define general_performance_stats_viewer_TraceLOD_h
+
+#include "general_performance_stats_viewer/TraceStore.h"
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! One level of a min/max pyramid.
+/*!
+The sample index axis is split into buckets of bucketWidth, for each bucket the minimum and maximum
+samples are kept in their original order. Spikes therefore survive decimation. The samples are
+compressed in the same way as the trace.
+*/
+struct TraceLODLevel
+{
+  uint64_t bucketWidth{1};
+  Trace samples;
+};
+
+//##################################################################################################
+//! A multi resolution min/max pyramid for a single trace.
+/*!
+Level 0 is the trace itself and is not copied, each following level has buckets that are
+lodBranchFactor times wider than the one before. Levels stop once they hold few enough samples to
+always be cheap to draw.
+*/
+struct TraceLOD
+{
+  std::vector<TraceLODLevel> levels;
+  size_t sourceSize{0};
+
+  //################################################################################################
+  //! Build the pyramid or extend it with the samples appended to trace since the last update.
+  void update(const Trace& trace);
+
+  //################################################################################################
+  //! Forget the samples from size on, the next update() rebuilds the buckets they fell in.
+  /*!
+  Used when the samples from size on have been replaced, the samples before size must be unchanged.
+  */
+  void truncate(size_t size);
+
+  //################################################################################################
+  void clear();
+
+  //################################################################################################
+  //! The number of levels including level 0.
+  size_t levelCount() const;
+
+  //################################################################################################
+  //! Return the coarsest level whose buckets are no wider than samplesPerPixel.
+  size_t selectLevel(double samplesPerPixel) const;
+
+  //################################################################################################
+  //! The samples of a level, level 0 returns trace.
+  const Trace& levelSamples(const Trace& trace, size_t level) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef general_performance_stats_viewer_TraceNameIndex_h
+#define general_performance_stats_viewer_TraceNameIndex_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include <string_view>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! A case insensitive substring search over trace names using a trigram index.
+/*!
+Each trigram of each lower case name maps to the sorted list of names that contain it. A query
+intersects the lists of its trigrams, starting with the shortest, and then checks the remaining
+candidates. A query that extends the previous one only checks the previous results, so searching
+while typing stays fast with a large number of names.
+*/
+class TraceNameIndex
+{
+  TP_NONCOPYABLE(TraceNameIndex);
+public:
+  //################################################################################################
+  TraceNameIndex();
+
+  //################################################################################################
+  ~TraceNameIndex();
+
+  //################################################################################################
+  void clear();
+
+  //################################################################################################
+  //! Add a name, names are numbered in the order that they are added.
+  void add(std::string_view name);
+
+  //################################################################################################
+  size_t size() const;
+
+  //################################################################################################
+  //! Return the numbers of the names that contain query, in ascending order.
+  const std::vector<size_t>& find(std::string_view query);
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
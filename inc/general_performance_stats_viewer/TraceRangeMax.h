@@ -0,0 +1,47 @@
+#ifndef general_performance_stats_viewer_TraceRangeMax_h
+#define general_performance_stats_viewer_TraceRangeMax_h
+
+#include "general_performance_stats_viewer/TraceStore.h"
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! Answers the max value of a trace between two sample indexes, used to autoscale the visible range.
+/*!
+The table is built on the compressed blocks of the trace, a sparse table holds the max of every run
+of 2^k blocks. A query finds the samples with two binary searches, covers the whole blocks with two
+table lookups and decodes the partial blocks at either end. Like TraceLOD this can be extended in
+place as samples are appended.
+*/
+struct TraceRangeMax
+{
+  //! table[k][b] is the max of blocks b to b+2^k-1.
+  std::vector<std::vector<uint64_t>> table;
+  size_t sourceSize{0};
+
+  //################################################################################################
+  //! Build the table or extend it with the samples appended to trace since the last update.
+  void update(const Trace& trace);
+
+  //################################################################################################
+  //! Forget the samples from size on, the next update() rebuilds the blocks they are in.
+  /*!
+  Used when the samples from size on have been replaced, the samples before size must be unchanged.
+  */
+  void truncate(size_t size);
+
+  //################################################################################################
+  void clear();
+
+  //################################################################################################
+  //! The max value of the samples with indexes in [firstIndex, lastIndex], 0 if there are none.
+  /*!
+  Samples appended to trace since the last update() are ignored.
+  */
+  uint64_t max(const Trace& trace, uint64_t firstIndex, uint64_t lastIndex) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef general_performance_stats_viewer_TraceStats_h
+#define general_performance_stats_viewer_TraceStats_h
+
+#include "general_performance_stats_viewer/TraceStore.h"
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! A mergeable histogram of uint64 values with log spaced buckets.
+/*!
+Values below 64 are counted exactly, larger values are bucketed by their top 7 significant bits so
+quantiles have a relative error below 1/64. The number of buckets is fixed, so memory use does not
+grow with the number of values.
+*/
+class QuantileSketch
+{
+public:
+  //################################################################################################
+  QuantileSketch();
+
+  //################################################################################################
+  void add(uint64_t value);
+
+  //################################################################################################
+  void add(const uint64_t* values, size_t count);
+
+  //################################################################################################
+  void merge(const QuantileSketch& other);
+
+  //################################################################################################
+  //! Return the approximate value at quantile q in [0, 1], 0 if the sketch is empty.
+  double quantile(double q) const;
+
+  //################################################################################################
+  uint64_t count() const;
+
+  //################################################################################################
+  void clear();
+
+private:
+  std::vector<uint64_t> m_counts;
+  uint64_t m_count{0};
+  uint64_t m_min{std::numeric_limits<uint64_t>::max()};
+  uint64_t m_max{0};
+};
+
+//##################################################################################################
+//! Aggregate statistics of a run of samples.
+struct TraceStats
+{
+  size_t count{0};
+  uint64_t min{0};
+  uint64_t max{0};
+  double total{0.0};
+  double mean{0.0};
+  double stddev{0.0};
+  double p50{0.0};
+  double p95{0.0};
+  double p99{0.0};
+  double rate{0.0}; //!< The mean change in value per sample index, from the first to the last sample.
+};
+
+//##################################################################################################
+//! Calculate the statistics of samples in a single pass over the value column.
+TraceStats computeTraceStats(const SampleSpan& samples);
+
+//##################################################################################################
+//! Calculate the statistics of the samples of trace from first to first+count, a span at a time.
+TraceStats computeTraceStats(const Trace& trace, size_t first, size_t count);
+
+}
+
+#endif
@@ -0,0 +1,347 @@
+#ifndef general_performance_stats_viewer_TraceStore_h
+#define general_performance_stats_viewer_TraceStore_h
+
+#include "general_performance_stats_viewer/Arena.h"
+#include "general_performance_stats_viewer/PagedFile.h"
+#include "general_performance_stats_viewer/SampleCodec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! Dense integer ID of an interned trace name.
+using TraceID = uint32_t;
+constexpr TraceID invalidTraceID = std::numeric_limits<TraceID>::max();
+
+//##################################################################################################
+//! Sample indexes are 32 bit, this is the most samples that a store can hold.
+constexpr size_t maxSampleCount = std::numeric_limits<uint32_t>::max();
+
+//##################################################################################################
+//! A sealed block of sampleBlockSize samples in Trace::encoded.
+struct SampleBlock
+{
+  uint64_t offset{0}; //!< The offset of the encoded block in Trace::encoded.
+  uint64_t maxValue{0};
+  uint32_t firstIndex{0};
+  uint32_t lastIndex{0};
+};
+
+//##################################################################################################
+//! Storage for samples decoded from a Trace, reused between calls to avoid allocating.
+struct SampleBuffer
+{
+  std::vector<uint32_t> indexes;
+  std::vector<uint64_t> values;
+};
+
+//##################################################################################################
+//! Sealed blocks that are read in place from a PagedFile rather than held in memory.
+struct PagedSamples
+{
+  std::shared_ptr<const PagedFile> file;
+  const SampleBlock* blocks{nullptr};
+  size_t blockCount{0};
+  const uint8_t* encoded{nullptr};
+  size_t encodedSize{0};
+};
+
+//##################################################################################################
+//! The samples of a single trace, compressed a block at a time.
+/*!
+Each sample has an index, the sample counter (the number of separators seen before the value), and
+a value. Sample indexes are 32 bit, values stay 64 bit because KeyValueLogStatsTimer can emit
+counters that overflow 32 bits.
+
+Samples are appended to the uncompressed tail columns and every sampleBlockSize samples the tail is
+sealed into a block by encodeSampleBlock(). Readers decode just the samples they need with
+samples(), crop() or forEachSpan(), so the whole trace is never held uncompressed. The columns of
+the traces in a TraceStore are allocated from its arena.
+
+The sealed blocks of a trace loaded from the cache can instead be paged in from the mapped file,
+only the blocks that are decoded are read from disk. Blocks sealed after that are held in blocks and
+encoded and numbered after the paged blocks, so a followed file is not copied into memory. The paged
+blocks are only copied into memory if the trace is truncated into them.
+*/
+struct Trace
+{
+  std::string_view name;
+  uint64_t maxValue{1};
+  std::pmr::vector<SampleBlock> blocks;
+  std::pmr::vector<uint8_t> encoded; //!< The sealed blocks followed by sampleCodecPadding bytes.
+  std::pmr::vector<uint32_t> tailIndexes;
+  std::pmr::vector<uint64_t> tailValues;
+  PagedSamples paged; //!< If paged.file is set this holds the first sealed blocks.
+  bool derived{false}; //!< Computed by a TraceExpression rather than parsed, these are not cached.
+
+  //################################################################################################
+  Trace(std::pmr::memory_resource* resource=std::pmr::get_default_resource()):
+    blocks(resource),
+    encoded(resource),
+    tailIndexes(resource),
+    tailValues(resource)
+  {
+
+  }
+
+  //################################################################################################
+  size_t size() const
+  {
+    return blockCount()*sampleBlockSize + tailIndexes.size();
+  }
+
+  //################################################################################################
+  //! The number of sealed blocks, paged and in memory.
+  size_t blockCount() const
+  {
+    return pagedBlockCount() + blocks.size();
+  }
+
+  //################################################################################################
+  //! The number of sealed blocks read from the paged file, these come before those in blocks.
+  size_t pagedBlockCount() const
+  {
+    return paged.file?paged.blockCount:0;
+  }
+
+  //################################################################################################
+  //! The sealed block b, either paged or in memory.
+  const SampleBlock& block(size_t b) const
+  {
+    size_t pagedCount = pagedBlockCount();
+    return (b<pagedCount)?paged.blocks[b]:blocks[b-pagedCount];
+  }
+
+  //################################################################################################
+  //! The first sealed block that predicate is false for, it must be true for a prefix of the blocks.
+  template<typename Predicate>
+  size_t findBlock(const Predicate& predicate) const
+  {
+    size_t pagedCount = pagedBlockCount();
+    auto b = size_t(std::partition_point(paged.blocks, paged.blocks+pagedCount, predicate) - paged.blocks);
+    if(b<pagedCount)
+      return b;
+
+    return pagedCount + size_t(std::partition_point(blocks.begin(), blocks.end(), predicate) - blocks.begin());
+  }
+
+  //################################################################################################
+  //! Page the sealed blocks from a mapped file, replacing those in memory.
+  void setPaged(PagedSamples&& samples);
+
+  //################################################################################################
+  //! Copy the paged blocks into memory ahead of those sealed since, so that all of them are in blocks.
+  void unpage();
+
+  //################################################################################################
+  void append(uint32_t index, uint64_t value)
+  {
+    tailIndexes.push_back(index);
+    tailValues.push_back(value);
+
+    if(value>maxValue)
+      maxValue = value;
+
+    if(tailIndexes.size()==sampleBlockSize)
+      sealTail();
+  }
+
+  //################################################################################################
+  //! Append samples, adding indexOffset to each index.
+  void append(const SampleSpan& samples, uint32_t indexOffset=0);
+
+  //################################################################################################
+  //! Replace the samples, allocating the columns at their final size.
+  void assign(const SampleSpan& samples);
+
+  //################################################################################################
+  //! Replace the samples with a copy of those in other, paged blocks are shared rather than copied.
+  void assign(const Trace& other);
+
+  //################################################################################################
+  //! Remove the samples from size onwards, maxValue is not reduced.
+  void truncate(size_t size);
+
+  //################################################################################################
+  void clear();
+
+  //################################################################################################
+  //! Release the spare capacity of the columns, only worth it when they are not in an Arena.
+  void shrinkToFit();
+
+  //################################################################################################
+  //! Decode the sealed block b into sampleBlockSize indexes and values.
+  void decodeBlock(size_t b, uint32_t* indexes, uint64_t* values) const;
+
+  //################################################################################################
+  //! The samples from first to first+count.
+  /*!
+  Samples that are all in the tail are returned in place, others are decoded into buffer. Either
+  way the span is valid until the trace or the buffer is modified.
+  */
+  SampleSpan samples(size_t first, size_t count, SampleBuffer& buffer) const;
+
+  //################################################################################################
+  //! All of the samples, prefer forEachSpan() for long traces.
+  SampleSpan samples(SampleBuffer& buffer) const
+  {
+    return samples(0, size(), buffer);
+  }
+
+  //################################################################################################
+  //! The position of the first sample with an index not less than index.
+  size_t lowerBound(uint64_t index) const;
+
+  //################################################################################################
+  //! The position of the first sample with an index greater than index.
+  size_t upperBound(uint64_t index) const;
+
+  //################################################################################################
+  //! The samples with indexes in [firstIndex, lastIndex].
+  SampleSpan crop(uint64_t firstIndex, uint64_t lastIndex, SampleBuffer& buffer) const;
+
+  //################################################################################################
+  //! Call closure with consecutive spans covering the samples from first to first+count.
+  /*!
+  The samples are decoded a few blocks at a time so that the memory used does not grow with the
+  length of the trace.
+  */
+  template<typename Closure>
+  void forEachSpan(size_t first, size_t count, SampleBuffer& buffer, const Closure& closure) const
+  {
+    constexpr size_t spanSize = 64*sampleBlockSize;
+    for(size_t end=first+count; first<end;)
+    {
+      size_t next = std::min(end, (first/spanSize+1)*spanSize);
+      closure(samples(first, next-first, buffer));
+      first = next;
+    }
+  }
+
+private:
+  //################################################################################################
+  //! Encode the full tail as a new block.
+  void sealTail();
+};
+
+//##################################################################################################
+//! Interned trace names and the columnar samples of each trace.
+/*!
+Names, columns and the lookup tables live in an Arena that clear() releases in one go, so a reload
+does not free each trace individually.
+*/
+class TraceStore
+{
+  TP_NONCOPYABLE(TraceStore);
+public:
+  //################################################################################################
+  TraceStore();
+
+  //################################################################################################
+  ~TraceStore();
+
+  //################################################################################################
+  //! Return the ID of name, adding a new empty trace if this is the first time it has been seen.
+  TraceID addTrace(std::string_view name);
+
+  //################################################################################################
+  //! Return the ID of name or invalidTraceID.
+  TraceID findTrace(std::string_view name) const;
+
+  //################################################################################################
+  size_t traceCount() const;
+
+  //################################################################################################
+  const Trace& trace(TraceID traceID) const;
+
+  //################################################################################################
+  Trace& trace(TraceID traceID);
+
+  //################################################################################################
+  //! Append a sample to the end of a trace, keeping the maximums and point count up to date.
+  void appendSample(TraceID traceID, uint32_t index, uint64_t value);
+
+  //################################################################################################
+  //! Append the traces of other, whose sample indexes start after the samples already in this store.
+  /*!
+  Sample times are appended too, unwrapping a time of day that passed midnight. If this store has
+  samples but no times the times of other are dropped, so a store never mixes the two.
+
+  \param other - Samples parsed from the data that follows the data in this store.
+  \param changedTraces - The IDs of the traces that gained samples are appended to this.
+  */
+  void appendStore(const TraceStore& other, std::vector<TraceID>& changedTraces);
+
+  //################################################################################################
+  //! Add the traces of other alongside those in this store, sample N of other is sample N here.
+  /*!
+  This is used for files that were loaded side by side. The sample times are taken from other if it
+  has more samples, as in loadStatsFiles().
+
+  \param other - Traces that are not already in this store.
+  \param changedTraces - The IDs of the traces that were added are appended to this.
+  */
+  void mergeStore(const TraceStore& other, std::vector<TraceID>& changedTraces);
+
+  //################################################################################################
+  //! The number of separators seen, this is one past the largest sample index.
+  size_t sampleCount() const;
+
+  //################################################################################################
+  void setSampleCount(size_t sampleCount);
+
+  //################################################################################################
+  //! The time in nanoseconds of each sample index.
+  /*!
+  This is empty if the stats have no timestamps, otherwise it holds sampleCount()+1 times that
+  never decrease. See finishSampleTimes().
+  */
+  const std::vector<int64_t>& sampleTimes() const;
+
+  //################################################################################################
+  void setSampleTimes(std::vector<int64_t>&& sampleTimes);
+
+  //################################################################################################
+  //! The largest value across all parsed traces.
+  uint64_t maxValue() const;
+
+  //################################################################################################
+  //! The total number of samples across all parsed traces.
+  size_t pointCount() const;
+
+  //################################################################################################
+  //! Recalculate pointCount() and maxValue() after traces have been modified.
+  void updateTotals();
+
+  //################################################################################################
+  //! The memory used by the names and columns of the traces.
+  ArenaStats memoryStats() const;
+
+  //################################################################################################
+  //! Keep the file that paged traces read their blocks from, and trim it to its budget.
+  void setPagedFile(const std::shared_ptr<PagedFile>& pagedFile);
+
+  //################################################################################################
+  //! The file that traces are paged from, or null if they are all in memory.
+  const std::shared_ptr<PagedFile>& pagedFile() const;
+
+  //################################################################################################
+  void clear();
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
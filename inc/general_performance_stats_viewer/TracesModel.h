@@ -0,0 +1,75 @@
+#ifndef general_performance_stats_viewer_TracesModel_h
+#define general_performance_stats_viewer_TracesModel_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include <QAbstractListModel>
+#include <QColor>
+
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! A checkable list of trace names for a QListView, row N is row N of the traces layer.
+/*!
+Check states can be changed in bulk, each bulk change emits a single dataChanged() and a single
+checkedChanged() no matter how many rows it touches.
+*/
+class TracesModel : public QAbstractListModel
+{
+  Q_OBJECT
+public:
+  //################################################################################################
+  TracesModel(QObject* parent=nullptr);
+
+  //################################################################################################
+  ~TracesModel() override;
+
+  //################################################################################################
+  //! Replace all of the rows, this resets the model.
+  void setRows(std::vector<QString>&& names, std::vector<QColor>&& colors, std::vector<bool>&& checked);
+
+  //################################################################################################
+  size_t size() const;
+
+  //################################################################################################
+  const QString& name(size_t row) const;
+
+  //################################################################################################
+  bool checked(size_t row) const;
+
+  //################################################################################################
+  //! Set the check state of some rows.
+  void setChecked(const std::vector<size_t>& rows, bool checked);
+
+  //################################################################################################
+  //! Set the check state of every row, checked must have one entry per row.
+  void setChecked(const std::vector<bool>& checked);
+
+  //################################################################################################
+  //! Emitted once per change with the rows whose check state changed, in ascending order.
+  Q_SIGNAL void checkedChanged(const std::vector<size_t>& rows);
+
+  //################################################################################################
+  int rowCount(const QModelIndex& parent=QModelIndex()) const override;
+
+  //################################################################################################
+  QVariant data(const QModelIndex& index, int role=Qt::DisplayRole) const override;
+
+  //################################################################################################
+  bool setData(const QModelIndex& index, const QVariant& value, int role=Qt::EditRole) override;
+
+  //################################################################################################
+  Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
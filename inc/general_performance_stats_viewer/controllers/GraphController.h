@@ -7,7 +7,8 @@ namespace general_performance_stats_viewer
 {
 
 //##################################################################################################
-class TP_MAPS_SHARED_EXPORT GraphController : public tp_maps::Controller
+//! An orthographic controller for graphs, the wheel zooms X and holding the right button zooms Y.
+class GraphController : public tp_maps::Controller
 {
 public:
   //################################################################################################
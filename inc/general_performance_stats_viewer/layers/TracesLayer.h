@@ -0,0 +1,112 @@
+#ifndef general_performance_stats_viewer_TracesLayer_h
+#define general_performance_stats_viewer_TracesLayer_h
+
+#include "general_performance_stats_viewer/TraceGeometry.h"
+
+#include "tp_maps/Layer.h"
+
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! Draws the lines and points of every trace with one vertex buffer and one draw call each.
+/*!
+The vertices of all traces are packed into a single vertex buffer, each trace has a slot in the
+buffer with some spare capacity so that it can grow without moving. Vertices hold raw values, the
+color and Y transform of each trace are looked up from a small table texture, and visibility and
+draw order are expressed through the index buffer. Changing any of these never re-uploads
+vertices, and changing the vertices of a trace only uploads the part that differs from what is
+already on the GPU.
+
+Each trace keeps the X of every 256th vertex, at render time a binary search finds the chunks that
+are in view and only their ranges of the index buffers are drawn. Panning and zooming therefore
+cost in proportion to what is on screen rather than the length of the traces.
+*/
+class TracesLayer : public tp_maps::Layer
+{
+public:
+  //################################################################################################
+  TracesLayer();
+
+  //################################################################################################
+  ~TracesLayer() override;
+
+  //################################################################################################
+  //! Set the number of traces, this clears the vertices of all traces.
+  void setTraceCount(size_t traceCount);
+
+  //################################################################################################
+  size_t traceCount() const;
+
+  //################################################################################################
+  //! Replace the vertices of a trace, the trace member of each vertex must be set to trace.
+  /*!
+  The vertices must be in order of increasing X, this is used to cull them against the view.
+  */
+  void setTraceVertices(size_t trace, const std::vector<TraceVertex>& vertices);
+
+  //################################################################################################
+  void setTraceColor(size_t trace, const glm::vec4& color);
+
+  //################################################################################################
+  //! Set how the value of a trace is drawn, y*scale+offset or log(1+y)*scale+offset.
+  void setTraceYTransform(size_t trace, float scale, float offset);
+
+  //################################################################################################
+  //! Convert the raw Y of a trace to the value y*valueScale-valueBias before the Y transform.
+  /*!
+  This is used for fixed point values and for values stored with a bias. Negative values are drawn
+  as -log(1+|y|) on a log scale.
+  */
+  void setTraceValueScale(size_t trace, float valueScale, float valueBias=0.0f);
+
+  //################################################################################################
+  //! The transform applied to the Y of a trace, including the log scale.
+  TraceYTransform traceYTransform(size_t trace) const;
+
+  //################################################################################################
+  //! Draw log(1+|y|) with the sign of y rather than y for every trace.
+  void setLogScale(bool logScale);
+
+  //################################################################################################
+  bool logScale() const;
+
+  //################################################################################################
+  void setTraceVisible(size_t trace, bool visible);
+
+  //################################################################################################
+  bool traceVisible(size_t trace) const;
+
+  //################################################################################################
+  //! Move a trace to the end of the draw order so that it is drawn on top.
+  void bringToFront(size_t trace);
+
+  //################################################################################################
+  //! The traces in the order they are drawn, the last is on top.
+  const std::vector<size_t>& drawOrder() const;
+
+  //################################################################################################
+  //! The scene X that vertex X is relative to, see TraceXAxis::originX().
+  void setXOrigin(double xOrigin);
+
+  //################################################################################################
+  void setPointSize(float pointSize);
+
+protected:
+  //################################################################################################
+  void render(tp_maps::RenderInfo& renderInfo) override;
+
+  //################################################################################################
+  void invalidateBuffers() override;
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
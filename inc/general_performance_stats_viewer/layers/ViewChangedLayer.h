@@ -0,0 +1,39 @@
+#ifndef general_performance_stats_viewer_ViewChangedLayer_h
+#define general_performance_stats_viewer_ViewChangedLayer_h
+
+#include "general_performance_stats_viewer/Globals.h"
+
+#include "tp_maps/Layer.h"
+
+#include <functional>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+//! Draws nothing, calls viewChanged at the start of a frame if the view matrix or map size changed.
+/*!
+Add this before the layers that depend on the view so that they can be updated in the same frame.
+*/
+class ViewChangedLayer : public tp_maps::Layer
+{
+public:
+  //################################################################################################
+  ViewChangedLayer(const std::function<void(const glm::mat4&)>& viewChanged);
+
+  //################################################################################################
+  ~ViewChangedLayer() override;
+
+protected:
+  //################################################################################################
+  void render(tp_maps::RenderInfo& renderInfo) override;
+
+private:
+  struct Private;
+  friend struct Private;
+  Private* d;
+};
+
+}
+
+#endif
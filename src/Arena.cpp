@@ -0,0 +1,138 @@
+#include "general_performance_stats_viewer/Arena.h"
+
+#include "tp_utils/RefCount.h"
+
+#include <cstring>
+#include <mutex>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//##################################################################################################
+//! Counts the blocks that the monotonic buffer takes from the system.
+class BlockCounter_lt : public std::pmr::memory_resource
+{
+public:
+  size_t blockCount{0};
+  size_t reservedBytes{0};
+
+protected:
+  //################################################################################################
+  void* do_allocate(size_t bytes, size_t alignment) override
+  {
+    void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    blockCount++;
+    reservedBytes += bytes;
+    return p;
+  }
+
+  //################################################################################################
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override
+  {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    blockCount--;
+    reservedBytes -= bytes;
+  }
+
+  //################################################################################################
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+}
+
+//##################################################################################################
+struct Arena::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::Arena::Private");
+  TP_NONCOPYABLE(Private);
+
+  //The monotonic buffer is not thread safe, the loaders fill traces from several threads.
+  mutable std::mutex mutex;
+  BlockCounter_lt blocks;
+  std::pmr::monotonic_buffer_resource buffer;
+
+  size_t allocatedBytes{0};
+  size_t abandonedBytes{0};
+  size_t allocationCount{0};
+
+  //################################################################################################
+  Private(size_t initialBlockSize):
+    buffer(initialBlockSize, &blocks)
+  {
+
+  }
+};
+
+//##################################################################################################
+Arena::Arena(size_t initialBlockSize):
+  d(new Private(initialBlockSize))
+{
+
+}
+
+//##################################################################################################
+Arena::~Arena()
+{
+  delete d;
+}
+
+//##################################################################################################
+std::string_view Arena::copyString(std::string_view text)
+{
+  auto chars = static_cast<char*>(allocate(text.size(), 1));
+  std::memcpy(chars, text.data(), text.size());
+  return std::string_view(chars, text.size());
+}
+
+//##################################################################################################
+void Arena::release()
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->buffer.release();
+  d->allocatedBytes = 0;
+  d->abandonedBytes = 0;
+  d->allocationCount = 0;
+}
+
+//##################################################################################################
+ArenaStats Arena::stats() const
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  ArenaStats stats;
+  stats.blockCount      = d->blocks.blockCount;
+  stats.reservedBytes   = d->blocks.reservedBytes;
+  stats.allocatedBytes  = d->allocatedBytes;
+  stats.abandonedBytes  = d->abandonedBytes;
+  stats.allocationCount = d->allocationCount;
+  return stats;
+}
+
+//##################################################################################################
+void* Arena::do_allocate(size_t bytes, size_t alignment)
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->allocatedBytes += bytes;
+  d->allocationCount++;
+  return d->buffer.allocate(bytes, alignment);
+}
+
+//##################################################################################################
+void Arena::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+  TP_UNUSED(p);
+  TP_UNUSED(alignment);
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->abandonedBytes += bytes;
+}
+
+//##################################################################################################
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+  return this == &other;
+}
+
+}
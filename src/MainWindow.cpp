@@ -1,41 +1,96 @@
 #include "general_performance_stats_viewer/MainWindow.h"
 #include "general_performance_stats_viewer/MapWidget.h"
-
-#include "tp_maps/controllers/GraphController.h"
-#include "tp_maps/layers/PointsLayer.h"
-#include "tp_maps/layers/LinesLayer.h"
-#include "tp_maps/textures/DefaultSpritesTexture.h"
-#include "tp_maps/picking_results/PointsPickingResult.h"
-#include "tp_maps/picking_results/LinesPickingResult.h"
+#include "general_performance_stats_viewer/StatsFollower.h"
+#include "general_performance_stats_viewer/StatsLoadJob.h"
+#include "general_performance_stats_viewer/TraceCache.h"
+#include "general_performance_stats_viewer/TraceDiff.h"
+#include "general_performance_stats_viewer/TraceExpression.h"
+#include "general_performance_stats_viewer/TraceGeometry.h"
+#include "general_performance_stats_viewer/TraceLOD.h"
+#include "general_performance_stats_viewer/TraceNameIndex.h"
+#include "general_performance_stats_viewer/TraceRangeMax.h"
+#include "general_performance_stats_viewer/TraceStats.h"
+#include "general_performance_stats_viewer/TracesModel.h"
+#include "general_performance_stats_viewer/Parallel.h"
+#include "general_performance_stats_viewer/SelfProfile.h"
+#include "general_performance_stats_viewer/layers/ViewChangedLayer.h"
+
+#include "general_performance_stats_viewer/layers/TracesLayer.h"
+
+#include "general_performance_stats_viewer/controllers/GraphController.h"
 
 #include "tp_utils/DebugUtils.h"
 
 #include <QBoxLayout>
 #include <QSplitter>
-#include <QListWidget>
+#include <QListView>
+#include <QItemSelectionModel>
 #include <QPushButton>
 #include <QCheckBox>
 #include <QLineEdit>
 #include <QFileDialog>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QMenu>
 #include <QCursor>
 #include <QToolTip>
 #include <QHelpEvent>
-
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QProgressBar>
+#include <QLabel>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QHeaderView>
+
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <unordered_map>
 
 namespace general_performance_stats_viewer
 {
 
 namespace
 {
-struct TraceDetails_lt
+constexpr size_t invalidLevel = std::numeric_limits<size_t>::max();
+
+//The row of a trace that is not in the list, a derived trace whose expression was removed.
+constexpr size_t invalidRow = std::numeric_limits<size_t>::max();
+
+//Smaller files parse faster than the cache can be written.
+constexpr size_t minimumCachedFileSize = 16 << 20;
+
+//The number of traces to build vertices for at a time, this bounds the size of the staging buffers.
+constexpr size_t geometryBatchSize = 256;
+
+//The number of traces shown by "Show biggest regressions".
+constexpr size_t regressionCount = 10;
+
+enum class StatsRange
 {
-  size_t maxValue{1};
-  std::vector<std::pair<size_t, size_t>> points;
+  Capture,
+  Visible
 };
+
+//##################################################################################################
+//! True if the first size bytes of the file end on a line boundary, where a follower can start.
+bool endsOnLine(const std::string& path, size_t size)
+{
+  if(size==0)
+    return true;
+
+  std::ifstream file(path, std::ios::binary);
+  char c=0;
+  return file.seekg(std::streamoff(size-1)) && file.get(c) && c=='\n';
+}
+
+const QStringList statsColumns{"Name", "Count", "Min", "Max", "Mean", "Std dev", "p50", "p95", "p99", "Rate", "Total"};
+const QStringList diffColumns{"Name", "Mean change %", "Max", "Mean", "p50", "p95", "p99", "Total", "Baseline count", "Candidate count"};
 }
 
 //##################################################################################################
@@ -46,21 +101,87 @@ struct MainWindow::Private
 
   MainWindow* q;
 
-  QListWidget* listWidget{nullptr};
-  QMenu* listWidgetMenu{nullptr};
+  QListView* listView{nullptr};
+  TracesModel* tracesModel{nullptr};
+  TraceNameIndex nameIndex;
+  QMenu* listViewMenu{nullptr};
   QCheckBox* normalizeIndividual{nullptr};
+  QCheckBox* logScale{nullptr};
+  QCheckBox* autoscale{nullptr};
+  QCheckBox* timeAxis{nullptr};
+  QLineEdit* timestampPattern{nullptr};
+  QComboBox* mergeMode{nullptr};
 
   general_performance_stats_viewer::MapWidget* mapWidget{nullptr};
-  tp_maps::GraphController* graphController{nullptr};
-
-  std::vector<tp_maps::Layer*> pointLayers;
-  std::vector<tp_maps::Layer*> lineLayers;
-  std::vector<std::vector<size_t>> originalValues;
-
-  size_t i{0};
-  size_t maxValue{1};
-  size_t pointCount{0};
-  std::map<std::string, std::shared_ptr<TraceDetails_lt>> traces;
+  GraphController* graphController{nullptr};
+
+  QCheckBox* follow{nullptr};
+  QFileSystemWatcher* fileWatcher{nullptr};
+  QTimer* followTimer{nullptr};
+
+  QComboBox* statsRange{nullptr};
+  QTableWidget* statsTable{nullptr};
+  QTimer* statsTimer{nullptr};
+
+  //Statistics of the whole of each trace by TraceID, and the trace size they were calculated for.
+  std::vector<TraceStats> captureStats;
+  std::vector<size_t> captureStatsSizes;
+  std::vector<TraceStats> rowStats;
+
+  QProgressBar* loadProgress{nullptr};
+  QPushButton* cancelLoad{nullptr};
+  QTimer* loadTimer{nullptr};
+  QLabel* memoryStats{nullptr};
+  QSpinBox* pagedBudget{nullptr};
+  std::chrono::steady_clock::time_point loadStart;
+
+  QCheckBox* showProfile{nullptr};
+  QPushButton* recordProfile{nullptr};
+  QLabel* profileOverlay{nullptr};
+  QTimer* profileTimer{nullptr};
+
+  TracesLayer* tracesLayer{nullptr};
+  std::vector<TraceID> rowTraces;
+  std::vector<size_t> traceRows;
+  std::vector<glm::vec4> rowColors;
+  std::vector<std::string> rowNames;
+  std::vector<size_t> rowLevels;
+  std::vector<std::pair<double, double>> rowCrops;
+  std::vector<TraceLOD> traceLODs;
+  std::vector<TraceRangeMax> traceRangeMaxes;
+  std::vector<uint64_t> rowMaxes;
+
+  //The visible range in sample indexes.
+  double viewFirst{0.0};
+  double viewLast{1.0};
+  double samplesPerPixel{1.0};
+  glm::mat4 viewMatrix{1.0f};
+
+  std::vector<std::vector<TraceVertex>> batchVertices;
+  std::vector<size_t> changedRows;
+
+  TraceStore store;
+  std::string path;
+  size_t loadedBytes{0};
+
+  //How sample indexes map to X, see xAxis().
+  double xScale{1.0};
+  int64_t xFirst{0};
+  int64_t xOrigin{0};
+
+  std::unique_ptr<StatsFollower> follower;
+  std::vector<TraceID> changedTraces;
+  bool fileChanged{false};
+
+  std::unique_ptr<StatsLoadJob> loadJob;
+  std::vector<std::unique_ptr<TraceStore>> loadedBlocks;
+
+  //In diff mode store holds the difference of two captures and traceDeltas the delta of each trace.
+  bool diffMode{false};
+  std::vector<TraceDelta> traceDeltas;
+
+  //Evaluated into derived traces in the store, the expressions are kept when another file is loaded.
+  std::vector<std::unique_ptr<TraceExpression>> derivedTraces;
 
   //################################################################################################
   Private(MainWindow* q_):
@@ -72,288 +193,1205 @@ struct MainWindow::Private
   //################################################################################################
   void load()
   {
-    auto path = QFileDialog::getOpenFileName(q, "Select process stats file");
-    if(path.isEmpty())
+    auto selected = QFileDialog::getOpenFileNames(q, "Select process stats files");
+    if(selected.isEmpty())
       return;
 
-    std::string lineStart = "@LST@";
-    std::string lineEnd = "#LST#";
+    std::vector<std::string> paths;
+    for(const auto& path : selected)
+      paths.push_back(path.toStdString());
+
+    loadFiles(paths);
+  }
 
-    i=0;
-    maxValue = 1;
-    pointCount = 0;
-    traces.clear();
+  //################################################################################################
+  void compare()
+  {
+    auto baseline = QFileDialog::getOpenFileName(q, "Select the baseline stats file");
+    if(baseline.isEmpty())
+      return;
 
-    std::ifstream infile(path.toStdString());
-    for(std::string line; std::getline(infile, line);)
+    auto candidate = QFileDialog::getOpenFileName(q, "Select the candidate stats file");
+    if(candidate.isEmpty())
+      return;
+
+    loadDiff(baseline.toStdString(), candidate.toStdString());
+  }
+
+  //################################################################################################
+  //! Show candidate minus baseline for each trace, the deltas are ranked in the statistics table.
+  void loadDiff(const std::string& baselinePath, const std::string& candidatePath)
+  {
+    ProfileTimer timer("load");
+    stopFollowing();
+    stopLoading();
+    clearTraces();
+    path.clear();
+    setDiffMode(true);
+
+    store.clear();
+    traceLODs.clear();
+    traceRangeMaxes.clear();
+    loadedBytes = 0;
+
+    std::vector<std::string> paths{baselinePath, candidatePath};
+    startLoading(std::make_unique<StatsLoadJob>(paths, StatsMergeMode::Difference, 0, timestampPattern->text().toStdString()));
+  }
+
+  //################################################################################################
+  //! Switch the statistics table and scaling between single captures and differences.
+  void setDiffMode(bool diffMode_)
+  {
+    traceDeltas.clear();
+    if(diffMode == diffMode_)
+      return;
+
+    diffMode = diffMode_;
+    const auto& columns = diffMode?diffColumns:statsColumns;
+    statsTable->clear();
+    statsTable->setRowCount(0);
+    statsTable->setColumnCount(columns.size());
+    statsTable->setHorizontalHeaderLabels(columns);
+    statsRange->setEnabled(!diffMode);
+    logScale->setEnabled(!diffMode);
+
+    //Start with the biggest regressions at the top.
+    if(diffMode)
+      statsTable->sortByColumn(1, Qt::DescendingOrder);
+  }
+
+  //################################################################################################
+  //! Load and merge several files, these are not cached or followed.
+  void loadFiles(const std::vector<std::string>& paths)
+  {
+    if(paths.size()==1)
     {
-      if(size_t p = line.find(lineStart); p == std::string::npos)
-        continue;
+      loadFile(paths.front());
+      return;
+    }
+
+    ProfileTimer timer("load");
+    setDiffMode(false);
+
+    stopFollowing();
+    stopLoading();
+    clearTraces();
+    path.clear();
+
+    store.clear();
+    traceLODs.clear();
+    traceRangeMaxes.clear();
+    loadedBytes = 0;
+
+    auto mode = StatsMergeMode(mergeMode->currentData().toInt());
+    startLoading(std::make_unique<StatsLoadJob>(paths, mode, 0, timestampPattern->text().toStdString()));
+  }
+
+  //################################################################################################
+  //! Load from the cache if there is a valid one, otherwise start parsing in the background.
+  void loadFile(const std::string& path_)
+  {
+    ProfileTimer timer("load");
+    setDiffMode(false);
+    stopFollowing();
+    stopLoading();
+    clearTraces();
+    path = path_;
+
+    //A cache of a load that was not following can end part way through a line.
+    if(readTraceCache(path, store, traceLODs, loadedBytes, size_t(pagedBudget->value())<<20) &&
+       (!follow->isChecked() || endsOnLine(path, loadedBytes)))
+    {
+      //The X scale is fixed at load time so that appended samples don't move existing points.
+      updateXScale(1.0);
+      tpWarning() << "Loaded " << store.pointCount() << " data points from cache.";
+      changedTraces.clear();
+      updateDerivedTraces();
+      updateGraph();
+
+      if(follow->isChecked())
+        startFollowing();
+      return;
+    }
+
+    store.clear();
+    traceLODs.clear();
+    traceRangeMaxes.clear();
+    loadedBytes = 0;
+
+    //When following, a line that is still being written is left for the follower to parse.
+    startLoading(std::make_unique<StatsLoadJob>(path, follow->isChecked(), 0, timestampPattern->text().toStdString()));
+  }
+
+  //################################################################################################
+  void startLoading(std::unique_ptr<StatsLoadJob> job)
+  {
+    loadJob = std::move(job);
+    loadStart = std::chrono::steady_clock::now();
+    loadProgress->setValue(0);
+    loadProgress->show();
+    cancelLoad->show();
+    loadTimer->start();
+  }
+
+  //################################################################################################
+  //! Called at a fixed rate while loading, appends the blocks parsed since the last call.
+  void pollLoader()
+  {
+    if(!loadJob)
+      return;
+
+    ProfileTimer timer("load poll");
+    bool finished = loadJob->finished();
+
+    loadedBlocks.clear();
+    loadJob->takeBlocks(loadedBlocks);
+    if(diffMode)
+      loadJob->takeTraceDeltas(traceDeltas);
+
+    changedTraces.clear();
+    for(const auto& block : loadedBlocks)
+    {
+      if(loadJob->mergeBlocks())
+        store.mergeStore(*block, changedTraces);
       else
-        line = line.substr(p+lineStart.size());
+        store.appendStore(*block, changedTraces);
+    }
+    loadedBlocks.clear();
+
+    //A merged file adds samples before those the derived traces have evaluated, so start them again.
+    if(loadJob->mergeBlocks() && !changedTraces.empty())
+      for(auto& expression : derivedTraces)
+        expression->reset();
+
+    std::sort(changedTraces.begin(), changedTraces.end());
+    changedTraces.erase(std::unique(changedTraces.begin(), changedTraces.end()), changedTraces.end());
+
+    size_t fileSize = loadJob->fileSize();
+    loadedBytes = loadJob->takenBytes();
+
+    if(!changedTraces.empty())
+    {
+      //The X scale is estimated from the first blocks so that later blocks don't move points. Merged
+      //blocks are whole files, the biggest first.
+      if(rowTraces.empty())
+        updateXScale(loadJob->mergeBlocks()?1.0:double(loadedBytes) / double(std::max(size_t(1), fileSize)));
+
+      tracesAppended();
+    }
+
+    size_t parsedBytes = loadJob->parsedBytes();
+    loadProgress->setValue(fileSize?int(double(parsedBytes) / double(fileSize) * 1000.0):0);
+
+    if(!finished)
+      return;
+
+    bool failed = loadJob->failed();
+    if(failed)
+      tpWarning() << "Failed to open: " << (path.empty()?std::string("one or more files"):path);
 
-      if(size_t p = line.find(lineEnd); p == std::string::npos)
+    tpWarning() << "Loaded " << store.pointCount() << " data points.";
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+    selfProfile().setValue("parse MB/s", uint64_t(double(loadedBytes) / double(1<<20) / std::max(1e-3, seconds)));
+
+    if(!failed && !path.empty() && fileSize>=minimumCachedFileSize)
+      writeTraceCache(path, store, traceLODs, loadedBytes);
+
+    stopLoading();
+
+    //Sync the list if nothing was loaded.
+    if(rowTraces.empty())
+      updateGraph();
+
+    if(!failed && follow->isChecked())
+      startFollowing();
+  }
+
+  //################################################################################################
+  //! Stop a background load, the traces that have been loaded so far are kept.
+  void stopLoading()
+  {
+    loadTimer->stop();
+    loadJob.reset();
+    loadProgress->hide();
+    cancelLoad->hide();
+  }
+
+  //################################################################################################
+  //! Remove the traces from the layer, the list is kept so that check states survive a reload.
+  void clearTraces()
+  {
+    for(auto& expression : derivedTraces)
+      expression->reset();
+
+    rowTraces.clear();
+    traceRows.clear();
+    rowLevels.clear();
+    rowCrops.clear();
+    captureStats.clear();
+    captureStatsSizes.clear();
+    batchVertices.clear();
+    batchVertices.shrink_to_fit();
+    tracesLayer->setTraceCount(0);
+    mapWidget->map()->update();
+    scheduleStats();
+    updateMemoryStats();
+  }
+
+  //################################################################################################
+  //! Take a sample of the self profile, this also writes it to the file being recorded.
+  void updateProfile()
+  {
+    auto sample = selfProfile().takeSample();
+    if(profileOverlay->isHidden())
+      return;
+
+    //Counters are shown per frame while the map is redrawing.
+    uint64_t frames=0;
+    for(const auto& entry : sample)
+      if(entry.type==ProfileEntryType::Time && std::strcmp(entry.name, "frame")==0)
+        frames = entry.count;
+
+    QStringList lines;
+    for(const auto& entry : sample)
+    {
+      if(entry.count==0)
         continue;
-      else
-        line = line.substr(0, p);
 
-      if(line == "==================")
+      QString name = QString::fromUtf8(entry.name);
+      switch(entry.type)
       {
-        i++;
-        continue;
+      case ProfileEntryType::Time:
+        lines.append(QString("%1: %2 ms x %3").arg(name).arg(double(entry.total) / double(entry.count) / 1e6, 0, 'f', 2).arg(entry.count));
+        break;
+      case ProfileEntryType::Count:
+        if(frames)
+          lines.append(QString("%1: %2 per frame").arg(name).arg(entry.total / frames));
+        else
+          lines.append(QString("%1: %2").arg(name).arg(entry.total));
+        break;
+      case ProfileEntryType::Value:
+        lines.append(QString("%1: %2").arg(name).arg(entry.total));
+        break;
       }
+    }
 
-      std::vector<std::string> parts;
-      tpSplit(parts, line, " ---> ", tp_utils::SplitBehavior::SkipEmptyParts);
+    profileOverlay->setText(lines.join('\n'));
+    profileOverlay->adjustSize();
+  }
 
-      if(parts.size()!=2)
-        continue;
+  //################################################################################################
+  //! Sample the profile only while it is being shown or recorded.
+  void updateProfileTimer()
+  {
+    profileOverlay->setVisible(showProfile->isChecked());
+    if(showProfile->isChecked() || selfProfile().recording())
+      profileTimer->start();
+    else
+      profileTimer->stop();
+  }
+
+  //################################################################################################
+  //! Show the memory held by the trace store and the staging vertex buffers.
+  void updateMemoryStats()
+  {
+    auto stats = store.memoryStats();
 
-      std::string name = parts.at(0);
-      auto value = size_t(std::stoull(parts.at(1)));
+    size_t stagingBytes=0;
+    for(const auto& vertices : batchVertices)
+      stagingBytes += vertices.capacity()*sizeof(TraceVertex);
 
-      if(name.empty())
-        continue;
+    auto mb = [](size_t bytes){return QString::number(double(bytes) / double(1<<20), 'f', 1);};
+    auto bytesPerPoint = QString::number(double(stats.reservedBytes) / double(std::max(size_t(1), store.pointCount())), 'f', 2);
+    auto text = QString("Traces: %1 MB (%2 MB abandoned, %3 B/point), staging: %4 MB")
+                .arg(mb(stats.reservedBytes), mb(stats.abandonedBytes), bytesPerPoint, mb(stagingBytes));
+
+    if(const auto& file = store.pagedFile(); file)
+    {
+      auto paged = file->stats();
+      text += QString("\nPaged: %1 of %2 MB resident").arg(mb(paged.residentBytes), mb(paged.fileBytes));
+    }
 
-      auto& trace = traces[name];
-      if(!trace)
-        trace = std::make_shared<TraceDetails_lt>();
+    memoryStats->setText(text);
+    memoryStats->setToolTip(QString("%1 allocations in %2 blocks").arg(stats.allocationCount).arg(stats.blockCount));
+  }
 
-      pointCount++;
-      trace->points.push_back({i, value});
+  //################################################################################################
+  void startFollowing()
+  {
+    stopFollowing();
 
-      if(value>trace->maxValue)
-        trace->maxValue = value;
+    //Following starts once a background load has finished.
+    if(path.empty() || loadJob)
+      return;
 
-      if(value>maxValue)
-        maxValue = value;
+    //A load that was not following parsed the line that was still being written, reload so that the
+    //follower starts at the end of the last complete line.
+    if(!endsOnLine(path, loadedBytes))
+    {
+      loadFile(path);
+      return;
     }
 
-    tpWarning() << "Loaded " << pointCount << " data points.";
+    follower = std::make_unique<StatsFollower>(path, loadedBytes, timestampPattern->text().toStdString());
+    fileWatcher->addPath(QString::fromStdString(path));
+    fileChanged = true;
+    followTimer->start();
+  }
 
-    updateGraph();
+  //################################################################################################
+  void stopFollowing()
+  {
+    followTimer->stop();
+    if(!fileWatcher->files().isEmpty())
+      fileWatcher->removePaths(fileWatcher->files());
+    follower.reset();
   }
 
   //################################################################################################
-  void updateGraph()
+  //! Called at a fixed rate so that bursts of appends are batched into a single update.
+  void pollFollower()
   {
-    tpDeleteAll(pointLayers);
-    pointLayers.clear();
+    if(!follower || !fileChanged)
+      return;
 
-    tpDeleteAll(lineLayers);
-    lineLayers.clear();    
+    fileChanged = false;
+    ProfileTimer timer("follow poll");
 
-    originalValues.clear();
+    //Some writers replace the file, in which case the watcher drops it.
+    if(fileWatcher->files().isEmpty())
+      fileWatcher->addPath(QString::fromStdString(path));
 
-    listWidget->clear();
+    if(!follower->poll(store, changedTraces))
+    {
+      loadFile(path);
+      return;
+    }
 
-    std::vector<std::string> names;
-    names.reserve(traces.size());
-    for(const auto& t : traces)
-      names.push_back(t.first);
+    loadedBytes = follower->offset();
 
-    std::sort(names.begin(), names.end(),[](const auto& a, const auto& b){return QString::fromStdString(a).compare(QString::fromStdString(b), Qt::CaseInsensitive)<0;});
+    if(changedTraces.empty())
+      return;
+
+    //There may be more data than a single poll will read.
+    fileChanged = true;
 
-    size_t t=0;
-    originalValues.resize(names.size());
-    for(const auto& name : names)
+    tracesAppended();
+  }
+
+  //################################################################################################
+  //! Update the LODs, list and geometry after the traces in changedTraces have gained samples.
+  void tracesAppended()
+  {
+    traceLODs.resize(store.traceCount());
+    traceRangeMaxes.resize(store.traceCount());
+    parallelFor(changedTraces.size(), [&](size_t i)
     {
-      const auto& trace = traces[name];
+      auto traceID = changedTraces.at(i);
+      traceLODs.at(traceID).update(store.trace(traceID));
+      traceRangeMaxes.at(traceID).update(store.trace(traceID));
+    });
 
-      float max = normalizeIndividual->isChecked()?float(trace->maxValue):float(maxValue);
+    updateDerivedTraces();
 
-      int hue = int(float(t) / float(traces.size()) * 360.0f);
-      QColor color = QColor::fromHsl(hue, 255, 128);
-      glm::vec4 colorF(color.redF(), color.greenF(), color.blueF(), 1.0f);
+    if(store.traceCount()>traceRows.size())
+    {
+      updateGraph();
+      return;
+    }
 
-      auto item = new QListWidgetItem(QString::fromStdString(name));
-      item->setBackground(QBrush(color));
-      item->setCheckState(Qt::Checked);
-      listWidget->addItem(item);
+    changedRows.clear();
+    for(auto traceID : changedTraces)
+      if(auto row = traceRows.at(traceID); row!=invalidRow)
+        changedRows.push_back(row);
+    updateTraceGeometry(changedRows);
 
-      //Style the points and prepare them for rendering.
-      std::vector<tp_maps::PointSpriteShader::PointSprite> points;
-      tp_maps::Lines line;
-      line.mode = GL_LINE_STRIP;
-      line.color = colorF;
-      points.resize(trace->points.size());
-      line.lines.resize(trace->points.size());
-      for(size_t p=0; p<trace->points.size(); p++)
-      {
-        const auto& src = trace->points.at(p);
-        auto& dst = points.at(p);
-        dst.position = glm::vec3(float(src.first) / float(i) * 8.0f, float(src.second) / max, 0.0f);
-        dst.color = colorF;
-        dst.radius = 2.5f;
-        line.lines.at(p) = dst.position;
-      }
+    //If the global max grew the other traces only need a new scale.
+    updateNormalization();
+    mapWidget->map()->update();
+    scheduleStats();
+    updateMemoryStats();
+  }
+
+  //################################################################################################
+  //! Evaluate what the derived traces are missing, appending those that changed to changedTraces.
+  void updateDerivedTraces()
+  {
+    if(diffMode || derivedTraces.empty())
+      return;
+
+    ProfileTimer timer("derived traces");
+    size_t first = changedTraces.size();
+    for(auto& expression : derivedTraces)
+    {
+      auto update = expression->update(store);
+      if(!update.changed)
+        continue;
 
+      //The LODs only extend themselves, so the buckets of rewritten samples are dropped first.
+      auto traceID = expression->traceID();
+      if(traceID<traceLODs.size())
       {
-        auto layer = new tp_maps::LinesLayer();
-        layer->setDefaultRenderPass(tp_maps::RenderPass::GUI);
-        layer->setLines({line});
-        mapWidget->map()->addLayer(layer);
-        lineLayers.push_back(layer);
+        traceLODs.at(traceID).truncate(update.firstChanged);
+        traceRangeMaxes.at(traceID).truncate(update.firstChanged);
       }
 
+      if(traceID<captureStatsSizes.size())
+        captureStatsSizes.at(traceID) = std::numeric_limits<size_t>::max();
+
+      changedTraces.push_back(traceID);
+    }
+
+    traceLODs.resize(store.traceCount());
+    traceRangeMaxes.resize(store.traceCount());
+    parallelFor(changedTraces.size()-first, [&](size_t i)
+    {
+      auto traceID = changedTraces.at(first+i);
+      traceLODs.at(traceID).update(store.trace(traceID));
+      traceRangeMaxes.at(traceID).update(store.trace(traceID));
+    });
+  }
+
+  //################################################################################################
+  //! Ask for an expression and add a derived trace that plots it.
+  void addDerivedTrace()
+  {
+    bool ok=false;
+    auto text = QInputDialog::getText(q,
+                                      "Add derived trace",
+                                      "Expression, for example rate(bytes_sent), a / b or sum(matching \"db\\..*\"):",
+                                      QLineEdit::Normal,
+                                      QString(),
+                                      &ok).trimmed();
+    if(!ok || text.isEmpty())
+      return;
+
+    auto expression = std::make_unique<TraceExpression>(text.toStdString());
+    if(!expression->error().empty())
+    {
+      QMessageBox::warning(q, "Add derived trace", QString::fromStdString(expression->error()));
+      return;
+    }
+
+    for(const auto& other : derivedTraces)
+      if(other->name() == expression->name())
+        return;
+
+    derivedTraces.push_back(std::move(expression));
+    changedTraces.clear();
+    updateDerivedTraces();
+    updateGraph();
+  }
+
+  //################################################################################################
+  //! Remove the expressions of the selected derived traces, their traces are emptied and unlisted.
+  void removeDerivedTraces()
+  {
+    bool removed=false;
+    for(auto row : selectedRows())
+    {
+      auto traceID = rowTraces.at(row);
+      auto i = std::find_if(derivedTraces.begin(), derivedTraces.end(), [&](const auto& expression)
       {
-        auto spriteTexture = new tp_maps::SpriteTexture();
-        spriteTexture->setTexture(new tp_maps::DefaultSpritesTexture(mapWidget->map()));
-        auto layer = new tp_maps::PointsLayer(spriteTexture);
-        layer->setDefaultRenderPass(tp_maps::RenderPass::GUI);
-        layer->setPoints(points);
-        mapWidget->map()->addLayer(layer);
-        pointLayers.push_back(layer);
-      }
+        return expression->traceID()==traceID;
+      });
+
+      if(i == derivedTraces.end())
+        continue;
+
+      derivedTraces.erase(i);
+      store.trace(traceID).clear();
+      traceLODs.at(traceID).clear();
+      traceRangeMaxes.at(traceID).clear();
+      removed = true;
+    }
+
+    if(removed)
+      updateGraph();
+  }
+
+  //################################################################################################
+  //! Derived traces hold fixed point values, this converts their raw values for display.
+  double valueScale(size_t row) const
+  {
+    return store.trace(rowTraces.at(row)).derived?1.0/double(derivedValueScale):1.0;
+  }
+
+  //################################################################################################
+  //! Subtracted from the raw values of a derived trace that has negative values, before valueScale().
+  uint64_t valueBias(size_t row) const
+  {
+    auto traceID = rowTraces.at(row);
+    for(const auto& expression : derivedTraces)
+      if(expression->traceID()==traceID)
+        return expression->bias();
+    return 0;
+  }
+
+  //################################################################################################
+  //! Match the traces layer and the list to the traces in the store.
+  void updateGraph()
+  {
+    ProfileTimer timer("update graph");
+    //Traces loaded from the cache arrive without range max tables, for the others this is a no-op.
+    traceRangeMaxes.resize(store.traceCount());
+    parallelFor(traceRangeMaxes.size(), [&](size_t t)
+    {
+      traceRangeMaxes.at(t).update(store.trace(TraceID(t)));
+    });
+
+    //Derived traces whose expressions have been removed stay in the store but are not listed.
+    std::vector<bool> listed(store.traceCount(), true);
+    for(TraceID t=0; t<store.traceCount(); t++)
+      if(store.trace(t).derived)
+        listed.at(t) = false;
+    for(const auto& expression : derivedTraces)
+      if(auto traceID = expression->traceID(); traceID<listed.size())
+        listed.at(traceID) = true;
+
+    //Convert each name once rather than twice per comparison.
+    std::vector<QString> traceNames(store.traceCount());
+    rowTraces.clear();
+    for(TraceID t=0; t<store.traceCount(); t++)
+    {
+      if(!listed.at(t))
+        continue;
+
+      const auto& name = store.trace(t).name;
+      traceNames.at(t) = QString::fromUtf8(name.data(), int(name.size()));
+      rowTraces.push_back(t);
+    }
+
+    std::sort(rowTraces.begin(), rowTraces.end(), [&](TraceID a, TraceID b)
+    {
+      return traceNames.at(a).compare(traceNames.at(b), Qt::CaseInsensitive)<0;
+    });
+
+    //Keep the check state of traces that were in the previous load.
+    std::unordered_map<std::string, size_t> oldRows;
+    oldRows.reserve(rowNames.size());
+    for(size_t row=0; row<rowNames.size(); row++)
+      oldRows.emplace(rowNames.at(row), row);
+
+    bool sameNames = (rowNames.size() == rowTraces.size());
+
+    std::vector<std::string> newRowNames(rowTraces.size());
+    std::vector<bool> checked(rowTraces.size(), true);
+    std::vector<QColor> colors(rowTraces.size());
+
+    traceRows.assign(store.traceCount(), invalidRow);
+    rowColors.resize(rowTraces.size());
+    rowLevels.resize(rowTraces.size());
+    rowCrops.resize(rowTraces.size());
 
+    tracesLayer->setTraceCount(rowTraces.size());
+
+    for(size_t row=0; row<rowTraces.size(); row++)
+    {
+      const auto& trace = store.trace(rowTraces.at(row));
+      traceRows.at(rowTraces.at(row)) = row;
+      newRowNames.at(row) = std::string(trace.name);
+
+      if(sameNames && rowNames.at(row) != trace.name)
+        sameNames = false;
+
+      if(auto i = oldRows.find(newRowNames.at(row)); i != oldRows.end())
+        checked.at(row) = tracesModel->checked(i->second);
+
+      int hue = int(float(row) / float(rowTraces.size()) * 360.0f);
+      const auto& color = colors.at(row) = QColor::fromHsl(hue, 255, 128);
+      rowColors.at(row) = glm::vec4(color.redF(), color.greenF(), color.blueF(), 1.0f);
+      tracesLayer->setTraceColor(row, rowColors.at(row));
+    }
+
+    rowNames.swap(newRowNames);
+
+    if(!sameNames)
+    {
+      std::vector<QString> names(rowTraces.size());
+      nameIndex.clear();
+      for(size_t row=0; row<rowTraces.size(); row++)
       {
-        auto& p = originalValues.at(t);
-        p.reserve(trace->points.size());
-        for(const auto& point : trace->points)
-          p.push_back(point.second);
+        names.at(row) = std::move(traceNames.at(rowTraces.at(row)));
+        nameIndex.add(rowNames.at(row));
       }
 
-      t++;
+      tracesModel->setRows(std::move(names), std::move(colors), std::move(checked));
+    }
+
+    changedRows.clear();
+    for(size_t row=0; row<rowTraces.size(); row++)
+    {
+      tracesLayer->setTraceVisible(row, tracesModel->checked(row));
+      changedRows.push_back(row);
     }
+    updateTraceGeometry(changedRows);
 
+    updateNormalization();
     mapWidget->map()->update();
+    scheduleStats();
+    updateMemoryStats();
   }
 
   //################################################################################################
-  void itemChanged(QListWidgetItem* item)
+  //! The mapping from sample indexes to X, by time if there are sample times and the time axis is on.
+  TraceXAxis xAxis() const
   {
-    auto row = size_t(listWidget->row(item));
-    if(row<pointLayers.size())
+    TraceXAxis axis;
+    axis.scale = xScale;
+
+    const auto& times = store.sampleTimes();
+    if(timeAxis->isChecked() && !times.empty())
     {
-      pointLayers.at(row)->setVisible(item->checkState() == Qt::Checked);
-      mapWidget->map()->update();
+      axis.times = times.data();
+      axis.timeCount = times.size();
+      axis.first = xFirst;
+      axis.origin = xOrigin;
     }
 
-    if(row<lineLayers.size())
+    return axis;
+  }
+
+  //################################################################################################
+  //! Fit the capture to 8 units of X, fraction is the part of the file that has been loaded so far.
+  void updateXScale(double fraction)
+  {
+    fraction = std::max(fraction, 1e-6);
+
+    const auto& times = store.sampleTimes();
+    if(timeAxis->isChecked() && !times.empty())
     {
-      lineLayers.at(row)->setVisible(item->checkState() == Qt::Checked);
-      mapWidget->map()->update();
+      //At least a second so that a capture with a single time does not explode.
+      double duration = double(times.back() - times.front()) / fraction;
+      xScale = 8.0 / std::max(1e9, duration);
+      xFirst = times.front();
+      xOrigin = xFirst;
     }
+    else
+      xScale = 8.0 / std::max(1.0, double(store.sampleCount()) / fraction);
+
+    tracesLayer->setXOrigin(0.0);
   }
 
   //################################################################################################
-  void showSelected()
+  //! Upload the geometry of some traces, Y holds the raw values and is scaled by the traces layer.
+  /*!
+  Vertices are built on the worker threads a batch at a time and then uploaded to the layer.
+  */
+  void updateTraceGeometry(const std::vector<size_t>& rows)
   {
-    Q_FOREACH(auto i, listWidget->selectedItems())
-      i->setCheckState(Qt::Checked);
+    auto axis = xAxis();
+    for(size_t first=0; first<rows.size(); first+=geometryBatchSize)
+    {
+      size_t count = std::min(geometryBatchSize, rows.size()-first);
+      batchVertices.resize(std::max(batchVertices.size(), count));
+
+      parallelFor(count, [&](size_t i)
+      {
+        auto row = rows.at(first+i);
+        auto traceID = rowTraces.at(row);
+        const auto& trace = store.trace(traceID);
+
+        SampleBuffer buffer;
+        auto view = traceViewSamples(trace, traceLODs.at(traceID), viewFirst, viewLast, samplesPerPixel, buffer);
+        rowLevels.at(row) = view.level;
+        rowCrops.at(row) = {view.cropFirst, view.cropLast};
+
+        buildTraceVertices(view.samples, axis, 1.0f, float(row), batchVertices.at(i));
+      });
+
+      for(size_t i=0; i<count; i++)
+        tracesLayer->setTraceVertices(rows.at(first+i), batchVertices.at(i));
+    }
+
+    trimPagedFile();
   }
 
   //################################################################################################
-  void hideSelected()
+  //! Evict the least recently decoded tiles of a paged cache that no longer fit in the budget.
+  void trimPagedFile()
   {
-    Q_FOREACH(auto i, listWidget->selectedItems())
-      i->setCheckState(Qt::Unchecked);
+    if(const auto& file = store.pagedFile(); file)
+    {
+      file->trim();
+      updateMemoryStats();
+    }
   }
 
   //################################################################################################
-  void showAll()
+  //! Called before drawing a frame with a new view, updates traces that need a different LOD or crop.
+  /*!
+  \param rebuildAll - Rebuild every visible trace, used when the X axis changes.
+  */
+  void viewChanged(const glm::mat4& matrix, bool rebuildAll=false)
   {
-    for(int i=0; i<listWidget->count(); i++)
-      listWidget->item(i)->setCheckState(Qt::Checked);
+    ProfileTimer timer("view changed");
+    viewMatrix = matrix;
+    auto inverse = glm::inverse(matrix);
+    glm::vec4 left  = inverse * glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f);
+    glm::vec4 right = inverse * glm::vec4( 1.0f, 0.0f, 0.0f, 1.0f);
+    double sceneLeft = double(left.x/left.w);
+    double sceneRight = double(right.x/right.w);
+
+    //Move the origin of timed vertices when the view is far from it relative to its width.
+    auto axis = xAxis();
+    if(axis.times)
+    {
+      double center = (sceneLeft + sceneRight) / 2.0;
+      if(std::fabs(center - axis.originX()) > 64.0*std::fabs(sceneRight - sceneLeft))
+      {
+        xOrigin = xFirst + int64_t(center / xScale);
+        axis = xAxis();
+        tracesLayer->setXOrigin(axis.originX());
+        rebuildAll = true;
+      }
+    }
+
+    viewFirst = axis.sceneToIndex(sceneLeft);
+    viewLast  = axis.sceneToIndex(sceneRight);
+    samplesPerPixel = (viewLast - viewFirst) / double(std::max(1, mapWidget->map()->width()));
+
+    changedRows.clear();
+    for(size_t row=0; row<rowTraces.size(); row++)
+    {
+      if(!tracesLayer->traceVisible(row))
+      {
+        //Hidden traces are brought up to date when they are shown again.
+        rowLevels.at(row) = invalidLevel;
+        continue;
+      }
+
+      const auto& crop = rowCrops.at(row);
+      if(rebuildAll ||
+         rowLevels.at(row) != traceLODs.at(rowTraces.at(row)).selectLevel(samplesPerPixel) ||
+         std::max(0.0, viewFirst)<crop.first ||
+         std::max(0.0, viewLast)>crop.second)
+        changedRows.push_back(row);
+    }
+    updateTraceGeometry(changedRows);
+
+    if(autoscale->isChecked())
+      updateNormalization();
+
+    if(StatsRange(statsRange->currentData().toInt()) == StatsRange::Visible)
+      scheduleStats();
   }
 
   //################################################################################################
-  void hideAll()
+  //! Statistics are updated after a short delay so that a burst of changes is only processed once.
+  void scheduleStats()
   {
-    for(int i=0; i<listWidget->count(); i++)
-      listWidget->item(i)->setCheckState(Qt::Unchecked);
+    if(!statsTimer->isActive())
+      statsTimer->start();
   }
 
   //################################################################################################
-  void hideAllExceptSelected()
+  //! Calculate the statistics of each trace, over the whole capture or the visible range.
+  void updateStats()
   {
-    auto selected = listWidget->selectedItems();
+    ProfileTimer timer("statistics");
+    if(diffMode)
+    {
+      updateDiffTable();
+      return;
+    }
 
-    for(int i=0; i<listWidget->count(); i++)
+    captureStats.resize(store.traceCount());
+    captureStatsSizes.resize(store.traceCount(), std::numeric_limits<size_t>::max());
+
+    bool visible = (StatsRange(statsRange->currentData().toInt()) == StatsRange::Visible);
+    rowStats.resize(rowTraces.size());
+    parallelFor(rowTraces.size(), [&](size_t row)
+    {
+      auto traceID = rowTraces.at(row);
+      const auto& trace = store.trace(traceID);
+
+      size_t first=0;
+      size_t last=trace.size();
+      if(visible)
+      {
+        first = trace.lowerBound(uint64_t(std::max(0.0, viewFirst)));
+        last = std::max(first, trace.upperBound(uint64_t(std::max(0.0, viewLast))));
+      }
+
+      //Whole capture statistics are kept until the trace gains samples.
+      if(last-first == trace.size())
+      {
+        if(captureStatsSizes.at(traceID) != trace.size())
+        {
+          captureStats.at(traceID) = computeTraceStats(trace, 0, trace.size());
+          captureStatsSizes.at(traceID) = trace.size();
+        }
+        rowStats.at(row) = captureStats.at(traceID);
+      }
+      else
+        rowStats.at(row) = computeTraceStats(trace, first, last-first);
+    });
+
+    auto setItem = [&](int row, int column, const QVariant& value)
+    {
+      auto item = statsTable->item(row, column);
+      if(!item)
+      {
+        item = new QTableWidgetItem();
+        item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+        statsTable->setItem(row, column, item);
+      }
+      item->setData(Qt::DisplayRole, value);
+    };
+
+    statsTable->setSortingEnabled(false);
+    statsTable->setRowCount(int(rowTraces.size()));
+    for(size_t row=0; row<rowTraces.size(); row++)
     {
-      auto item = listWidget->item(i);
-      item->setCheckState(selected.contains(item)?Qt::Checked:Qt::Unchecked);
+      const auto& stats = rowStats.at(row);
+      double scale = valueScale(row);
+      double bias = double(valueBias(row));
+      auto value = [&](uint64_t v)
+      {
+        return (scale==1.0)?QVariant(qulonglong(v)):QVariant((double(v)-bias)*scale);
+      };
+
+      int r = int(row);
+      setItem(r,  0, QString::fromStdString(rowNames.at(row)));
+      setItem(r,  1, qulonglong(stats.count));
+      setItem(r,  2, value(stats.min));
+      setItem(r,  3, value(stats.max));
+      setItem(r,  4, (stats.mean-bias)*scale);
+      setItem(r,  5, stats.stddev*scale);
+      setItem(r,  6, (stats.p50-bias)*scale);
+      setItem(r,  7, (stats.p95-bias)*scale);
+      setItem(r,  8, (stats.p99-bias)*scale);
+      setItem(r,  9, stats.rate*scale);
+      setItem(r, 10, (stats.total-bias*double(stats.count))*scale);
     }
+    statsTable->setSortingEnabled(true);
+
+    trimPagedFile();
   }
 
   //################################################################################################
-  void bringItemToFront(QListWidgetItem* item)
+  //! Fill the statistics table with the delta of each trace, the biggest regression first.
+  void updateDiffTable()
   {
-    auto row = size_t(listWidget->row(item));
-    if(row<lineLayers.size())
+    auto setItem = [&](int row, int column, const QVariant& value)
+    {
+      auto item = new QTableWidgetItem();
+      item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+      item->setData(Qt::DisplayRole, value);
+      statsTable->setItem(row, column, item);
+    };
+
+    statsTable->setSortingEnabled(false);
+    statsTable->clearContents();
+    statsTable->setRowCount(int(rowTraces.size()));
+
+    //Rows are added in rank order, the table then sorts them by the column the user last picked.
+    std::vector<size_t> traceRanks(traceDeltas.size());
+    auto ranked = rankTraceDeltas(traceDeltas);
+    for(size_t rank=0; rank<ranked.size(); rank++)
+      traceRanks.at(ranked.at(rank)) = rank;
+
+    for(size_t row=0; row<rowTraces.size(); row++)
     {
-      auto layer = lineLayers.at(row);
-      mapWidget->map()->removeLayer(layer);
-      mapWidget->map()->addLayer(layer);
+      auto traceID = rowTraces.at(row);
+      if(traceID>=traceDeltas.size())
+        continue;
+
+      const auto& delta = traceDeltas.at(traceID);
+      int r = int(traceRanks.at(traceID));
+      setItem(r, 0, QString::fromStdString(rowNames.at(row)));
+      setItem(r, 1, delta.score*100.0);
+      setItem(r, 2, delta.max());
+      setItem(r, 3, delta.mean());
+      setItem(r, 4, delta.p50());
+      setItem(r, 5, delta.p95());
+      setItem(r, 6, delta.p99());
+      setItem(r, 7, delta.total());
+      setItem(r, 8, qulonglong(delta.baseline.count));
+      setItem(r, 9, qulonglong(delta.candidate.count));
     }
+    statsTable->setSortingEnabled(true);
+  }
 
-    if(row<pointLayers.size())
+  //################################################################################################
+  //! Show only the traces with the biggest regressions.
+  void showRegressions()
+  {
+    std::vector<bool> checked(tracesModel->size(), false);
+    auto ranked = rankTraceDeltas(traceDeltas);
+    for(size_t rank=0; rank<std::min(regressionCount, ranked.size()); rank++)
+      if(auto traceID = ranked.at(rank); traceID<traceRows.size() && traceDeltas.at(traceID).score>0.0)
+        checked.at(traceRows.at(traceID)) = true;
+    tracesModel->setChecked(checked);
+  }
+
+  //################################################################################################
+  //! Scale each trace to the global max or to its own max, this only updates the traces layer table.
+  /*!
+  When autoscaling, the max of each visible trace is taken over the visible range only, and the
+  global max is the max of the visible traces. Otherwise the whole capture is used.
+
+  In diff mode zero is drawn half way up with the largest difference of either sign at the edges,
+  as it is for derived traces that have negative values.
+  */
+  void updateNormalization()
+  {
+    bool individual = normalizeIndividual->isChecked();
+    bool log = logScale->isChecked() && !diffMode;
+    tracesLayer->setLogScale(log);
+
+    //The bias of a derived trace grows as it gains samples.
+    for(size_t row=0; row<rowTraces.size(); row++)
+      tracesLayer->setTraceValueScale(row, float(valueScale(row)), float(double(valueBias(row))*valueScale(row)));
+
+    auto range = [&](double maxValue)
+    {
+      float m = std::max(1.0f, float(maxValue));
+      return log?std::log(1.0f+m):m;
+    };
+
+    //Maxes are compared after converting the values of derived traces, for those with a bias this
+    //is the largest value of either sign. The bias is the most negative a trace can be.
+    auto magnitude = [&](size_t row)
     {
-      auto layer = pointLayers.at(row);
-      mapWidget->map()->removeLayer(layer);
-      mapWidget->map()->addLayer(layer);
+      double bias = double(valueBias(row));
+      return std::max(double(rowMaxes.at(row))-bias, bias)*valueScale(row);
+    };
+
+    double globalMax = double(store.maxValue());
+    rowMaxes.resize(rowTraces.size());
+    if(autoscale->isChecked())
+    {
+      if(viewLast<0.0)
+        return;
+
+      auto firstIndex = uint64_t(std::ceil(std::max(0.0, viewFirst)));
+      auto lastIndex = uint64_t(std::min(viewLast, double(std::numeric_limits<uint32_t>::max())));
+
+      globalMax = 0;
+      for(size_t row=0; row<rowTraces.size(); row++)
+      {
+        if(!tracesLayer->traceVisible(row))
+          continue;
+
+        auto traceID = rowTraces.at(row);
+        rowMaxes.at(row) = traceRangeMaxes.at(traceID).max(store.trace(traceID), firstIndex, lastIndex);
+        globalMax = std::max(globalMax, magnitude(row));
+      }
     }
+    else
+    {
+      for(size_t row=0; row<rowTraces.size(); row++)
+      {
+        rowMaxes.at(row) = store.trace(rowTraces.at(row)).maxValue;
+        if(store.trace(rowTraces.at(row)).derived)
+          globalMax = std::max(globalMax, magnitude(row));
+      }
+    }
+
+    if(diffMode)
+    {
+      auto bias = [&](size_t row)
+      {
+        auto traceID = rowTraces.at(row);
+        return (traceID<traceDeltas.size())?traceDeltas.at(traceID).bias:uint64_t(0);
+      };
+
+      //The biased max is the largest positive difference and the bias is the largest negative one.
+      uint64_t globalMagnitude=1;
+      for(size_t row=0; row<rowTraces.size(); row++)
+      {
+        rowMaxes.at(row) = std::max(bias(row), rowMaxes.at(row)-std::min(rowMaxes.at(row), bias(row)));
+        if(tracesLayer->traceVisible(row))
+          globalMagnitude = std::max(globalMagnitude, rowMaxes.at(row));
+      }
+
+      for(size_t row=0; row<rowTraces.size(); row++)
+      {
+        float magnitude = float(individual?std::max(uint64_t(1), rowMaxes.at(row)):globalMagnitude);
+        float scale = 0.5f / magnitude;
+        tracesLayer->setTraceYTransform(row, scale, 0.5f - float(bias(row))*scale);
+      }
+      return;
+    }
+
+    float globalRange = range(globalMax);
+    for(size_t row=0; row<rowTraces.size(); row++)
+    {
+      float traceRange = individual?range(magnitude(row)):globalRange;
+      if(valueBias(row))
+        tracesLayer->setTraceYTransform(row, 0.5f / traceRange, 0.5f);
+      else
+        tracesLayer->setTraceYTransform(row, 1.0f / traceRange, 0.0f);
+    }
+  }
+
+  //################################################################################################
+  //! Called once for each change to the check states, however many rows it touched.
+  void checkedChanged(const std::vector<size_t>& rows)
+  {
+    changedRows.clear();
+    for(auto row : rows)
+    {
+      if(row>=tracesLayer->traceCount())
+        continue;
+
+      bool visible = tracesModel->checked(row);
+      if(visible && rowLevels.at(row) == invalidLevel)
+        changedRows.push_back(row);
+
+      tracesLayer->setTraceVisible(row, visible);
+    }
+
+    updateTraceGeometry(changedRows);
+
+    if(autoscale->isChecked())
+      updateNormalization();
 
     mapWidget->map()->update();
   }
 
   //################################################################################################
-  void bringToFront()
+  std::vector<size_t> selectedRows() const
   {
-    Q_FOREACH(auto i, listWidget->selectedItems())
-      bringItemToFront(i);
+    std::vector<size_t> rows;
+    Q_FOREACH(const auto& index, listView->selectionModel()->selectedRows())
+      rows.push_back(size_t(index.row()));
+    std::sort(rows.begin(), rows.end());
+    return rows;
   }
 
   //################################################################################################
-  void pointsLayerToolTipEvent(QHelpEvent* helpEvent, tp_maps::PointsPickingResult* result)
+  //! Select the rows whose names contain text, as a single change to the selection.
+  void search(const QString& text)
   {
-    TP_UNUSED(helpEvent);
+    const auto& rows = nameIndex.find(text.toStdString());
 
-    for(size_t i=0; i<pointLayers.size(); i++)
+    QItemSelection selection;
+    for(size_t i=0; i<rows.size();)
     {
-      auto l = pointLayers.at(i);
-      if(l == result->pointsLayer)
-      {
-        if(i>=size_t(listWidget->count()))
-          break;
+      size_t first = rows.at(i);
+      size_t last = first;
+      for(i++; i<rows.size() && rows.at(i)==last+1; i++)
+        last++;
+      selection.select(tracesModel->index(int(first)), tracesModel->index(int(last)));
+    }
 
-        auto item = listWidget->item(int(i));
+    listView->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
+  }
 
-        if(i>=originalValues.size())
-          break;
+  //################################################################################################
+  void showSelected()
+  {
+    tracesModel->setChecked(selectedRows(), true);
+  }
 
-        const auto& values = originalValues.at(i);
+  //################################################################################################
+  void hideSelected()
+  {
+    tracesModel->setChecked(selectedRows(), false);
+  }
 
-        if(result->index>=values.size())
-          break;
+  //################################################################################################
+  void showAll()
+  {
+    tracesModel->setChecked(std::vector<bool>(tracesModel->size(), true));
+  }
 
-        QToolTip::showText(helpEvent->globalPos(), QString("(%1) %2").arg(values.at(result->index)).arg(item->text()));
+  //################################################################################################
+  void hideAll()
+  {
+    tracesModel->setChecked(std::vector<bool>(tracesModel->size(), false));
+  }
 
-        break;
-      }
-    }
+  //################################################################################################
+  void hideAllExceptSelected()
+  {
+    std::vector<bool> checked(tracesModel->size(), false);
+    for(auto row : selectedRows())
+      checked.at(row) = true;
+    tracesModel->setChecked(checked);
   }
 
   //################################################################################################
-  void linesLayerToolTipEvent(QHelpEvent* helpEvent, tp_maps::LinesPickingResult* result)
+  void bringToFront()
   {
-    TP_UNUSED(helpEvent);
+    for(auto row : selectedRows())
+      if(row<tracesLayer->traceCount())
+        tracesLayer->bringToFront(row);
 
-    for(size_t i=0; i<lineLayers.size(); i++)
-    {
-      auto l = lineLayers.at(i);
-      if(l == result->layer)
-      {
-        if(i>=size_t(listWidget->count()))
-          break;
+    mapWidget->map()->update();
+  }
 
-        auto item = listWidget->item(int(i));
+  //################################################################################################
+  //! Show the value of the sample nearest to the cursor, searching the visible traces front to back.
+  void toolTipEvent(QHelpEvent* helpEvent)
+  {
+    glm::vec2 viewport(mapWidget->map()->width(), mapWidget->map()->height());
+    glm::vec2 position(helpEvent->x(), helpEvent->y());
+    float radius = 6.0f;
+    auto axis = xAxis();
+
+    size_t nearestRow = rowTraces.size();
+    NearestSample nearest;
+    uint64_t nearestValue=0;
+
+    //The drawn samples are decoded again, only around the cursor.
+    auto inverse = glm::inverse(viewMatrix);
+    auto toIndex = [&](float x)
+    {
+      glm::vec4 scene = inverse * glm::vec4(x/std::max(1.0f, viewport.x)*2.0f-1.0f, 0.0f, 0.0f, 1.0f);
+      return axis.sceneToIndex(double(scene.x/scene.w));
+    };
+    double cursorFirst = toIndex(position.x-radius);
+    double cursorLast = toIndex(position.x+radius);
+
+    SampleBuffer buffer;
+    const auto& drawOrder = tracesLayer->drawOrder();
+    for(auto i=drawOrder.rbegin(); i!=drawOrder.rend(); ++i)
+    {
+      auto row = *i;
+      if(!tracesLayer->traceVisible(row) || row>=rowCrops.size())
+        continue;
 
-        QToolTip::showText(helpEvent->globalPos(), item->text());
+      //Include the samples either side of the window so that the lines crossing it are found.
+      auto traceID = rowTraces.at(row);
+      auto crop = rowCrops.at(row);
+      const auto& level = traceLODs.at(traceID).levelSamples(store.trace(traceID), rowLevels.at(row));
+      size_t first = level.lowerBound(uint64_t(std::clamp(cursorFirst, crop.first, crop.second)));
+      size_t last = level.upperBound(uint64_t(std::clamp(cursorLast, crop.first, crop.second)));
+      first = (first>0)?first-1:0;
+      last = std::min(level.size(), last+1);
+      if(first>=last)
+        continue;
 
-        break;
+      auto samples = level.samples(first, last-first, buffer);
+      auto result = findNearestSample(samples, viewMatrix, viewport, position, axis, tracesLayer->traceYTransform(row), radius);
+      if(result.distance<nearest.distance)
+      {
+        nearest = result;
+        nearestRow = row;
+        nearestValue = samples.values[result.sample];
       }
     }
+
+    if(nearestRow>=rowCrops.size())
+    {
+      QToolTip::hideText();
+      helpEvent->ignore();
+      return;
+    }
+
+    auto value = QString::number(nearestValue);
+    if(auto traceID = rowTraces.at(nearestRow); diffMode && traceID<traceDeltas.size())
+      value = QString::number(int64_t(nearestValue - traceDeltas.at(traceID).bias));
+    else if(store.trace(traceID).derived)
+      value = QString::number((double(nearestValue)-double(valueBias(nearestRow)))*valueScale(nearestRow));
+
+    auto text = QString("(%1) %2").arg(value, tracesModel->name(nearestRow));
+    QToolTip::showText(helpEvent->globalPos(), text);
   }
 };
 
@@ -376,49 +1414,226 @@ MainWindow::MainWindow():
 
   auto search = new QLineEdit();
   leftLayout->addWidget(search);
-  connect(search, &QLineEdit::textEdited, this, [=]
+  connect(search, &QLineEdit::textEdited, this, [&](const QString& text){d->search(text);});
+
+  auto leftSplitter = new QSplitter(Qt::Vertical);
+  leftLayout->addWidget(leftSplitter);
+
+  d->tracesModel = new TracesModel(this);
+  d->listView = new QListView();
+  d->listView->setModel(d->tracesModel);
+  d->listView->setUniformItemSizes(true);
+  leftSplitter->addWidget(d->listView);
+
+  auto statsWidget = new QWidget();
+  leftSplitter->addWidget(statsWidget);
+  auto statsLayout = new QVBoxLayout(statsWidget);
+  statsLayout->setContentsMargins(0,0,0,0);
+
+  d->statsRange = new QComboBox();
+  d->statsRange->addItem("Statistics of the whole capture", int(StatsRange::Capture));
+  d->statsRange->addItem("Statistics of the visible range", int(StatsRange::Visible));
+  statsLayout->addWidget(d->statsRange);
+  connect(d->statsRange, qOverload<int>(&QComboBox::currentIndexChanged), this, [&]{d->scheduleStats();});
+
+  d->statsTable = new QTableWidget(0, statsColumns.size());
+  d->statsTable->setHorizontalHeaderLabels(statsColumns);
+  d->statsTable->verticalHeader()->hide();
+  d->statsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+  d->statsTable->setSortingEnabled(true);
+  statsLayout->addWidget(d->statsTable);
+
+  d->statsTimer = new QTimer(this);
+  d->statsTimer->setSingleShot(true);
+  d->statsTimer->setInterval(250);
+  connect(d->statsTimer, &QTimer::timeout, this, [&]{d->updateStats();});
+  connect(d->tracesModel, &TracesModel::checkedChanged, this, [&](const std::vector<size_t>& rows){d->checkedChanged(rows);});
+  d->listView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  d->listView->setSelectionBehavior(QAbstractItemView::SelectRows);
+  d->listView->setContextMenuPolicy(Qt::CustomContextMenu);
+  connect(d->listView, &QWidget::customContextMenuRequested, [&](const QPoint& pos){d->listViewMenu->exec(d->listView->mapToGlobal(pos));});
+
+  d->listViewMenu = new QMenu(d->listView);
+  connect(d->listViewMenu->addAction("Show selected"),            &QAction::triggered, [&]{d->showSelected();         });
+  connect(d->listViewMenu->addAction("Hide selected"),            &QAction::triggered, [&]{d->hideSelected();         });
+  connect(d->listViewMenu->addAction("Show all"),                 &QAction::triggered, [&]{d->showAll();              });
+  connect(d->listViewMenu->addAction("Hide all"),                 &QAction::triggered, [&]{d->hideAll();              });
+  connect(d->listViewMenu->addAction("Hide all except selected"), &QAction::triggered, [&]{d->hideAllExceptSelected();});
+  connect(d->listViewMenu->addAction("Bring to front"),           &QAction::triggered, [&]{d->bringToFront();         });
+  connect(d->listViewMenu->addAction("Show biggest regressions"), &QAction::triggered, [&]{d->showRegressions();      });
+  connect(d->listViewMenu->addAction("Add derived trace..."),     &QAction::triggered, [&]{d->addDerivedTrace();      });
+  connect(d->listViewMenu->addAction("Remove derived traces"),    &QAction::triggered, [&]{d->removeDerivedTraces();  });
+
+  d->normalizeIndividual = new QCheckBox("Normalize individuals");
+  leftLayout->addWidget(d->normalizeIndividual);
+  connect(d->normalizeIndividual, &QCheckBox::clicked, this, [&]
   {
-    auto text = search->text().toLower();
-    d->listWidget->clearSelection();
-    for(int i=0; i<d->listWidget->count(); i++)
-    {
-      auto item = d->listWidget->item(i);
-      if(item->text().toLower().contains(text))
-        item->setSelected(true);
-    }
+    d->updateNormalization();
+    d->mapWidget->map()->update();
   });
 
-  d->listWidget = new QListWidget();
-  leftLayout->addWidget(d->listWidget);
-  connect(d->listWidget, &QListWidget::itemChanged, [&](QListWidgetItem* item){d->itemChanged(item);});
-  d->listWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
-  d->listWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
-  d->listWidget->setContextMenuPolicy(Qt::CustomContextMenu);
-  connect(d->listWidget, &QWidget::customContextMenuRequested, [&](const QPoint& pos){d->listWidgetMenu->exec(d->listWidget->mapToGlobal(pos));});
-
-  d->listWidgetMenu = new QMenu(d->listWidget);
-  connect(d->listWidgetMenu->addAction("Show selected"),            &QAction::triggered, [&]{d->showSelected();         });
-  connect(d->listWidgetMenu->addAction("Hide selected"),            &QAction::triggered, [&]{d->hideSelected();         });
-  connect(d->listWidgetMenu->addAction("Show all"),                 &QAction::triggered, [&]{d->showAll();              });
-  connect(d->listWidgetMenu->addAction("Hide all"),                 &QAction::triggered, [&]{d->hideAll();              });
-  connect(d->listWidgetMenu->addAction("Hide all except selected"), &QAction::triggered, [&]{d->hideAllExceptSelected();});
-  connect(d->listWidgetMenu->addAction("Bring to front"),           &QAction::triggered, [&]{d->bringToFront();         });
+  d->logScale = new QCheckBox("Log scale");
+  d->logScale->setToolTip("Draw log(1+value) on the Y axis.");
+  leftLayout->addWidget(d->logScale);
+  connect(d->logScale, &QCheckBox::clicked, this, [&]
+  {
+    d->updateNormalization();
+    d->mapWidget->map()->update();
+  });
 
-  d->normalizeIndividual = new QCheckBox("Normalize individuals");
-  leftLayout->addWidget(d->normalizeIndividual);
-  connect(d->normalizeIndividual, &QCheckBox::clicked, this, [&]{d->updateGraph();});
+  d->timeAxis = new QCheckBox("Time axis");
+  d->timeAxis->setToolTip("Place samples by the timestamps in the log rather than by separator count.");
+  d->timeAxis->setChecked(true);
+  leftLayout->addWidget(d->timeAxis);
+  connect(d->timeAxis, &QCheckBox::clicked, this, [&]
+  {
+    d->updateXScale(1.0);
+    d->viewChanged(d->viewMatrix, true);
+    d->mapWidget->map()->update();
+  });
+
+  d->timestampPattern = new QLineEdit();
+  d->timestampPattern->setPlaceholderText("Timestamp regex (optional)");
+  d->timestampPattern->setToolTip("A regex applied to the text before each @LST@ marker when loading, its first capture group\n"
+                                  "holds the timestamp. Leave empty to find dates and times automatically.");
+  leftLayout->addWidget(d->timestampPattern);
+
+  d->autoscale = new QCheckBox("Autoscale to visible range");
+  d->autoscale->setToolTip("Scale Y to the max of the samples in view, rather than of the whole capture.");
+  leftLayout->addWidget(d->autoscale);
+  connect(d->autoscale, &QCheckBox::clicked, this, [&]
+  {
+    d->updateNormalization();
+    d->mapWidget->map()->update();
+  });
+
+  d->mergeMode = new QComboBox();
+  d->mergeMode->setToolTip("How traces are combined when more than one file is loaded.");
+  d->mergeMode->addItem("Separate traces per file", int(StatsMergeMode::Namespaced));
+  d->mergeMode->addItem("Sum traces across files", int(StatsMergeMode::Summed));
+  leftLayout->addWidget(d->mergeMode);
+
+  d->follow = new QCheckBox("Follow");
+  d->follow->setToolTip("Watch the loaded file and append new data as it is written.");
+  leftLayout->addWidget(d->follow);
+  connect(d->follow, &QCheckBox::clicked, this, [&]
+  {
+    if(d->follow->isChecked())
+      d->startFollowing();
+    else
+      d->stopFollowing();
+  });
+
+  d->fileWatcher = new QFileSystemWatcher(this);
+  connect(d->fileWatcher, &QFileSystemWatcher::fileChanged, this, [&]{d->fileChanged = true;});
+
+  d->followTimer = new QTimer(this);
+  d->followTimer->setInterval(33);
+  connect(d->followTimer, &QTimer::timeout, this, [&]{d->pollFollower();});
 
   auto loadButton = new QPushButton("Load");
   leftLayout->addWidget(loadButton);
   connect(loadButton, &QAbstractButton::clicked, [&]{d->load();});
 
+  auto compareButton = new QPushButton("Compare");
+  compareButton->setToolTip("Load a baseline and a candidate capture and show the difference of each trace.");
+  leftLayout->addWidget(compareButton);
+  connect(compareButton, &QAbstractButton::clicked, [&]{d->compare();});
+
+  auto derivedButton = new QPushButton("Add derived trace");
+  derivedButton->setToolTip("Plot an expression of other traces, such as rate(bytes_sent), a / b or sum(matching \"db\\..*\").\n"
+                            "Derived traces update as samples are appended and are kept when another file is loaded.");
+  leftLayout->addWidget(derivedButton);
+  connect(derivedButton, &QAbstractButton::clicked, [&]{d->addDerivedTrace();});
+
+  d->loadProgress = new QProgressBar();
+  d->loadProgress->setRange(0, 1000);
+  d->loadProgress->setTextVisible(false);
+  d->loadProgress->hide();
+  leftLayout->addWidget(d->loadProgress);
+
+  d->cancelLoad = new QPushButton("Cancel");
+  d->cancelLoad->hide();
+  leftLayout->addWidget(d->cancelLoad);
+  connect(d->cancelLoad, &QAbstractButton::clicked, [&]{d->stopLoading();});
+
+  d->loadTimer = new QTimer(this);
+  d->loadTimer->setInterval(33);
+  connect(d->loadTimer, &QTimer::timeout, this, [&]{d->pollLoader();});
+
+  d->memoryStats = new QLabel();
+  leftLayout->addWidget(d->memoryStats);
+
+  d->pagedBudget = new QSpinBox();
+  d->pagedBudget->setRange(0, 1<<20);
+  d->pagedBudget->setSingleStep(256);
+  d->pagedBudget->setValue(2048);
+  d->pagedBudget->setPrefix("Cache budget: ");
+  d->pagedBudget->setSuffix(" MB");
+  d->pagedBudget->setSpecialValueText("Read cache into memory");
+  d->pagedBudget->setToolTip("Page traces in from the cache as they are viewed, keeping at most this much of it in memory.\n"
+                             "Set to 0 to read the whole cache into memory when a file is loaded.");
+  leftLayout->addWidget(d->pagedBudget);
+  connect(d->pagedBudget, qOverload<int>(&QSpinBox::valueChanged), this, [&](int value)
+  {
+    if(const auto& file = d->store.pagedFile(); file && value>0)
+    {
+      file->setBudget(size_t(value)<<20);
+      d->trimPagedFile();
+    }
+  });
+
+  d->showProfile = new QCheckBox("Profile overlay");
+  d->showProfile->setToolTip("Show where the viewer itself spends time, sampled twice a second.");
+  leftLayout->addWidget(d->showProfile);
+  connect(d->showProfile, &QCheckBox::clicked, this, [&]{d->updateProfileTimer();});
+
+  d->recordProfile = new QPushButton("Record profile");
+  d->recordProfile->setToolTip("Write the profile of the viewer to a stats file that can be loaded like any other.");
+  d->recordProfile->setCheckable(true);
+  leftLayout->addWidget(d->recordProfile);
+  connect(d->recordProfile, &QAbstractButton::clicked, this, [&]
+  {
+    std::string path;
+    if(d->recordProfile->isChecked())
+    {
+      path = QFileDialog::getSaveFileName(this, "Record profile").toStdString();
+      if(path.empty())
+        d->recordProfile->setChecked(false);
+    }
+
+    if(!selfProfile().setRecordPath(path))
+    {
+      tpWarning() << "Failed to open: " << path;
+      d->recordProfile->setChecked(false);
+    }
+
+    d->updateProfileTimer();
+  });
+
+  d->profileTimer = new QTimer(this);
+  d->profileTimer->setInterval(500);
+  connect(d->profileTimer, &QTimer::timeout, this, [&]{d->updateProfile();});
+
   d->mapWidget = new general_performance_stats_viewer::MapWidget();
   splitter->addWidget(d->mapWidget);
 
-  connect(d->mapWidget, &general_performance_stats_viewer::MapWidget::pointsLayerToolTipEvent, [&](QHelpEvent* helpEvent, tp_maps::PointsPickingResult* result){d->pointsLayerToolTipEvent(helpEvent, result);});
-  connect(d->mapWidget, &general_performance_stats_viewer::MapWidget::linesLayerToolTipEvent, [&](QHelpEvent* helpEvent, tp_maps::LinesPickingResult* result){d->linesLayerToolTipEvent(helpEvent, result);});
+  d->profileOverlay = new QLabel(d->mapWidget);
+  d->profileOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+  d->profileOverlay->setStyleSheet("QLabel{background-color: rgba(0, 0, 0, 160); color: white; font-family: monospace; padding: 4px;}");
+  d->profileOverlay->move(8, 8);
+  d->profileOverlay->hide();
+
+  //This must be added before the trace layers so that they are updated before they are drawn.
+  d->mapWidget->map()->addLayer(new ViewChangedLayer([&](const glm::mat4& matrix){d->viewChanged(matrix);}));
+
+  d->tracesLayer = new TracesLayer();
+  d->mapWidget->map()->addLayer(d->tracesLayer);
+
+  connect(d->mapWidget, &general_performance_stats_viewer::MapWidget::toolTipEvent, [&](QHelpEvent* helpEvent){d->toolTipEvent(helpEvent);});
 
-  d->graphController = new tp_maps::GraphController(d->mapWidget->map());
+  d->graphController = new GraphController(d->mapWidget->map());
+  d->graphController->setFocalPoint({4.0f, 0.5f, 0.0f});
 
   splitter->setSizes({1000, 6000});
 }
@@ -1,15 +1,8 @@
 #include "general_performance_stats_viewer/MapWidget.h"
-
-#include "tp_maps/PickingResult.h"
-#include "tp_maps/RenderInfo.h"
-#include "tp_maps/picking_results/PointsPickingResult.h"
-#include "tp_maps/picking_results/LinesPickingResult.h"
+#include "general_performance_stats_viewer/SelfProfile.h"
 
 #include <QHelpEvent>
 
-#include <memory>
-#include <iostream>
-
 namespace general_performance_stats_viewer
 {
 
@@ -47,36 +40,9 @@ bool MapWidget::event(QEvent* event)
 {
   if (event->type() == QEvent::ToolTip)
   {
-      QHelpEvent* helpEvent = static_cast<QHelpEvent*>(event);
-
-      std::unique_ptr<tp_maps::PickingResult> pickingResult{map()->performPicking(toolTipSID(), {helpEvent->x(), helpEvent->y()})};
-      if(!pickingResult)
-      {
-        event->ignore();
-        return true;
-      }
-
-      {
-        auto pointsLayerPickingResult = dynamic_cast<tp_maps::PointsPickingResult*>(pickingResult.get());
-        if(pointsLayerPickingResult)
-        {
-          emit pointsLayerToolTipEvent(helpEvent, pointsLayerPickingResult);
-          return true;
-        }
-      }
-
-
-      {
-        auto linesLayerPickingResult = dynamic_cast<tp_maps::LinesPickingResult*>(pickingResult.get());
-        if(linesLayerPickingResult)
-        {
-          emit linesLayerToolTipEvent(helpEvent, linesLayerPickingResult);
-          return true;
-        }
-      }
-
-      event->ignore();
-      return true;
+    ProfileTimer timer("tool tip");
+    emit toolTipEvent(static_cast<QHelpEvent*>(event));
+    return true;
   }
   return QWidget::event(event);
 }
@@ -0,0 +1,160 @@
+#include "general_performance_stats_viewer/MappedFile.h"
+
+#include "tp_utils/RefCount.h"
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+struct MappedFile::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::MappedFile::Private");
+  TP_NONCOPYABLE(Private);
+
+  const char* data{nullptr};
+  size_t size{0};
+  bool isOpen{false};
+
+#ifdef _WIN32
+  HANDLE file{INVALID_HANDLE_VALUE};
+  HANDLE mapping{nullptr};
+#endif
+
+  //################################################################################################
+  Private(const std::string& path)
+  {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+      return;
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize))
+      return;
+
+    size = size_t(fileSize.QuadPart);
+    isOpen = true;
+
+    //Zero length files can't be mapped.
+    if(size==0)
+      return;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!mapping)
+    {
+      size = 0;
+      isOpen = false;
+      return;
+    }
+
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if(!data)
+    {
+      size = 0;
+      isOpen = false;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd<0)
+      return;
+
+    struct stat st;
+    if(fstat(fd, &st)!=0)
+    {
+      ::close(fd);
+      return;
+    }
+
+    size = size_t(st.st_size);
+    isOpen = true;
+
+    //Zero length files can't be mapped.
+    if(size!=0)
+    {
+      void* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(ptr == MAP_FAILED)
+      {
+        size = 0;
+        isOpen = false;
+      }
+      else
+      {
+        madvise(ptr, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(ptr);
+      }
+    }
+
+    //The mapping keeps its own reference to the file.
+    ::close(fd);
+#endif
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+#ifdef _WIN32
+    if(data)
+      UnmapViewOfFile(data);
+
+    if(mapping)
+      CloseHandle(mapping);
+
+    if(file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+#else
+    if(data)
+      munmap(const_cast<char*>(data), size);
+#endif
+  }
+};
+
+//##################################################################################################
+MappedFile::MappedFile(const std::string& path):
+  d(new Private(path))
+{
+
+}
+
+//##################################################################################################
+MappedFile::~MappedFile()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool MappedFile::isOpen() const
+{
+  return d->isOpen;
+}
+
+//##################################################################################################
+const char* MappedFile::data() const
+{
+  return d->data;
+}
+
+//##################################################################################################
+size_t MappedFile::size() const
+{
+  return d->size;
+}
+
+//##################################################################################################
+std::string_view MappedFile::view() const
+{
+  return d->data?std::string_view(d->data, d->size):std::string_view();
+}
+
+}
@@ -0,0 +1,168 @@
+#include "general_performance_stats_viewer/PagedFile.h"
+#include "general_performance_stats_viewer/MappedFile.h"
+
+#include "tp_utils/RefCount.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#endif
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+constexpr size_t tileAlignment = 1<<16;
+}
+
+//##################################################################################################
+struct PagedFile::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::PagedFile::Private");
+  TP_NONCOPYABLE(Private);
+
+  MappedFile file;
+  size_t tileSize;
+  size_t tileCount;
+
+  //The epoch each tile was last touched in, 0 if it has not been touched since it was evicted.
+  std::unique_ptr<std::atomic<uint32_t>[]> lastUsed;
+  std::atomic<uint32_t> epoch{1};
+
+  size_t budget{std::numeric_limits<size_t>::max()};
+  size_t evictedBytes{0};
+
+  //################################################################################################
+  Private(const std::string& path, size_t tileSize_):
+    file(path),
+    tileSize(std::max(tileAlignment, (tileSize_+tileAlignment-1) & ~(tileAlignment-1))),
+    tileCount((file.size()+tileSize-1)/tileSize),
+    lastUsed(new std::atomic<uint32_t>[tileCount])
+  {
+    for(size_t t=0; t<tileCount; t++)
+      lastUsed[t].store(0, std::memory_order_relaxed);
+
+#ifndef _WIN32
+    //MappedFile reads ahead for a sequential parse, tiles are read in any order.
+    if(file.data())
+      madvise(const_cast<char*>(file.data()), file.size(), MADV_NORMAL);
+#endif
+  }
+
+  //################################################################################################
+  void evict(size_t tile)
+  {
+    char* start = const_cast<char*>(file.data()) + tile*tileSize;
+    size_t size = std::min(tileSize, file.size()-tile*tileSize);
+#ifdef _WIN32
+    //Unlocking pages that are not locked removes them from the working set.
+    VirtualUnlock(start, size);
+#else
+    madvise(start, size, MADV_DONTNEED);
+#endif
+    lastUsed[tile].store(0, std::memory_order_relaxed);
+    evictedBytes += size;
+  }
+};
+
+//##################################################################################################
+PagedFile::PagedFile(const std::string& path, size_t tileSize):
+  d(new Private(path, tileSize))
+{
+
+}
+
+//##################################################################################################
+PagedFile::~PagedFile()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool PagedFile::isOpen() const
+{
+  return d->file.isOpen();
+}
+
+//##################################################################################################
+const char* PagedFile::data() const
+{
+  return d->file.data();
+}
+
+//##################################################################################################
+size_t PagedFile::size() const
+{
+  return d->file.size();
+}
+
+//##################################################################################################
+void PagedFile::touch(const void* data, size_t size) const
+{
+  auto start = static_cast<const char*>(data);
+  const char* base = d->file.data();
+  if(!base || size==0 || start<base || start>=base+d->file.size())
+    return;
+
+  size_t offset = size_t(start-base);
+  size_t first = offset/d->tileSize;
+  size_t last = std::min(d->tileCount-1, (offset+size-1)/d->tileSize);
+
+  //Only write when the epoch changes so that readers on other threads do not share the line.
+  uint32_t epoch = d->epoch.load(std::memory_order_relaxed);
+  for(size_t t=first; t<=last; t++)
+    if(d->lastUsed[t].load(std::memory_order_relaxed) != epoch)
+      d->lastUsed[t].store(epoch, std::memory_order_relaxed);
+}
+
+//##################################################################################################
+void PagedFile::setBudget(size_t budget)
+{
+  d->budget = budget;
+}
+
+//##################################################################################################
+void PagedFile::trim()
+{
+  std::vector<std::pair<uint32_t, size_t>> resident;
+  for(size_t t=0; t<d->tileCount; t++)
+    if(uint32_t used = d->lastUsed[t].load(std::memory_order_relaxed); used)
+      resident.emplace_back(used, t);
+
+  d->epoch.fetch_add(1, std::memory_order_relaxed);
+
+  size_t maxTiles = d->budget/d->tileSize;
+  if(resident.size()<=maxTiles)
+    return;
+
+  size_t evictCount = resident.size()-maxTiles;
+  std::nth_element(resident.begin(), resident.begin()+std::ptrdiff_t(evictCount-1), resident.end());
+  for(size_t i=0; i<evictCount; i++)
+    d->evict(resident.at(i).second);
+}
+
+//##################################################################################################
+PagedFileStats PagedFile::stats() const
+{
+  PagedFileStats stats;
+  stats.fileBytes = d->file.size();
+  stats.budgetBytes = d->budget;
+  stats.evictedBytes = d->evictedBytes;
+  for(size_t t=0; t<d->tileCount; t++)
+    if(d->lastUsed[t].load(std::memory_order_relaxed))
+      stats.residentBytes += std::min(d->tileSize, d->file.size()-t*d->tileSize);
+  return stats;
+}
+
+}
@@ -0,0 +1,50 @@
+#include "general_performance_stats_viewer/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+size_t defaultThreadCount()
+{
+  return std::max(size_t(1), size_t(std::thread::hardware_concurrency()));
+}
+
+//##################################################################################################
+void parallelFor(size_t count, const std::function<void(size_t)>& closure, size_t threadCount)
+{
+  if(threadCount==0)
+    threadCount = defaultThreadCount();
+
+  threadCount = std::min(threadCount, count);
+
+  if(threadCount<2)
+  {
+    for(size_t i=0; i<count; i++)
+      closure(i);
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  auto worker = [&]
+  {
+    for(size_t i=next++; i<count; i=next++)
+      closure(i);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount-1);
+  for(size_t t=1; t<threadCount; t++)
+    threads.emplace_back(worker);
+
+  worker();
+
+  for(auto& thread : threads)
+    thread.join();
+}
+
+}
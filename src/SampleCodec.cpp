@@ -0,0 +1,330 @@
+#include "general_performance_stats_viewer/SampleCodec.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+constexpr size_t maxBlockSamples = 256;
+
+//##################################################################################################
+int bitWidth(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return value?64-__builtin_clzll(value):0;
+#else
+  int width=0;
+  for(; value; value>>=1)
+    width++;
+  return width;
+#endif
+}
+
+//##################################################################################################
+constexpr uint64_t lowMask(int bits)
+{
+  return (bits>=64)?~uint64_t(0):((uint64_t(1)<<bits)-1);
+}
+
+//##################################################################################################
+uint64_t zigzag(int64_t value)
+{
+  return (uint64_t(value)<<1) ^ uint64_t(value>>63);
+}
+
+//##################################################################################################
+int64_t unzigzag(uint64_t value)
+{
+  return int64_t(value>>1) ^ -int64_t(value&1);
+}
+
+//##################################################################################################
+uint8_t* writeVarint(uint8_t* out, uint64_t value)
+{
+  for(; value>=0x80; value>>=7)
+    *out++ = uint8_t(value|0x80);
+  *out++ = uint8_t(value);
+  return out;
+}
+
+//##################################################################################################
+bool readVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+{
+  value=0;
+  for(int shift=0; shift<64 && p<end; shift+=7)
+  {
+    uint8_t byte = *p++;
+    value |= uint64_t(byte&0x7F)<<shift;
+    if(!(byte&0x80))
+      return true;
+  }
+  return false;
+}
+
+//##################################################################################################
+//! Pack a group of 8 values, which fills exactly Bits bytes.
+template<int Bits, size_t... J>
+void packGroup(uint8_t* out, const uint64_t* values, std::index_sequence<J...>)
+{
+  uint64_t words[Bits/8+1]={};
+  auto put = [&](size_t bit, uint64_t value)
+  {
+    value &= lowMask(Bits);
+    size_t shift = bit%64;
+    words[bit/64] |= value<<shift;
+    if(shift && shift+Bits>64)
+      words[bit/64+1] |= value>>(64-shift);
+  };
+  (put(J*Bits, values[J]), ...);
+  std::memcpy(out, words, Bits);
+}
+
+//##################################################################################################
+//! Unpack a group of 8 values and add offset to each, this reads up to 9 bytes past the group.
+template<int Bits, size_t... J>
+void unpackGroup(const uint8_t* data, uint64_t offset, uint64_t* values, std::index_sequence<J...>)
+{
+  auto get = [&](size_t bit)
+  {
+    uint64_t word;
+    std::memcpy(&word, data+bit/8, 8);
+    uint64_t value = word>>(bit%8);
+    if(bit%8 && Bits>int(64-bit%8))
+      value |= uint64_t(data[bit/8+8])<<(64-bit%8);
+    return value & lowMask(Bits);
+  };
+  ((values[J] = get(J*Bits) + offset), ...);
+}
+
+//##################################################################################################
+//! Pack the low Bits of each value, words are written little endian like the cache.
+/*!
+Whole groups of 8 are packed with shifts known at compile time, the last partial group is padded.
+out must have room for a whole group past the packed bytes.
+*/
+template<int Bits>
+uint8_t* packBits(uint8_t* out, const uint64_t* values, size_t count)
+{
+  if constexpr(Bits==0)
+    return out;
+  else
+  {
+    size_t i=0;
+    for(; i+8<=count; i+=8, out+=Bits)
+      packGroup<Bits>(out, values+i, std::make_index_sequence<8>());
+
+    if(i<count)
+    {
+      uint64_t last[8]={};
+      std::copy(values+i, values+count, last);
+      packGroup<Bits>(out, last, std::make_index_sequence<8>());
+      out += ((count-i)*Bits+7)/8;
+    }
+    return out;
+  }
+}
+
+//##################################################################################################
+//! Unpack values written by packBits() adding offset to each, this reads up to 9 bytes past them.
+template<int Bits>
+void unpackBits(const uint8_t* data, size_t count, uint64_t offset, uint64_t* values)
+{
+  size_t i=0;
+  for(; i+8<=count; i+=8, data+=Bits)
+    unpackGroup<Bits>(data, offset, values+i, std::make_index_sequence<8>());
+
+  for(size_t bit=0; i<count; i++, bit+=Bits)
+  {
+    uint64_t word;
+    std::memcpy(&word, data+bit/8, 8);
+    uint64_t value = word>>(bit%8);
+    if(bit%8 && Bits>int(64-bit%8))
+      value |= uint64_t(data[bit/8+8])<<(64-bit%8);
+    values[i] = (value & lowMask(Bits)) + offset;
+  }
+}
+
+using PackBits = uint8_t*(*)(uint8_t*, const uint64_t*, size_t);
+using UnpackBits = void(*)(const uint8_t*, size_t, uint64_t, uint64_t*);
+
+//##################################################################################################
+template<size_t... Bits>
+constexpr std::array<PackBits, sizeof...(Bits)> packTable(std::index_sequence<Bits...>)
+{
+  return {&packBits<int(Bits)>...};
+}
+
+//##################################################################################################
+template<size_t... Bits>
+constexpr std::array<UnpackBits, sizeof...(Bits)> unpackTable(std::index_sequence<Bits...>)
+{
+  return {&unpackBits<int(Bits)>...};
+}
+
+//The packing of each width from 0 to 64.
+constexpr auto packers = packTable(std::make_index_sequence<65>());
+constexpr auto unpackers = unpackTable(std::make_index_sequence<65>());
+
+//##################################################################################################
+//! Write a column of deltas as a frame of reference with patched exceptions.
+/*!
+\param delta - Returns the delta of the i'th sample from the one before as a uint64_t.
+*/
+template<typename Delta>
+uint8_t* encodeDeltas(uint8_t* out, size_t count, const Delta& delta)
+{
+  int64_t min = count?std::numeric_limits<int64_t>::max():0;
+  for(size_t i=0; i<count; i++)
+    min = std::min(min, int64_t(delta(i)));
+
+  //Four histograms of the offset widths, so that the counts do not wait on each other.
+  uint64_t offsets[maxBlockSamples];
+  uint8_t lanes[4][65]={};
+  uint64_t all=0;
+  for(size_t i=0; i<count; i++)
+  {
+    offsets[i] = delta(i) - uint64_t(min);
+    lanes[i&3][bitWidth(offsets[i])]++;
+    all |= offsets[i];
+  }
+
+  int maxWidth = bitWidth(all);
+  size_t widths[65];
+  for(int b=0; b<=maxWidth; b++)
+    widths[b] = size_t(lanes[0][b]) + lanes[1][b] + lanes[2][b] + lanes[3][b];
+
+  //Pick the width that packs smallest once the wider offsets are stored as exceptions.
+  int bits = maxWidth;
+  size_t best = std::numeric_limits<size_t>::max();
+  size_t wider=0;
+  for(int b=maxWidth; b>=0; b--)
+  {
+    size_t cost = count*size_t(b) + wider*size_t(8 + 8*((maxWidth-b+6)/7));
+    if(cost<best)
+    {
+      best = cost;
+      bits = b;
+    }
+    wider += widths[b];
+  }
+
+  out = writeVarint(out, zigzag(min));
+  *out++ = uint8_t(bits);
+  out = packers[size_t(bits)](out, offsets, count);
+
+  uint8_t* exceptionCount = out++;
+  *exceptionCount = 0;
+  if(bits<maxWidth)
+  {
+    for(size_t i=0; i<count; i++)
+    {
+      if(uint64_t high = offsets[i]>>bits; high)
+      {
+        *out++ = uint8_t(i);
+        out = writeVarint(out, high);
+        (*exceptionCount)++;
+      }
+    }
+  }
+
+  return out;
+}
+
+//##################################################################################################
+bool decodeDeltas(const uint8_t*& p, const uint8_t* end, size_t count, uint64_t* deltas)
+{
+  uint64_t min=0;
+  if(!readVarint(p, end, min) || p>=end)
+    return false;
+
+  int bits = *p++;
+  if(bits>64)
+    return false;
+
+  //The packed bits, the word loads that overrun them and the exception count.
+  size_t packedBytes = (count*size_t(bits)+7)/8;
+  if(size_t(end-p) < packedBytes+9)
+    return false;
+
+  auto offset = uint64_t(unzigzag(min));
+  unpackers[size_t(bits)](p, count, offset, deltas);
+  p += packedBytes;
+
+  size_t exceptionCount = *p++;
+  if(exceptionCount && bits>=64)
+    return false;
+
+  for(size_t e=0; e<exceptionCount; e++)
+  {
+    uint64_t high=0;
+    if(p>=end)
+      return false;
+    size_t i = *p++;
+    if(i>=count || !readVarint(p, end, high))
+      return false;
+    deltas[i] += high<<bits;
+  }
+
+  return true;
+}
+}
+
+//##################################################################################################
+size_t encodeSampleBlock(const SampleSpan& samples, uint8_t* out)
+{
+  if(samples.size==0)
+    return 0;
+
+  size_t count = std::min(samples.size, maxBlockSamples)-1;
+  const uint32_t* indexes = samples.indexes;
+  const uint64_t* values = samples.values;
+
+  uint8_t* p = out;
+  p = writeVarint(p, indexes[0]);
+  p = writeVarint(p, values[0]);
+  p = encodeDeltas(p, count, [&](size_t i){return uint64_t(indexes[i+1]) - uint64_t(indexes[i]);});
+  p = encodeDeltas(p, count, [&](size_t i){return values[i+1] - values[i];});
+
+  return size_t(p-out);
+}
+
+//##################################################################################################
+bool decodeSampleBlock(const uint8_t* data, const uint8_t* end, size_t count, uint32_t* indexes, uint64_t* values)
+{
+  uint64_t deltas[maxBlockSamples];
+  const uint8_t* p = data;
+  uint64_t index=0;
+  uint64_t value=0;
+
+  bool ok = (count>0 && count<=maxBlockSamples && readVarint(p, end, index) && readVarint(p, end, value));
+
+  if(ok && (ok = decodeDeltas(p, end, count-1, deltas)))
+  {
+    indexes[0] = uint32_t(index);
+    for(size_t i=1; i<count; i++)
+      indexes[i] = uint32_t(index += deltas[i-1]);
+  }
+
+  if(ok && (ok = decodeDeltas(p, end, count-1, deltas)))
+  {
+    values[0] = value;
+    for(size_t i=1; i<count; i++)
+      values[i] = (value += deltas[i-1]);
+  }
+
+  if(!ok)
+  {
+    std::fill(indexes, indexes+count, 0);
+    std::fill(values, values+count, 0);
+  }
+
+  return ok;
+}
+
+}
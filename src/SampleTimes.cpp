@@ -0,0 +1,293 @@
+#include "general_performance_stats_viewer/SampleTimes.h"
+
+#include "tp_utils/DebugUtils.h"
+#include "tp_utils/RefCount.h"
+
+#include <algorithm>
+#include <optional>
+#include <regex>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+constexpr int64_t nanosecondsPerSecond = 1000000000;
+constexpr int64_t nanosecondsPerDay = 86400*nanosecondsPerSecond;
+
+//##################################################################################################
+bool isDigit(char c)
+{
+  return c>='0' && c<='9';
+}
+
+//##################################################################################################
+//! Read exactly count digits.
+bool readDigits(const char*& p, const char* end, int count, int64_t& value)
+{
+  if(end-p<count)
+    return false;
+
+  value=0;
+  for(int i=0; i<count; i++, p++)
+  {
+    if(!isDigit(*p))
+      return false;
+    value = value*10 + (*p-'0');
+  }
+  return true;
+}
+
+//##################################################################################################
+bool readChar(const char*& p, const char* end, char c)
+{
+  if(p<end && *p==c)
+  {
+    p++;
+    return true;
+  }
+  return false;
+}
+
+//##################################################################################################
+//! Read an optional fraction of a second, digits beyond nanoseconds are ignored.
+int64_t readFraction(const char*& p, const char* end)
+{
+  if(p+1>=end || (*p!='.' && *p!=',') || !isDigit(p[1]))
+    return 0;
+
+  p++;
+  int64_t value=0;
+  int64_t scale=nanosecondsPerSecond;
+  for(; p<end && isDigit(*p); p++)
+  {
+    if(scale>1)
+    {
+      scale /= 10;
+      value += (*p-'0')*scale;
+    }
+  }
+  return value;
+}
+
+//##################################################################################################
+//! hh:mm:ss[.fff] as nanoseconds since midnight.
+bool readTimeOfDay(const char*& p, const char* end, int64_t& time)
+{
+  int64_t hours=0;
+  int64_t minutes=0;
+  int64_t seconds=0;
+  if(!readDigits(p, end, 2, hours) || !readChar(p, end, ':') ||
+     !readDigits(p, end, 2, minutes) || !readChar(p, end, ':') ||
+     !readDigits(p, end, 2, seconds))
+    return false;
+
+  if(hours>23 || minutes>59 || seconds>60 || (p<end && isDigit(*p)))
+    return false;
+
+  time = ((hours*60 + minutes)*60 + seconds)*nanosecondsPerSecond + readFraction(p, end);
+  return true;
+}
+
+//##################################################################################################
+//! Days since 1970-01-01 of a date in the proleptic Gregorian calendar.
+int64_t daysFromCivil(int64_t y, int64_t m, int64_t d)
+{
+  y -= (m<=2)?1:0;
+  int64_t era = ((y>=0)?y:y-399) / 400;
+  int64_t yoe = y - era*400;
+  int64_t doy = (153*(m + ((m>2)?-3:9)) + 2)/5 + d-1;
+  int64_t doe = yoe*365 + yoe/4 - yoe/100 + doy;
+  return era*146097 + doe - 719468;
+}
+
+//##################################################################################################
+//! YYYY-MM-DD[T ]hh:mm:ss[.fff] as nanoseconds since the epoch.
+bool readDateTime(const char*& p, const char* end, int64_t& time)
+{
+  int64_t year=0;
+  int64_t month=0;
+  int64_t day=0;
+  if(!readDigits(p, end, 4, year) || !readChar(p, end, '-') ||
+     !readDigits(p, end, 2, month) || !readChar(p, end, '-') ||
+     !readDigits(p, end, 2, day))
+    return false;
+
+  if(month<1 || month>12 || day<1 || day>31)
+    return false;
+
+  if(!readChar(p, end, 'T') && !readChar(p, end, ' '))
+    return false;
+
+  int64_t timeOfDay=0;
+  if(!readTimeOfDay(p, end, timeOfDay))
+    return false;
+
+  time = daysFromCivil(year, month, day)*nanosecondsPerDay + timeOfDay;
+  return true;
+}
+
+//##################################################################################################
+//! Seconds since the epoch, only if text holds nothing else.
+bool readEpochSeconds(std::string_view text, int64_t& time)
+{
+  while(!text.empty() && (text.front()==' ' || text.front()=='\t'))
+    text.remove_prefix(1);
+  while(!text.empty() && (text.back()==' ' || text.back()=='\t' || text.back()=='\r'))
+    text.remove_suffix(1);
+
+  const char* p = text.data();
+  const char* end = p+text.size();
+  if(p==end || (end-p)>30)
+    return false;
+
+  //Checked before each digit so that a long run of digits can not overflow.
+  constexpr int64_t maxSeconds = std::numeric_limits<int64_t>::max()/nanosecondsPerSecond-1;
+  int64_t seconds=0;
+  for(; p<end && isDigit(*p); p++)
+  {
+    int64_t digit = *p-'0';
+    if(seconds>(maxSeconds-digit)/10)
+      return false;
+    seconds = seconds*10 + digit;
+  }
+
+  if(p==text.data())
+    return false;
+
+  int64_t fraction = readFraction(p, end);
+  if(p!=end)
+    return false;
+
+  time = seconds*nanosecondsPerSecond + fraction;
+  return true;
+}
+}
+
+//##################################################################################################
+bool parseTimestamp(std::string_view text, int64_t& time)
+{
+  const char* begin = text.data();
+  const char* end = begin+text.size();
+
+  //Prefer a full date, then a time of day, each must start on a digit that follows a non digit.
+  for(int pass=0; pass<2; pass++)
+  {
+    for(const char* start=begin; start<end; start++)
+    {
+      if(!isDigit(*start) || (start>begin && isDigit(start[-1])))
+        continue;
+
+      const char* p = start;
+      if(pass==0?readDateTime(p, end, time):readTimeOfDay(p, end, time))
+        return true;
+    }
+  }
+
+  return readEpochSeconds(text, time);
+}
+
+//##################################################################################################
+struct TimestampParser::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::TimestampParser::Private");
+  TP_NONCOPYABLE(Private);
+
+  std::optional<std::regex> regex;
+
+  //################################################################################################
+  Private() = default;
+};
+
+//##################################################################################################
+TimestampParser::TimestampParser(const std::string& pattern):
+  d(new Private())
+{
+  if(pattern.empty())
+    return;
+
+  try
+  {
+    d->regex.emplace(pattern, std::regex::ECMAScript|std::regex::optimize);
+  }
+  catch(const std::regex_error& e)
+  {
+    tpWarning() << "Invalid timestamp pattern: " << pattern << " " << e.what();
+  }
+}
+
+//##################################################################################################
+TimestampParser::~TimestampParser()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool TimestampParser::parse(std::string_view prefix, int64_t& time) const
+{
+  if(!d->regex)
+    return parseTimestamp(prefix, time);
+
+  std::match_results<std::string_view::const_iterator> match;
+  if(!std::regex_search(prefix.begin(), prefix.end(), match, *d->regex))
+    return false;
+
+  const auto& group = (match.size()>1 && match[1].matched)?match[1]:match[0];
+  return parseTimestamp(std::string_view(prefix.data()+(group.first-prefix.begin()), size_t(group.length())), time);
+}
+
+//##################################################################################################
+int64_t sampleTimeWrap(int64_t previous, int64_t time)
+{
+  constexpr int64_t halfDay = nanosecondsPerDay/2;
+  if(time>=previous-halfDay)
+    return 0;
+
+  return ((previous-time+halfDay) / nanosecondsPerDay) * nanosecondsPerDay;
+}
+
+//##################################################################################################
+void finishSampleTimes(std::vector<int64_t>& times)
+{
+  auto first = std::find_if(times.begin(), times.end(), [](int64_t t){return t!=noSampleTime;});
+  if(first==times.end())
+  {
+    times.clear();
+    return;
+  }
+
+  //Unwrap and make the known times non-decreasing.
+  int64_t offset=0;
+  int64_t previous=*first;
+  for(auto i=first; i!=times.end(); ++i)
+  {
+    if(*i==noSampleTime)
+      continue;
+
+    offset += sampleTimeWrap(previous, *i+offset);
+    *i = std::max(previous, *i+offset);
+    previous = *i;
+  }
+
+  //Fill the gaps.
+  size_t known = size_t(first-times.begin());
+  std::fill(times.begin(), first, *first);
+  for(size_t i=known+1; i<times.size(); i++)
+  {
+    if(times.at(i)==noSampleTime)
+      continue;
+
+    size_t gap = i-known;
+    if(gap>1)
+    {
+      double step = double(times.at(i)-times.at(known)) / double(gap);
+      for(size_t j=1; j<gap; j++)
+        times.at(known+j) = times.at(known) + int64_t(step*double(j));
+    }
+    known = i;
+  }
+
+  std::fill(times.begin()+std::ptrdiff_t(known)+1, times.end(), times.at(known));
+}
+
+}
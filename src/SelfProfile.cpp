@@ -0,0 +1,218 @@
+#include "general_performance_stats_viewer/SelfProfile.h"
+#include "general_performance_stats_viewer/StatsParser.h"
+
+#include "tp_utils/RefCount.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//##################################################################################################
+//! UTC "YYYY-MM-DD hh:mm:ss.uuuuuu", this is one of the formats that parseTimestamp() reads.
+std::string formatTimestamp(std::chrono::system_clock::time_point time)
+{
+  int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+  int64_t days = us / 86400000000;
+  int64_t ofDay = us % 86400000000;
+  if(ofDay<0)
+  {
+    days--;
+    ofDay += 86400000000;
+  }
+
+  //Civil date from days since 1970-01-01, the inverse of daysFromCivil() in SampleTimes.cpp.
+  int64_t z = days + 719468;
+  int64_t era = ((z>=0)?z:z-146096) / 146097;
+  int64_t doe = z - era*146097;
+  int64_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+  int64_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+  int64_t mp = (5*doy + 2)/153;
+  int64_t day = doy - (153*mp+2)/5 + 1;
+  int64_t month = mp + ((mp<10)?3:-9);
+  int64_t year = yoe + era*400 + ((month<=2)?1:0);
+
+  char buffer[40];
+  std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d.%06d",
+                int(year), int(month), int(day),
+                int(ofDay/3600000000), int(ofDay/60000000%60), int(ofDay/1000000%60), int(ofDay%1000000));
+  return buffer;
+}
+}
+
+//##################################################################################################
+struct SelfProfile::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::SelfProfile::Private");
+  TP_NONCOPYABLE(Private);
+
+  mutable std::mutex mutex;
+  std::vector<ProfileEntry> entries;
+  std::ofstream record;
+
+  //################################################################################################
+  Private() = default;
+
+  //################################################################################################
+  ProfileEntry& entry(const char* name, ProfileEntryType type)
+  {
+    for(auto& entry : entries)
+      if(entry.name==name || std::strcmp(entry.name, name)==0)
+        return entry;
+
+    auto& entry = entries.emplace_back();
+    entry.name = name;
+    entry.type = type;
+    return entry;
+  }
+
+  //################################################################################################
+  void write(const std::vector<ProfileEntry>& sample)
+  {
+    std::string prefix = formatTimestamp(std::chrono::system_clock::now()) + ' ';
+    std::string lines = prefix;
+    lines += statsLineStart;
+    lines += statsSeparator;
+    lines += statsLineEnd;
+    lines += '\n';
+
+    auto line = [&](const char* name, const char* suffix, uint64_t value)
+    {
+      lines += prefix;
+      lines += statsLineStart;
+      lines += name;
+      lines += suffix;
+      lines += statsDelimiter;
+      lines += std::to_string(value);
+      lines += statsLineEnd;
+      lines += '\n';
+    };
+
+    for(const auto& entry : sample)
+    {
+      if(entry.type==ProfileEntryType::Time)
+      {
+        line(entry.name, " us", entry.total/1000);
+        line(entry.name, " calls", entry.count);
+      }
+      else
+        line(entry.name, "", entry.total);
+    }
+
+    record << lines;
+    record.flush();
+  }
+};
+
+//##################################################################################################
+SelfProfile::SelfProfile():
+  d(new Private())
+{
+
+}
+
+//##################################################################################################
+SelfProfile::~SelfProfile()
+{
+  delete d;
+}
+
+//##################################################################################################
+void SelfProfile::addTime(const char* name, std::chrono::steady_clock::duration duration)
+{
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  std::lock_guard<std::mutex> lock(d->mutex);
+  auto& entry = d->entry(name, ProfileEntryType::Time);
+  entry.total += uint64_t(std::max(int64_t(0), int64_t(ns)));
+  entry.count++;
+}
+
+//##################################################################################################
+void SelfProfile::addCount(const char* name, uint64_t count)
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  auto& entry = d->entry(name, ProfileEntryType::Count);
+  entry.total += count;
+  entry.count++;
+}
+
+//##################################################################################################
+void SelfProfile::setValue(const char* name, uint64_t value)
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  auto& entry = d->entry(name, ProfileEntryType::Value);
+  entry.total = value;
+  entry.count = 1;
+}
+
+//##################################################################################################
+bool SelfProfile::setRecordPath(const std::string& path)
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->record.close();
+  d->record.clear();
+  if(path.empty())
+    return true;
+
+  d->record.open(path, std::ios::binary|std::ios::trunc);
+  return d->record.is_open();
+}
+
+//##################################################################################################
+bool SelfProfile::recording() const
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return d->record.is_open();
+}
+
+//##################################################################################################
+std::vector<ProfileEntry> SelfProfile::takeSample()
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  std::vector<ProfileEntry> sample = d->entries;
+
+  //Values persist, timers and counters start again from zero.
+  for(auto& entry : d->entries)
+  {
+    if(entry.type!=ProfileEntryType::Value)
+    {
+      entry.total = 0;
+      entry.count = 0;
+    }
+  }
+
+  if(d->record.is_open())
+    d->write(sample);
+
+  return sample;
+}
+
+//##################################################################################################
+SelfProfile& selfProfile()
+{
+  static SelfProfile profile;
+  return profile;
+}
+
+//##################################################################################################
+ProfileTimer::ProfileTimer(const char* name, SelfProfile& profile):
+  m_name(name),
+  m_profile(profile),
+  m_start(std::chrono::steady_clock::now())
+{
+
+}
+
+//##################################################################################################
+ProfileTimer::~ProfileTimer()
+{
+  m_profile.addTime(m_name, std::chrono::steady_clock::now() - m_start);
+}
+
+}
@@ -0,0 +1,94 @@
+#include "general_performance_stats_viewer/StatsFollower.h"
+#include "general_performance_stats_viewer/StatsParser.h"
+#include "general_performance_stats_viewer/StatsLoader.h"
+
+#include "tp_utils/RefCount.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+struct StatsFollower::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::StatsFollower::Private");
+  TP_NONCOPYABLE(Private);
+
+  std::string path;
+  size_t offset;
+  std::string timestampPattern;
+  std::string buffer;
+  TraceStore appended;
+
+  //################################################################################################
+  Private(const std::string& path_, size_t offset_, const std::string& timestampPattern_):
+    path(path_),
+    offset(offset_),
+    timestampPattern(timestampPattern_)
+  {
+
+  }
+};
+
+//##################################################################################################
+StatsFollower::StatsFollower(const std::string& path, size_t offset, const std::string& timestampPattern):
+  d(new Private(path, offset, timestampPattern))
+{
+
+}
+
+//##################################################################################################
+StatsFollower::~StatsFollower()
+{
+  delete d;
+}
+
+//##################################################################################################
+const std::string& StatsFollower::path() const
+{
+  return d->path;
+}
+
+//##################################################################################################
+size_t StatsFollower::offset() const
+{
+  return d->offset;
+}
+
+//##################################################################################################
+bool StatsFollower::poll(TraceStore& store, std::vector<TraceID>& changedTraces, size_t maxBytes)
+{
+  changedTraces.clear();
+
+  std::ifstream in(d->path, std::ios::binary|std::ios::ate);
+  if(!in)
+    return false;
+
+  auto fileSize = size_t(in.tellg());
+  if(fileSize<d->offset)
+    return false;
+
+  size_t available = std::min(fileSize-d->offset, maxBytes);
+  if(available==0)
+    return true;
+
+  d->buffer.resize(available);
+  in.seekg(std::streamoff(d->offset));
+  in.read(d->buffer.data(), std::streamsize(available));
+  d->buffer.resize(size_t(in.gcount()));
+
+  //Parse the complete lines as a block that continues the store, as the background loader does.
+  auto data = std::string_view(d->buffer).substr(0, completeLinesSize(d->buffer));
+  if(!loadStats(data, d->appended, 0, d->timestampPattern) ||
+     store.sampleCount()+d->appended.sampleCount()>maxSampleCount)
+    return false;
+
+  store.appendStore(d->appended, changedTraces);
+  d->offset += data.size();
+
+  return true;
+}
+
+}
@@ -0,0 +1,340 @@
+#include "general_performance_stats_viewer/StatsLoadJob.h"
+#include "general_performance_stats_viewer/StatsLoader.h"
+#include "general_performance_stats_viewer/StatsParser.h"
+#include "general_performance_stats_viewer/MappedFile.h"
+
+#include "tp_utils/DebugUtils.h"
+#include "tp_utils/RefCount.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+constexpr size_t firstBlockSize = 4<<20;
+constexpr size_t maximumBlockSize = 64<<20;
+
+//##################################################################################################
+//! A copy of store with "<label>/" before each trace name, as StatsMergeMode::Namespaced names them.
+std::unique_ptr<TraceStore> namespacedStore(const TraceStore& store, const std::string& label)
+{
+  auto result = std::make_unique<TraceStore>();
+  std::string name;
+  for(TraceID t=0; t<store.traceCount(); t++)
+  {
+    const auto& src = store.trace(t);
+    name = label;
+    name += '/';
+    name += src.name;
+    result->trace(result->addTrace(name)).assign(src);
+  }
+
+  result->setSampleCount(store.sampleCount());
+  auto times = store.sampleTimes();
+  result->setSampleTimes(std::move(times));
+  result->updateTotals();
+  return result;
+}
+}
+
+//##################################################################################################
+struct StatsLoadJob::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::StatsLoadJob::Private");
+  TP_NONCOPYABLE(Private);
+
+  std::vector<std::string> paths;
+  StatsMergeMode mode{StatsMergeMode::Namespaced};
+  bool completeLinesOnly{false};
+  size_t threadCount;
+  std::string timestampPattern;
+
+  std::atomic_bool cancelled{false};
+  std::atomic_bool finished{false};
+  std::atomic_bool failed{false};
+  std::atomic_size_t fileSize{0};
+  std::atomic_size_t parsedBytes{0};
+
+  std::mutex mutex;
+  std::vector<std::pair<std::unique_ptr<TraceStore>, size_t>> blocks;
+  std::vector<TraceDelta> deltas;
+  bool hasDeltas{false};
+  size_t takenBytes{0};
+
+  std::thread thread;
+
+  //################################################################################################
+  Private(size_t threadCount_, const std::string& timestampPattern_):
+    threadCount(threadCount_),
+    timestampPattern(timestampPattern_)
+  {
+
+  }
+
+  //################################################################################################
+  void run()
+  {
+    if(paths.size()==1)
+      runFile();
+    else
+      runFiles();
+
+    finished = true;
+  }
+
+  //################################################################################################
+  void runFile()
+  {
+    MappedFile file(paths.front());
+    if(!file.isOpen())
+    {
+      failed = true;
+      return;
+    }
+
+    auto data = file.view();
+    if(completeLinesOnly)
+      data = data.substr(0, completeLinesSize(data));
+    fileSize = data.size();
+
+    size_t offset=0;
+    size_t sampleCount=0;
+    size_t blockSize=firstBlockSize;
+    while(offset<data.size() && !cancelled)
+    {
+      auto remaining = data.substr(offset);
+      auto block = remaining;
+      if(remaining.size()>blockSize)
+      {
+        block = remaining.substr(0, completeLinesSize(remaining.substr(0, blockSize)));
+
+        //A line longer than the block, try again with a bigger block.
+        if(block.empty())
+        {
+          blockSize *= 2;
+          continue;
+        }
+      }
+
+      auto store = std::make_unique<TraceStore>();
+      if(!loadStats(block, *store, threadCount, timestampPattern))
+      {
+        failed = true;
+        return;
+      }
+
+      //The blocks are appended into one store, keep what has been loaded so far if it would overflow.
+      sampleCount += store->sampleCount();
+      if(sampleCount>maxSampleCount)
+      {
+        tpWarning() << "Too many samples to load, stopped after " << offset << " bytes.";
+        failed = true;
+        return;
+      }
+
+      offset += block.size();
+      parsedBytes = offset;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        blocks.emplace_back(std::move(store), block.size());
+      }
+
+      if(blockSize<maximumBlockSize)
+        blockSize *= 2;
+    }
+  }
+
+  //################################################################################################
+  void runFiles()
+  {
+    std::vector<size_t> sizes;
+    size_t totalSize=0;
+    for(const auto& path : paths)
+    {
+      std::error_code ec;
+      auto size = std::filesystem::file_size(path, ec);
+      sizes.push_back(ec?0:size_t(size));
+      totalSize += sizes.back();
+    }
+    fileSize = totalSize;
+
+    if(mode==StatsMergeMode::Namespaced)
+    {
+      runNamespacedFiles(sizes);
+      return;
+    }
+
+    auto progress = [&](size_t, size_t bytes, bool)
+    {
+      parsedBytes += bytes;
+    };
+
+    auto store = std::make_unique<TraceStore>();
+    std::vector<TraceDelta> fileDeltas;
+    if(!loadStatsFiles(paths, mode, *store, fileDeltas, threadCount, timestampPattern, &cancelled, progress))
+      failed = true;
+
+    if(cancelled)
+      return;
+
+    parsedBytes = totalSize;
+    std::lock_guard<std::mutex> lock(mutex);
+    blocks.emplace_back(std::move(store), totalSize);
+    deltas = std::move(fileDeltas);
+    hasDeltas = (mode==StatsMergeMode::Difference);
+  }
+
+  //################################################################################################
+  //! Hand out each file as a block as soon as it has been parsed, the biggest files first.
+  /*!
+  The files are parsed side by side so the blocks are merged with TraceStore::mergeStore(). The
+  first block sets the X scale, so the smaller files wait for the bigger ones.
+  */
+  void runNamespacedFiles(const std::vector<size_t>& sizes)
+  {
+    std::vector<size_t> order(paths.size());
+    for(size_t f=0; f<order.size(); f++)
+      order.at(f) = f;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+      return sizes.at(a)>sizes.at(b);
+    });
+
+    auto labels = statsFileLabels(paths);
+    std::vector<std::unique_ptr<TraceStore>> fileStores;
+    std::vector<bool> parsed(paths.size(), false);
+    size_t next=0;
+    std::mutex publishMutex;
+
+    auto progress = [&](size_t f, size_t bytes, bool finished)
+    {
+      parsedBytes += bytes;
+      if(!finished)
+        return;
+
+      std::lock_guard<std::mutex> publishLock(publishMutex);
+      parsed.at(f) = true;
+      for(; next<order.size() && parsed.at(order.at(next)) && !cancelled; next++)
+      {
+        size_t p = order.at(next);
+        auto store = namespacedStore(*fileStores.at(p), labels.at(p));
+        fileStores.at(p).reset();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        blocks.emplace_back(std::move(store), sizes.at(p));
+      }
+    };
+
+    if(!loadStatsFileStores(paths, fileStores, threadCount, timestampPattern, &cancelled, progress))
+      failed = true;
+  }
+};
+
+//##################################################################################################
+StatsLoadJob::StatsLoadJob(const std::string& path,
+                           bool completeLinesOnly,
+                           size_t threadCount,
+                           const std::string& timestampPattern):
+  d(new Private(threadCount, timestampPattern))
+{
+  d->paths.push_back(path);
+  d->completeLinesOnly = completeLinesOnly;
+  d->thread = std::thread([this]{d->run();});
+}
+
+//##################################################################################################
+StatsLoadJob::StatsLoadJob(const std::vector<std::string>& paths,
+                           StatsMergeMode mode,
+                           size_t threadCount,
+                           const std::string& timestampPattern):
+  d(new Private(threadCount, timestampPattern))
+{
+  d->paths = paths;
+  d->mode = mode;
+  d->thread = std::thread([this]{d->run();});
+}
+
+//##################################################################################################
+StatsLoadJob::~StatsLoadJob()
+{
+  cancel();
+  d->thread.join();
+  delete d;
+}
+
+//##################################################################################################
+void StatsLoadJob::cancel()
+{
+  d->cancelled = true;
+}
+
+//##################################################################################################
+void StatsLoadJob::takeBlocks(std::vector<std::unique_ptr<TraceStore>>& blocks)
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  for(auto& block : d->blocks)
+  {
+    blocks.push_back(std::move(block.first));
+    d->takenBytes += block.second;
+  }
+  d->blocks.clear();
+}
+
+//##################################################################################################
+bool StatsLoadJob::takeTraceDeltas(std::vector<TraceDelta>& deltas)
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  if(!d->hasDeltas)
+    return false;
+
+  deltas = std::move(d->deltas);
+  d->deltas.clear();
+  d->hasDeltas = false;
+  return true;
+}
+
+//##################################################################################################
+bool StatsLoadJob::mergeBlocks() const
+{
+  return d->paths.size()>1 && d->mode==StatsMergeMode::Namespaced;
+}
+
+//##################################################################################################
+bool StatsLoadJob::finished() const
+{
+  return d->finished;
+}
+
+//##################################################################################################
+bool StatsLoadJob::failed() const
+{
+  return d->failed;
+}
+
+//##################################################################################################
+size_t StatsLoadJob::fileSize() const
+{
+  return d->fileSize;
+}
+
+//##################################################################################################
+size_t StatsLoadJob::takenBytes() const
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return d->takenBytes;
+}
+
+//##################################################################################################
+size_t StatsLoadJob::parsedBytes() const
+{
+  return d->parsedBytes;
+}
+
+}
@@ -0,0 +1,184 @@
+#include "general_performance_stats_viewer/StatsLoader.h"
+#include "general_performance_stats_viewer/StatsParser.h"
+#include "general_performance_stats_viewer/SampleTimes.h"
+#include "general_performance_stats_viewer/Parallel.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <memory_resource>
+#include <unordered_map>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//Below this size the cost of starting threads outweighs the gain.
+constexpr size_t minimumChunkSize = 1<<20;
+
+//##################################################################################################
+struct LocalTrace_lt
+{
+  std::string_view name;
+  std::pmr::vector<uint32_t> indexes;
+  std::pmr::vector<uint64_t> values;
+
+  //################################################################################################
+  LocalTrace_lt(std::string_view name_, std::pmr::memory_resource* resource):
+    name(name_),
+    indexes(resource),
+    values(resource)
+  {
+
+  }
+};
+
+//##################################################################################################
+struct ChunkResult_lt
+{
+  //Each chunk is parsed by a single thread, so its local traces use unsynchronized pools that are
+  //freed in one go once they have been merged. Only small columns are pooled, large columns would
+  //leave their old storage in the pools as they grow.
+  std::pmr::unsynchronized_pool_resource scratch{std::pmr::pool_options{0, 256}};
+
+  size_t separatorCount{0};
+  size_t sampleOffset{0};
+  std::vector<int64_t> times{noSampleTime};
+  std::pmr::unordered_map<std::string_view, size_t> traceIndexes{&scratch};
+  std::pmr::vector<LocalTrace_lt> traces{&scratch};
+};
+
+//##################################################################################################
+struct MergeJob_lt
+{
+  Trace* dst{nullptr};
+  std::vector<std::pair<size_t, size_t>> parts;
+};
+}
+
+//##################################################################################################
+bool loadStats(std::string_view data, TraceStore& store, size_t threadCount, const std::string& timestampPattern)
+{
+  store.clear();
+  TimestampParser timestampParser(timestampPattern);
+
+  if(threadCount==0)
+    threadCount = defaultThreadCount();
+
+  //Use more chunks than threads so that uneven chunks are balanced across the pool.
+  size_t chunkCount = std::max(size_t(1), std::min(threadCount*4, data.size()/minimumChunkSize));
+  auto chunks = splitStatsChunks(data, chunkCount);
+
+  //-- Parse each chunk into its own local traces ---------------------------------------------------
+  std::vector<ChunkResult_lt> results(chunks.size());
+  parallelFor(chunks.size(), [&](size_t c)
+  {
+    auto& result = results.at(c);
+    parseStats(chunks.at(c), [&]
+    {
+      result.separatorCount++;
+      result.times.push_back(noSampleTime);
+    },
+    [&](std::string_view name, size_t value)
+    {
+      auto i = result.traceIndexes.find(name);
+      if(i == result.traceIndexes.end())
+      {
+        i = result.traceIndexes.emplace(name, result.traces.size()).first;
+        result.traces.emplace_back(name, &result.scratch);
+      }
+
+      auto& trace = result.traces[i->second];
+      trace.indexes.push_back(uint32_t(result.separatorCount));
+      trace.values.push_back(value);
+    },
+    [&](std::string_view prefix)
+    {
+      if(result.times.back()==noSampleTime)
+        timestampParser.parse(prefix, result.times.back());
+    });
+  }, threadCount);
+
+  //-- Prefix sum the separator counts to find the global sample offset of each chunk ---------------
+  size_t sampleCount=0;
+  for(auto& result : results)
+  {
+    result.sampleOffset = sampleCount;
+    sampleCount += result.separatorCount;
+  }
+
+  //The local indexes of a chunk can only have wrapped if the total is out of range too.
+  if(sampleCount>maxSampleCount)
+  {
+    tpWarning() << "Too many samples to load: " << sampleCount << ", the limit is " << maxSampleCount << ".";
+    return false;
+  }
+  store.setSampleCount(sampleCount);
+
+  //-- The first sample of each chunk continues the last sample of the chunk before it --------------
+  {
+    std::vector<int64_t> times(sampleCount+1, noSampleTime);
+    for(const auto& result : results)
+      for(size_t i=0; i<result.times.size(); i++)
+        if(auto& time = times.at(result.sampleOffset+i); time==noSampleTime)
+          time = result.times.at(i);
+
+    finishSampleTimes(times);
+    store.setSampleTimes(std::move(times));
+  }
+
+  //-- Create the global traces and collect the chunk parts that belong to each ---------------------
+  std::vector<MergeJob_lt> jobs;
+  {
+    std::unordered_map<std::string_view, size_t> jobIndexes;
+    for(size_t c=0; c<results.size(); c++)
+    {
+      const auto& result = results.at(c);
+      for(size_t t=0; t<result.traces.size(); t++)
+      {
+        const auto& trace = result.traces.at(t);
+        auto i = jobIndexes.find(trace.name);
+        if(i == jobIndexes.end())
+        {
+          i = jobIndexes.emplace(trace.name, jobs.size()).first;
+          jobs.emplace_back().dst = &store.trace(store.addTrace(trace.name));
+        }
+
+        jobs[i->second].parts.emplace_back(c, t);
+      }
+    }
+  }
+
+  //-- Merge the local traces in chunk order, offsetting the sample indexes and compressing --------
+  parallelFor(jobs.size(), [&](size_t j)
+  {
+    auto& job = jobs.at(j);
+
+    size_t count=0;
+    for(const auto& part : job.parts)
+      count += results.at(part.first).traces.at(part.second).indexes.size();
+
+    SampleBuffer buffer;
+    buffer.indexes.reserve(count);
+    buffer.values.reserve(count);
+
+    for(const auto& part : job.parts)
+    {
+      const auto& result = results.at(part.first);
+      const auto& src = result.traces.at(part.second);
+
+      auto offset = uint32_t(result.sampleOffset);
+      for(auto index : src.indexes)
+        buffer.indexes.push_back(index+offset);
+      buffer.values.insert(buffer.values.end(), src.values.begin(), src.values.end());
+    }
+
+    job.dst->assign({buffer.indexes.data(), buffer.values.data(), count});
+  }, threadCount);
+
+  store.updateTotals();
+  return true;
+}
+
+}
@@ -0,0 +1,414 @@
+#include "general_performance_stats_viewer/StatsMerge.h"
+#include "general_performance_stats_viewer/StatsParser.h"
+#include "general_performance_stats_viewer/MappedFile.h"
+#include "general_performance_stats_viewer/Parallel.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//Files are parsed in blocks of about this size, a cancelled load stops at the end of a block.
+constexpr size_t fileBlockSize = 64<<20;
+
+//##################################################################################################
+struct MergeJob_lt
+{
+  TraceID dst{invalidTraceID};
+  std::vector<const Trace*> sources;
+};
+
+//##################################################################################################
+//! Share threadCount between files in proportion to their sizes, each file gets at least one.
+/*!
+If there are more files than threads each file gets one thread and they take turns.
+*/
+std::vector<size_t> shareThreads(const std::vector<size_t>& sizes, size_t threadCount)
+{
+  std::vector<size_t> shares(sizes.size(), 1);
+  if(sizes.size()>=threadCount)
+    return shares;
+
+  //The spare threads are shared out by the largest remainder method.
+  size_t spare = threadCount-sizes.size();
+  double total = 0.0;
+  for(auto size : sizes)
+    total += double(size);
+  if(total<=0.0)
+    return shares;
+
+  std::vector<std::pair<double, size_t>> remainders;
+  size_t given=0;
+  for(size_t f=0; f<sizes.size(); f++)
+  {
+    double share = double(spare)*double(sizes.at(f))/total;
+    auto whole = size_t(share);
+    shares.at(f) += whole;
+    given += whole;
+    remainders.emplace_back(share-double(whole), f);
+  }
+
+  std::sort(remainders.begin(), remainders.end(), std::greater<>());
+  for(size_t r=0; given<spare && r<remainders.size(); r++, given++)
+    shares.at(remainders.at(r).second)++;
+
+  return shares;
+}
+
+//##################################################################################################
+//! Parse a file a block at a time, appending each block to store.
+/*!
+\param parsed - Called with the size of each block once it has been parsed.
+\return false if the file could not be opened or loaded, or the load was cancelled.
+*/
+bool loadStatsFile(const std::string& path,
+                   TraceStore& store,
+                   size_t threadCount,
+                   const std::string& timestampPattern,
+                   const std::atomic_bool* cancelled,
+                   const std::function<void(size_t)>& parsed)
+{
+  MappedFile file(path);
+  if(!file.isOpen())
+    return false;
+
+  auto data = file.view();
+  TraceStore block;
+  std::vector<TraceID> changedTraces;
+  size_t blockSize = fileBlockSize;
+  for(size_t offset=0; offset<data.size();)
+  {
+    if(cancelled && *cancelled)
+      return false;
+
+    auto remaining = data.substr(offset);
+    auto text = remaining;
+    if(remaining.size()>blockSize)
+    {
+      text = remaining.substr(0, completeLinesSize(remaining.substr(0, blockSize)));
+
+      //A line longer than the block, try again with a bigger block.
+      if(text.empty())
+      {
+        blockSize *= 2;
+        continue;
+      }
+    }
+
+    //The first block is parsed straight into the store, later blocks are appended to it.
+    if(!loadStats(text, offset?block:store, threadCount, timestampPattern))
+    {
+      store.clear();
+      return false;
+    }
+
+    if(offset)
+    {
+      if(store.sampleCount()+block.sampleCount()>maxSampleCount)
+      {
+        tpWarning() << "Too many samples to load: " << path;
+        store.clear();
+        return false;
+      }
+
+      changedTraces.clear();
+      store.appendStore(block, changedTraces);
+    }
+
+    offset += text.size();
+    parsed(text.size());
+  }
+
+  return true;
+}
+
+//##################################################################################################
+//! Reads the samples of a trace in order, decoding a few blocks at a time.
+struct Cursor_lt
+{
+  static constexpr size_t spanSize = 16*sampleBlockSize;
+
+  const Trace* trace{nullptr};
+  SampleBuffer buffer;
+  SampleSpan span;
+  size_t p{0};
+  size_t next{0}; //!< The position in the trace of the end of span.
+
+  //################################################################################################
+  Cursor_lt(const Trace* trace_):
+    trace(trace_)
+  {
+    fill();
+  }
+
+  //################################################################################################
+  bool done() const
+  {
+    return p==span.size;
+  }
+
+  //################################################################################################
+  uint32_t index() const
+  {
+    return span.indexes[p];
+  }
+
+  //################################################################################################
+  uint64_t value() const
+  {
+    return span.values[p];
+  }
+
+  //################################################################################################
+  void advance()
+  {
+    p++;
+    if(p==span.size)
+      fill();
+  }
+
+  //################################################################################################
+  void fill()
+  {
+    size_t count = std::min(spanSize, trace->size()-next);
+    span = trace->samples(next, count, buffer);
+    next += count;
+    p = 0;
+  }
+};
+
+//##################################################################################################
+//! Sum the sources at each sample index with a k-way merge.
+/*!
+Only values from different sources are added. A source with several samples at one index is
+matched against the samples of the other sources at that index, each holding its last value, so
+the samples of an index that is only in one source are copied unchanged.
+*/
+void sumTraces(const std::vector<const Trace*>& sources, Trace& dst)
+{
+  using Head = std::pair<uint32_t, size_t>;
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+  std::vector<Cursor_lt> cursors;
+  cursors.reserve(sources.size());
+  for(size_t s=0; s<sources.size(); s++)
+    if(!cursors.emplace_back(sources.at(s)).done())
+      heads.emplace(cursors.back().index(), s);
+
+  std::vector<uint64_t> held(sources.size(), 0);
+  std::vector<size_t> active;
+  while(!heads.empty())
+  {
+    uint32_t index = heads.top().first;
+    active.clear();
+    for(; !heads.empty() && heads.top().first==index; heads.pop())
+      active.push_back(heads.top().second);
+
+    for(bool more=true; more;)
+    {
+      more = false;
+      uint64_t sum=0;
+      for(auto s : active)
+      {
+        auto& cursor = cursors.at(s);
+        if(!cursor.done() && cursor.index()==index)
+        {
+          held.at(s) = cursor.value();
+          cursor.advance();
+          more = more || (!cursor.done() && cursor.index()==index);
+        }
+        sum += held.at(s);
+      }
+      dst.append(index, sum);
+    }
+
+    for(auto s : active)
+      if(!cursors.at(s).done())
+        heads.emplace(cursors.at(s).index(), s);
+  }
+}
+}
+
+//##################################################################################################
+std::vector<std::string> statsFileLabels(const std::vector<std::string>& paths)
+{
+  std::vector<std::string> labels;
+  labels.reserve(paths.size());
+
+  std::unordered_map<std::string, size_t> counts;
+  for(const auto& path : paths)
+    counts[labels.emplace_back(std::filesystem::path(path).filename().string())]++;
+
+  for(size_t f=0; f<paths.size(); f++)
+    if(counts[labels.at(f)]>1)
+      labels.at(f) = paths.at(f);
+
+  return labels;
+}
+
+//##################################################################################################
+bool loadStatsFileStores(const std::vector<std::string>& paths,
+                         std::vector<std::unique_ptr<TraceStore>>& stores,
+                         size_t threadCount,
+                         const std::string& timestampPattern,
+                         const std::atomic_bool* cancelled,
+                         const StatsFileProgress& progress)
+{
+  if(threadCount==0)
+    threadCount = defaultThreadCount();
+
+  stores.clear();
+  stores.resize(paths.size());
+
+  //The biggest files are started first so that one is not left running on its own at the end.
+  std::vector<size_t> sizes(paths.size(), 0);
+  std::vector<size_t> order(paths.size());
+  for(size_t f=0; f<paths.size(); f++)
+  {
+    std::error_code error;
+    sizes.at(f) = size_t(std::filesystem::file_size(paths.at(f), error));
+    if(error)
+      sizes.at(f) = 0;
+    order.at(f) = f;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+  {
+    return sizes.at(a)>sizes.at(b);
+  });
+  auto fileThreads = shareThreads(sizes, threadCount);
+
+  std::atomic_bool loaded{true};
+  parallelFor(paths.size(), [&](size_t i)
+  {
+    size_t f = order.at(i);
+    stores.at(f) = std::make_unique<TraceStore>();
+
+    auto parsed = [&](size_t bytes)
+    {
+      if(progress)
+        progress(f, bytes, false);
+    };
+
+    if(!loadStatsFile(paths.at(f), *stores.at(f), fileThreads.at(f), timestampPattern, cancelled, parsed))
+      loaded = false;
+
+    if(progress)
+      progress(f, 0, true);
+  }, threadCount);
+
+  return loaded && !(cancelled && *cancelled);
+}
+
+//##################################################################################################
+bool loadStatsFiles(const std::vector<std::string>& paths,
+                    StatsMergeMode mode,
+                    TraceStore& store,
+                    std::vector<TraceDelta>& deltas,
+                    size_t threadCount,
+                    const std::string& timestampPattern,
+                    const std::atomic_bool* cancelled,
+                    const StatsFileProgress& progress)
+{
+  store.clear();
+  deltas.clear();
+
+  if(threadCount==0)
+    threadCount = defaultThreadCount();
+
+  if(mode==StatsMergeMode::Difference)
+  {
+    if(paths.empty())
+      return true;
+
+    //Report the candidate as the last file.
+    StatsFileProgress diffProgress;
+    if(progress)
+      diffProgress = [&](size_t f, size_t bytes, bool finished)
+      {
+        progress(f?paths.size()-1:0, bytes, finished);
+      };
+
+    return loadTraceDiff(paths.front(), paths.back(), store, deltas, threadCount, timestampPattern, cancelled, diffProgress);
+  }
+
+  //-- Parse the files concurrently, sharing the threads between them -----------------------------
+  std::vector<std::unique_ptr<TraceStore>> fileStores;
+  bool opened = loadStatsFileStores(paths, fileStores, threadCount, timestampPattern, cancelled, progress);
+  if(cancelled && *cancelled)
+    return false;
+
+  //-- Assign each destination trace its sources, this is the only serial part --------------------
+  std::vector<MergeJob_lt> jobs;
+  auto labels = statsFileLabels(paths);
+  std::string name;
+  size_t sampleCount=0;
+  size_t longestFile=0;
+  for(size_t f=0; f<fileStores.size(); f++)
+  {
+    const auto& fileStore = *fileStores.at(f);
+    if(fileStore.sampleCount()>sampleCount)
+    {
+      sampleCount = fileStore.sampleCount();
+      longestFile = f;
+    }
+
+    for(TraceID t=0; t<fileStore.traceCount(); t++)
+    {
+      const auto& src = fileStore.trace(t);
+      if(mode == StatsMergeMode::Namespaced)
+      {
+        name = labels.at(f);
+        name += '/';
+        name += src.name;
+      }
+      else
+        name = src.name;
+
+      auto traceID = store.addTrace(name);
+      if(traceID>=jobs.size())
+        jobs.resize(traceID+1);
+
+      auto& job = jobs.at(traceID);
+      job.dst = traceID;
+      job.sources.push_back(&src);
+    }
+  }
+
+  //-- Fill each destination trace, each job writes to a different trace --------------------------
+  parallelFor(jobs.size(), [&](size_t j)
+  {
+    if(cancelled && *cancelled)
+      return;
+
+    const auto& job = jobs.at(j);
+    auto& dst = store.trace(job.dst);
+
+    if(job.sources.size()==1)
+      dst.assign(*job.sources.front());
+    else
+      sumTraces(job.sources, dst);
+  }, threadCount);
+
+  if(cancelled && *cancelled)
+    return false;
+
+  store.setSampleCount(sampleCount);
+  if(!fileStores.empty())
+  {
+    auto times = fileStores.at(longestFile)->sampleTimes();
+    store.setSampleTimes(std::move(times));
+  }
+  store.updateTotals();
+  return opened;
+}
+
+}
@@ -0,0 +1,91 @@
+#include "general_performance_stats_viewer/StatsParser.h"
+
+#include <charconv>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+StatsLine parseStatsLine(std::string_view line)
+{
+  StatsLine result;
+
+  std::string_view prefix;
+  if(size_t p = line.find(statsLineStart); p == std::string_view::npos)
+    return result;
+  else
+  {
+    prefix = line.substr(0, p);
+    line.remove_prefix(p+statsLineStart.size());
+  }
+
+  if(size_t p = line.find(statsLineEnd); p == std::string_view::npos)
+    return result;
+  else
+    line = line.substr(0, p);
+
+  if(line == statsSeparator)
+  {
+    result.type = StatsLineType::Separator;
+    result.prefix = prefix;
+    return result;
+  }
+
+  size_t p = line.find(statsDelimiter);
+  if(p == 0 || p == std::string_view::npos)
+    return result;
+
+  auto name = line.substr(0, p);
+  auto value = line.substr(p+statsDelimiter.size());
+
+  if(value.find(statsDelimiter) != std::string_view::npos)
+    return result;
+
+  while(!value.empty() && (value.front()==' ' || value.front()=='\t'))
+    value.remove_prefix(1);
+
+  size_t v{0};
+  if(std::from_chars(value.data(), value.data()+value.size(), v).ec != std::errc())
+    return result;
+
+  result.type = StatsLineType::Value;
+  result.name = name;
+  result.value = v;
+  result.prefix = prefix;
+  return result;
+}
+
+//##################################################################################################
+size_t completeLinesSize(std::string_view data)
+{
+  size_t p = data.rfind('\n');
+  return (p == std::string_view::npos)?0:p+1;
+}
+
+//##################################################################################################
+std::vector<std::string_view> splitStatsChunks(std::string_view data, size_t chunkCount)
+{
+  std::vector<std::string_view> chunks;
+  if(chunkCount<1)
+    chunkCount = 1;
+
+  size_t target = data.size() / chunkCount;
+  size_t start = 0;
+  while(start<data.size())
+  {
+    size_t end = start + target;
+    if(target==0 || end>=data.size() || chunks.size()+1>=chunkCount)
+      end = data.size();
+    else if(size_t p = data.find('\n', end); p == std::string_view::npos)
+      end = data.size();
+    else
+      end = p+1;
+
+    chunks.push_back(data.substr(start, end-start));
+    start = end;
+  }
+
+  return chunks;
+}
+
+}
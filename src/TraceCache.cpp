@@ -0,0 +1,381 @@
+#include "general_performance_stats_viewer/TraceCache.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//All sections of the file are 8 byte aligned so that columns can be read in place.
+constexpr char cacheMagic[8] = {'G', 'P', 'S', 'V', 'C', 'A', 'C', 'H'};
+constexpr uint32_t cacheVersion = 3;
+constexpr uint32_t cacheByteOrder = 0x01020304;
+
+//##################################################################################################
+struct CacheHeader_lt
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t sourceSize;
+  int64_t sourceMTime;
+  uint64_t parsedBytes;
+  uint64_t sampleCount;
+  uint64_t traceCount;
+  uint64_t timeCount;
+  uint64_t timesOffset;
+  uint64_t sampleBlockSize;
+};
+
+//##################################################################################################
+//! The columns of a Trace, the blocks are written compressed as they are held in memory.
+struct CacheSamples_lt
+{
+  uint64_t blockCount;
+  uint64_t blocksOffset;
+  uint64_t encodedSize;
+  uint64_t encodedOffset;
+  uint64_t tailSize;
+  uint64_t tailIndexesOffset;
+  uint64_t tailValuesOffset;
+};
+
+//##################################################################################################
+struct CacheTrace_lt
+{
+  uint64_t nameOffset;
+  uint64_t nameSize;
+  uint64_t maxValue;
+  CacheSamples_lt samples;
+  uint64_t levelsOffset;
+  uint64_t levelCount;
+};
+
+//##################################################################################################
+struct CacheLevel_lt
+{
+  uint64_t bucketWidth;
+  CacheSamples_lt samples;
+};
+
+static_assert(sizeof(SampleBlock)==24, "SampleBlock is written to the cache as it is.");
+
+//##################################################################################################
+constexpr uint64_t align8(uint64_t offset)
+{
+  return (offset+7) & ~uint64_t(7);
+}
+
+//##################################################################################################
+bool sourceKey(const std::string& path, uint64_t& size, int64_t& mtime)
+{
+  std::error_code ec;
+  size = std::filesystem::file_size(path, ec);
+  if(ec)
+    return false;
+
+  auto time = std::filesystem::last_write_time(path, ec);
+  if(ec)
+    return false;
+
+  mtime = int64_t(time.time_since_epoch().count());
+  return true;
+}
+
+//##################################################################################################
+//! Lays out the sections of the file, used to calculate offsets and then to write.
+struct Writer_lt
+{
+  std::ofstream* out{nullptr};
+  uint64_t offset{0};
+
+  //################################################################################################
+  uint64_t add(const void* data, uint64_t size)
+  {
+    uint64_t start = offset;
+    if(out)
+    {
+      out->write(static_cast<const char*>(data), std::streamsize(size));
+      static const char zeros[8]={};
+      out->write(zeros, std::streamsize(align8(size)-size));
+    }
+    offset += align8(size);
+    return start;
+  }
+
+  //################################################################################################
+  CacheSamples_lt addSamples(const Trace& trace)
+  {
+    //Blocks sealed after the trace was paged are written after the paged blocks.
+    if(trace.paged.file && !trace.blocks.empty())
+    {
+      Trace joined;
+      joined.assign(trace);
+      joined.unpage();
+      return addSamples(joined);
+    }
+
+    bool paged = bool(trace.paged.file);
+    const SampleBlock* blocks = paged?trace.paged.blocks:trace.blocks.data();
+    const uint8_t* encoded = paged?trace.paged.encoded:trace.encoded.data();
+    size_t encodedSize = paged?trace.paged.encodedSize:trace.encoded.size();
+
+    CacheSamples_lt samples;
+    samples.blockCount        = trace.blockCount();
+    samples.blocksOffset      = add(blocks, trace.blockCount()*sizeof(SampleBlock));
+    samples.encodedSize       = encodedSize;
+    samples.encodedOffset     = add(encoded, encodedSize);
+    samples.tailSize          = trace.tailIndexes.size();
+    samples.tailIndexesOffset = add(trace.tailIndexes.data(), trace.tailIndexes.size()*sizeof(uint32_t));
+    samples.tailValuesOffset  = add(trace.tailValues.data(), trace.tailValues.size()*sizeof(uint64_t));
+    return samples;
+  }
+};
+}
+
+//##################################################################################################
+std::string traceCachePath(const std::string& path)
+{
+  return path + ".gpsvcache";
+}
+
+//##################################################################################################
+bool readTraceCache(const std::string& path, TraceStore& store, std::vector<TraceLOD>& lods, size_t& parsedBytes, size_t pagedBudget)
+{
+  uint64_t sourceSize{0};
+  int64_t sourceMTime{0};
+  if(!sourceKey(path, sourceSize, sourceMTime))
+    return false;
+
+  auto file = std::make_shared<PagedFile>(traceCachePath(path));
+  if(!file->isOpen() || file->size()<sizeof(CacheHeader_lt))
+    return false;
+
+  const char* data = file->data();
+  uint64_t fileSize = file->size();
+  bool paged = (pagedBudget!=0);
+
+  CacheHeader_lt header;
+  std::memcpy(&header, data, sizeof(CacheHeader_lt));
+  if(std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic))!=0 ||
+     header.version != cacheVersion ||
+     header.byteOrder != cacheByteOrder ||
+     header.sourceSize != sourceSize ||
+     header.sourceMTime != sourceMTime ||
+     header.sampleBlockSize != sampleBlockSize)
+    return false;
+
+  auto inFile = [&](uint64_t offset, uint64_t size)
+  {
+    return offset<=fileSize && size<=fileSize-offset;
+  };
+
+  //The decoder checks its reads against the end of encoded, so only the layout is checked here.
+  auto readSamples = [&](const CacheSamples_lt& src, Trace& dst)
+  {
+    if(src.blockCount>fileSize || src.tailSize>=sampleBlockSize ||
+       !inFile(src.blocksOffset, src.blockCount*sizeof(SampleBlock)) ||
+       !inFile(src.encodedOffset, src.encodedSize) ||
+       !inFile(src.tailIndexesOffset, src.tailSize*sizeof(uint32_t)) ||
+       !inFile(src.tailValuesOffset, src.tailSize*sizeof(uint64_t)) ||
+       (src.blockCount && src.encodedSize<sampleCodecPadding))
+      return false;
+
+    auto blocks = reinterpret_cast<const SampleBlock*>(data+src.blocksOffset);
+    for(uint64_t b=0; b<src.blockCount; b++)
+      if(blocks[b].offset>src.encodedSize-sampleCodecPadding)
+        return false;
+
+    auto encoded = reinterpret_cast<const uint8_t*>(data+src.encodedOffset);
+    auto tailIndexes = reinterpret_cast<const uint32_t*>(data+src.tailIndexesOffset);
+    auto tailValues = reinterpret_cast<const uint64_t*>(data+src.tailValuesOffset);
+    if(paged)
+    {
+      PagedSamples samples;
+      samples.file = file;
+      samples.blocks = blocks;
+      samples.blockCount = src.blockCount;
+      samples.encoded = encoded;
+      samples.encodedSize = src.encodedSize;
+      dst.setPaged(std::move(samples));
+    }
+    else
+    {
+      dst.blocks.assign(blocks, blocks+src.blockCount);
+      dst.encoded.assign(encoded, encoded+src.encodedSize);
+    }
+    dst.tailIndexes.assign(tailIndexes, tailIndexes+src.tailSize);
+    dst.tailValues.assign(tailValues, tailValues+src.tailSize);
+    return true;
+  };
+
+  uint64_t tracesOffset = align8(sizeof(CacheHeader_lt));
+  if(!inFile(tracesOffset, header.traceCount*sizeof(CacheTrace_lt)) ||
+     !inFile(header.timesOffset, header.timeCount*sizeof(int64_t)))
+    return false;
+
+  store.clear();
+  lods.clear();
+  lods.resize(header.traceCount);
+
+  for(uint64_t t=0; t<header.traceCount; t++)
+  {
+    CacheTrace_lt src;
+    std::memcpy(&src, data+tracesOffset+t*sizeof(CacheTrace_lt), sizeof(CacheTrace_lt));
+
+    if(!inFile(src.nameOffset, src.nameSize) ||
+       !inFile(src.levelsOffset, src.levelCount*sizeof(CacheLevel_lt)))
+    {
+      store.clear();
+      lods.clear();
+      return false;
+    }
+
+    auto& trace = store.trace(store.addTrace(std::string_view(data+src.nameOffset, src.nameSize)));
+    trace.maxValue = src.maxValue;
+    if(!readSamples(src.samples, trace))
+    {
+      store.clear();
+      lods.clear();
+      return false;
+    }
+
+    auto& lod = lods.at(t);
+    lod.sourceSize = trace.size();
+    lod.levels.resize(src.levelCount);
+    for(uint64_t l=0; l<src.levelCount; l++)
+    {
+      CacheLevel_lt level;
+      std::memcpy(&level, data+src.levelsOffset+l*sizeof(CacheLevel_lt), sizeof(CacheLevel_lt));
+
+      auto& dst = lod.levels.at(l);
+      dst.bucketWidth = level.bucketWidth;
+      if(!readSamples(level.samples, dst.samples))
+      {
+        store.clear();
+        lods.clear();
+        return false;
+      }
+    }
+  }
+
+  auto times = reinterpret_cast<const int64_t*>(data+header.timesOffset);
+  store.setSampleCount(header.sampleCount);
+  store.setSampleTimes(std::vector<int64_t>(times, times+header.timeCount));
+  store.updateTotals();
+  parsedBytes = header.parsedBytes;
+
+  if(paged)
+  {
+    file->setBudget(pagedBudget);
+    store.setPagedFile(file);
+  }
+  return true;
+}
+
+//##################################################################################################
+bool writeTraceCache(const std::string& path, const TraceStore& store, const std::vector<TraceLOD>& lods, size_t parsedBytes)
+{
+  CacheHeader_lt header{};
+  std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+  header.version = cacheVersion;
+  header.byteOrder = cacheByteOrder;
+  if(!sourceKey(path, header.sourceSize, header.sourceMTime))
+    return false;
+  header.parsedBytes = parsedBytes;
+  header.sampleCount = store.sampleCount();
+
+  //Derived traces are evaluated again once the cache has been read.
+  std::vector<TraceID> cached;
+  for(TraceID t=0; t<store.traceCount(); t++)
+    if(!store.trace(t).derived)
+      cached.push_back(t);
+
+  header.traceCount = cached.size();
+  header.timeCount = store.sampleTimes().size();
+  header.sampleBlockSize = sampleBlockSize;
+
+  std::vector<CacheTrace_lt> traces(cached.size());
+  std::vector<std::vector<CacheLevel_lt>> levels(cached.size());
+
+  //The first pass calculates the offsets and the second writes the file.
+  auto layout = [&](Writer_lt& w)
+  {
+    w.add(&header, sizeof(CacheHeader_lt));
+    w.add(traces.data(), traces.size()*sizeof(CacheTrace_lt));
+    header.timesOffset = w.add(store.sampleTimes().data(), store.sampleTimes().size()*sizeof(int64_t));
+
+    for(size_t c=0; c<cached.size(); c++)
+    {
+      auto t = cached.at(c);
+      const auto& trace = store.trace(t);
+      auto& dst = traces.at(c);
+      dst.nameOffset    = w.add(trace.name.data(), trace.name.size());
+      dst.nameSize      = trace.name.size();
+      dst.maxValue      = trace.maxValue;
+      dst.samples       = w.addSamples(trace);
+
+      auto& dstLevels = levels.at(c);
+      dstLevels.clear();
+      if(t<lods.size() && lods.at(t).sourceSize == trace.size())
+      {
+        for(const auto& level : lods.at(t).levels)
+        {
+          auto& dstLevel = dstLevels.emplace_back();
+          dstLevel.bucketWidth = level.bucketWidth;
+          dstLevel.samples     = w.addSamples(level.samples);
+        }
+      }
+
+      dst.levelsOffset = w.add(dstLevels.data(), dstLevels.size()*sizeof(CacheLevel_lt));
+      dst.levelCount   = dstLevels.size();
+    }
+  };
+
+  {
+    Writer_lt sizer;
+    layout(sizer);
+  }
+
+  //Write to a temporary file and rename it so that a partial cache is never read.
+  auto cachePath = traceCachePath(path);
+  auto tmpPath = cachePath + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary|std::ios::trunc);
+    if(!out)
+    {
+      tpWarning() << "Failed to write cache: " << cachePath;
+      return false;
+    }
+
+    Writer_lt writer;
+    writer.out = &out;
+    layout(writer);
+
+    if(!out)
+    {
+      tpWarning() << "Failed to write cache: " << cachePath;
+      out.close();
+      std::error_code ec;
+      std::filesystem::remove(tmpPath, ec);
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, cachePath, ec);
+  if(ec)
+  {
+    std::filesystem::remove(tmpPath, ec);
+    return false;
+  }
+
+  return true;
+}
+
+}
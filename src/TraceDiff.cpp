@@ -0,0 +1,162 @@
+#include "general_performance_stats_viewer/TraceDiff.h"
+#include "general_performance_stats_viewer/StatsMerge.h"
+#include "general_performance_stats_viewer/Parallel.h"
+
+#include <algorithm>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//##################################################################################################
+//! candidate-baseline saturated to the range of int64_t.
+int64_t signedDifference(uint64_t candidate, uint64_t baseline)
+{
+  constexpr auto limit = uint64_t(std::numeric_limits<int64_t>::max());
+  if(candidate>=baseline)
+    return int64_t(std::min(candidate-baseline, limit));
+  return -int64_t(std::min(baseline-candidate, limit));
+}
+
+//##################################################################################################
+//! Call closure(index, difference) for each sample index below end that is in either trace.
+/*!
+Each trace holds its last value between samples, an index before the first sample of either trace
+is skipped.
+*/
+template<typename Closure>
+void joinSamples(const SampleSpan& baseline, const SampleSpan& candidate, uint64_t end, const Closure& closure)
+{
+  size_t b=0;
+  size_t c=0;
+  for(;;)
+  {
+    uint64_t bIndex = (b<baseline.size)?baseline.indexes[b]:end;
+    uint64_t cIndex = (c<candidate.size)?candidate.indexes[c]:end;
+    uint64_t index = std::min(bIndex, cIndex);
+    if(index>=end)
+      return;
+
+    if(bIndex==index)
+      b++;
+    if(cIndex==index)
+      c++;
+
+    if(b>0 && c>0)
+      closure(uint32_t(index), signedDifference(candidate.values[c-1], baseline.values[b-1]));
+  }
+}
+}
+
+//##################################################################################################
+std::vector<TraceDelta> diffTraceStores(const TraceStore& baseline,
+                                        const TraceStore& candidate,
+                                        TraceStore& difference,
+                                        size_t threadCount)
+{
+  difference.clear();
+
+  //-- Join the traces by name, this is the only serial part --------------------------------------
+  std::vector<std::pair<const Trace*, const Trace*>> sources;
+  auto add = [&](const Trace* b, const Trace* c, std::string_view name)
+  {
+    auto traceID = difference.addTrace(name);
+    if(traceID>=sources.size())
+      sources.resize(traceID+1, {nullptr, nullptr});
+
+    auto& source = sources.at(traceID);
+    if(b)
+      source.first = b;
+    if(c)
+      source.second = c;
+  };
+
+  for(TraceID t=0; t<candidate.traceCount(); t++)
+    add(nullptr, &candidate.trace(t), candidate.trace(t).name);
+  for(TraceID t=0; t<baseline.traceCount(); t++)
+    add(&baseline.trace(t), nullptr, baseline.trace(t).name);
+
+  size_t sampleCount = std::min(baseline.sampleCount(), candidate.sampleCount());
+  difference.setSampleCount(sampleCount);
+
+  const auto& times = candidate.sampleTimes();
+  if(!times.empty())
+    difference.setSampleTimes(std::vector<int64_t>(times.begin(), times.begin()+std::ptrdiff_t(sampleCount+1)));
+
+  //-- Calculate the statistics and difference of each trace --------------------------------------
+  std::vector<TraceDelta> deltas(sources.size());
+  parallelFor(sources.size(), [&](size_t t)
+  {
+    const auto& source = sources.at(t);
+    auto& delta = deltas.at(t);
+    auto& dst = difference.trace(TraceID(t));
+
+    SampleBuffer baselineBuffer;
+    SampleBuffer candidateBuffer;
+    SampleSpan b = source.first?source.first->samples(baselineBuffer):SampleSpan();
+    SampleSpan c = source.second?source.second->samples(candidateBuffer):SampleSpan();
+    delta.baseline = computeTraceStats(b);
+    delta.candidate = computeTraceStats(c);
+    delta.score = delta.mean() / std::max(1.0, delta.baseline.mean);
+
+    //The first pass sizes the columns and finds the bias, the second fills them.
+    size_t count=0;
+    int64_t minimum=0;
+    joinSamples(b, c, sampleCount+1, [&](uint32_t, int64_t value)
+    {
+      count++;
+      minimum = std::min(minimum, value);
+    });
+
+    delta.bias = uint64_t(-minimum);
+    SampleBuffer joined;
+    joined.indexes.reserve(count);
+    joined.values.reserve(count);
+    joinSamples(b, c, sampleCount+1, [&](uint32_t index, int64_t value)
+    {
+      joined.indexes.push_back(index);
+      joined.values.push_back(uint64_t(value) + delta.bias);
+    });
+    dst.assign({joined.indexes.data(), joined.values.data(), count});
+  }, threadCount);
+
+  difference.updateTotals();
+  return deltas;
+}
+
+//##################################################################################################
+bool loadTraceDiff(const std::string& baselinePath,
+                   const std::string& candidatePath,
+                   TraceStore& difference,
+                   std::vector<TraceDelta>& deltas,
+                   size_t threadCount,
+                   const std::string& timestampPattern,
+                   const std::atomic_bool* cancelled,
+                   const StatsFileProgress& progress)
+{
+  std::vector<std::unique_ptr<TraceStore>> stores;
+  std::vector<std::string> paths{baselinePath, candidatePath};
+  bool opened = loadStatsFileStores(paths, stores, threadCount, timestampPattern, cancelled, progress);
+  if(cancelled && *cancelled)
+    return false;
+
+  deltas = diffTraceStores(*stores.at(0), *stores.at(1), difference, threadCount);
+  return opened;
+}
+
+//##################################################################################################
+std::vector<size_t> rankTraceDeltas(const std::vector<TraceDelta>& deltas)
+{
+  std::vector<size_t> ranked(deltas.size());
+  for(size_t i=0; i<ranked.size(); i++)
+    ranked.at(i) = i;
+
+  std::stable_sort(ranked.begin(), ranked.end(), [&](size_t a, size_t b)
+  {
+    return deltas.at(a).score > deltas.at(b).score;
+  });
+  return ranked;
+}
+
+}
@@ -0,0 +1,972 @@
+#include "general_performance_stats_viewer/TraceExpression.h"
+
+#include "tp_utils/RefCount.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <regex>
+#include <unordered_map>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//The number of samples of each column evaluated at a time.
+constexpr size_t windowSize = 1024;
+
+//The sample indexes whose samples are read from the sources at a time, one source after another.
+constexpr size_t batchSize = 16*windowSize;
+
+//Larger biased results are left out rather than overflowing the value column, the bias is kept
+//below half of this so that it leaves room for positive results.
+constexpr double maxStoredValue = 9.0e18;
+constexpr double maxBias = maxStoredValue/2.0;
+
+//##################################################################################################
+enum class NodeType_lt
+{
+  Constant,
+  Trace,
+  Negate,
+  Add,
+  Subtract,
+  Multiply,
+  Divide,
+  Rate,
+  Delta,
+  Sum,
+  Avg,
+  Min,
+  Max
+};
+
+//##################################################################################################
+struct Node_lt
+{
+  NodeType_lt type{NodeType_lt::Constant};
+  double value{0.0};           //!< The value of a constant.
+  std::string text;            //!< The name of a trace, or the pattern of a matching aggregate.
+  bool matching{false};        //!< The aggregate reads the traces that match pattern.
+  std::regex pattern;
+  std::vector<size_t> args;    //!< The nodes of the arguments, these always come first.
+  std::vector<size_t> sources; //!< The sources read by a trace or a matching aggregate.
+};
+
+//##################################################################################################
+bool isNameChar(char c)
+{
+  return std::isalnum(uint8_t(c)) || c=='_' || c=='.' || c==':';
+}
+
+//##################################################################################################
+//! A recursive descent parser that appends each node after the nodes of its arguments.
+struct Parser_lt
+{
+  const std::string& text;
+  std::vector<Node_lt>& nodes;
+  std::string error;
+  size_t p{0};
+
+  //################################################################################################
+  Parser_lt(const std::string& text_, std::vector<Node_lt>& nodes_):
+    text(text_),
+    nodes(nodes_)
+  {
+
+  }
+
+  //################################################################################################
+  bool parse()
+  {
+    size_t root=0;
+    if(!expression(root))
+      return false;
+
+    skipSpace();
+    return p==text.size() || fail("Unexpected '" + text.substr(p, 1) + "'");
+  }
+
+  //################################################################################################
+  bool fail(const std::string& message)
+  {
+    error = message + " at character " + std::to_string(p+1) + ".";
+    return false;
+  }
+
+  //################################################################################################
+  void skipSpace()
+  {
+    while(p<text.size() && std::isspace(uint8_t(text[p])))
+      p++;
+  }
+
+  //################################################################################################
+  bool accept(char c)
+  {
+    skipSpace();
+    if(p<text.size() && text[p]==c)
+    {
+      p++;
+      return true;
+    }
+    return false;
+  }
+
+  //################################################################################################
+  size_t add(NodeType_lt type, std::vector<size_t>&& args)
+  {
+    auto& node = nodes.emplace_back();
+    node.type = type;
+    node.args = std::move(args);
+    return nodes.size()-1;
+  }
+
+  //################################################################################################
+  size_t addTrace(std::string&& name)
+  {
+    size_t node = add(NodeType_lt::Trace, {});
+    nodes.at(node).text = std::move(name);
+    return node;
+  }
+
+  //################################################################################################
+  bool expression(size_t& node)
+  {
+    if(!term(node))
+      return false;
+
+    for(;;)
+    {
+      NodeType_lt type;
+      if(accept('+'))
+        type = NodeType_lt::Add;
+      else if(accept('-'))
+        type = NodeType_lt::Subtract;
+      else
+        return true;
+
+      size_t rhs=0;
+      if(!term(rhs))
+        return false;
+      node = add(type, {node, rhs});
+    }
+  }
+
+  //################################################################################################
+  bool term(size_t& node)
+  {
+    if(!unary(node))
+      return false;
+
+    for(;;)
+    {
+      NodeType_lt type;
+      if(accept('*'))
+        type = NodeType_lt::Multiply;
+      else if(accept('/'))
+        type = NodeType_lt::Divide;
+      else
+        return true;
+
+      size_t rhs=0;
+      if(!unary(rhs))
+        return false;
+      node = add(type, {node, rhs});
+    }
+  }
+
+  //################################################################################################
+  bool unary(size_t& node)
+  {
+    if(!accept('-'))
+      return primary(node);
+
+    size_t arg=0;
+    if(!unary(arg))
+      return false;
+    node = add(NodeType_lt::Negate, {arg});
+    return true;
+  }
+
+  //################################################################################################
+  bool primary(size_t& node)
+  {
+    skipSpace();
+    if(p>=text.size())
+      return fail("Expected a value");
+
+    char c = text[p];
+    if(accept('('))
+      return expression(node) && (accept(')') || fail("Expected ')'"));
+
+    if(c=='"')
+    {
+      std::string name;
+      if(!quoted(name))
+        return false;
+      node = addTrace(std::move(name));
+      return true;
+    }
+
+    if(std::isdigit(uint8_t(c)) || c=='.')
+    {
+      const char* start = text.c_str()+p;
+      char* end = nullptr;
+      double value = std::strtod(start, &end);
+      if(end==start)
+        return fail("Expected a number");
+      p += size_t(end-start);
+      node = add(NodeType_lt::Constant, {});
+      nodes.at(node).value = value;
+      return true;
+    }
+
+    if(std::isalpha(uint8_t(c)) || c=='_')
+    {
+      size_t start = p;
+      while(p<text.size() && isNameChar(text[p]))
+        p++;
+      std::string name = text.substr(start, p-start);
+
+      if(accept('('))
+        return function(name, start, node);
+
+      node = addTrace(std::move(name));
+      return true;
+    }
+
+    return fail("Expected a value");
+  }
+
+  //################################################################################################
+  //! Read a string in double quotes, \" is a quote and other backslashes are kept for regexes.
+  bool quoted(std::string& result)
+  {
+    p++;
+    for(; p<text.size() && text[p]!='"'; p++)
+    {
+      if(text[p]=='\\' && p+1<text.size() && text[p+1]=='"')
+        p++;
+      result.push_back(text[p]);
+    }
+
+    if(p>=text.size())
+      return fail("Expected a closing '\"'");
+    p++;
+    return true;
+  }
+
+  //################################################################################################
+  bool function(const std::string& name, size_t nameStart, size_t& node)
+  {
+    static const std::unordered_map<std::string, NodeType_lt> functions
+    {
+      {"rate",  NodeType_lt::Rate },
+      {"delta", NodeType_lt::Delta},
+      {"sum",   NodeType_lt::Sum  },
+      {"avg",   NodeType_lt::Avg  },
+      {"min",   NodeType_lt::Min  },
+      {"max",   NodeType_lt::Max  }
+    };
+
+    auto i = functions.find(name);
+    if(i == functions.end())
+    {
+      p = nameStart;
+      return fail("Unknown function '" + name + "'");
+    }
+
+    auto type = i->second;
+    std::vector<size_t> args;
+    std::string pattern;
+    bool matching=false;
+
+    //matching is only a keyword when it is followed by a pattern, otherwise it is a trace name.
+    skipSpace();
+    size_t start = p;
+    if(type!=NodeType_lt::Rate && type!=NodeType_lt::Delta && text.compare(p, 8, "matching")==0)
+    {
+      p += 8;
+      skipSpace();
+      if(p<text.size() && text[p]=='"')
+      {
+        if(!quoted(pattern))
+          return false;
+        matching = true;
+      }
+      else
+        p = start;
+    }
+
+    if(!matching)
+    {
+      do
+      {
+        size_t arg=0;
+        if(!expression(arg))
+          return false;
+        args.push_back(arg);
+      }
+      while(type!=NodeType_lt::Rate && type!=NodeType_lt::Delta && accept(','));
+    }
+
+    if(!accept(')'))
+      return fail("Expected ')'");
+
+    node = add(type, std::move(args));
+    auto& n = nodes.at(node);
+    n.matching = matching;
+    if(matching)
+    {
+      try
+      {
+        n.pattern = std::regex(pattern, std::regex::ECMAScript|std::regex::optimize);
+      }
+      catch(const std::regex_error&)
+      {
+        p = start;
+        return fail("Invalid regex \"" + pattern + "\"");
+      }
+      n.text = std::move(pattern);
+    }
+    return true;
+  }
+};
+
+//##################################################################################################
+//! What evaluation has to carry from one sample index to the next.
+struct EvaluationState_lt
+{
+  std::vector<double> held;         //!< The last value of each source, NaN before its first.
+  std::vector<double> previous;     //!< The last argument of each rate or delta node, or NaN.
+  std::vector<double> previousTime; //!< The time of previous, in seconds or sample indexes.
+};
+
+//##################################################################################################
+//! The position of the next sample of a source, the samples are decoded into a shared buffer.
+struct SourceCursor_lt
+{
+  const Trace* trace{nullptr};
+  size_t position{0}; //!< The position in trace of the next sample.
+  size_t end{0};
+  uint64_t nextIndex{std::numeric_limits<uint64_t>::max()}; //!< The max of uint64_t when done.
+
+  //################################################################################################
+  //! Read the samples with indexes in [first, last).
+  void start(const Trace* trace_, uint64_t first, uint64_t last, SampleBuffer& buffer)
+  {
+    trace = trace_;
+    position = trace->lowerBound(first);
+    end = trace->lowerBound(last);
+    if(position<end)
+      nextIndex = trace->samples(position, 1, buffer).indexes[0];
+  }
+
+  //################################################################################################
+  //! Call closure(index, value) for the samples with indexes before batchEnd, a block at a time.
+  template<typename Closure>
+  void read(uint64_t batchEnd, SampleBuffer& buffer, const Closure& closure)
+  {
+    while(nextIndex<batchEnd)
+    {
+      size_t count = std::min(end, (position/sampleBlockSize+1)*sampleBlockSize) - position;
+      auto span = trace->samples(position, count, buffer);
+      size_t p=0;
+      for(; p<span.size && span.indexes[p]<batchEnd; p++)
+        closure(span.indexes[p], span.values[p]);
+      position += p;
+
+      if(p<span.size)
+        nextIndex = span.indexes[p];
+      else if(position==end)
+        nextIndex = std::numeric_limits<uint64_t>::max();
+    }
+  }
+};
+
+//##################################################################################################
+//! What a node read from its sources in the current batch.
+struct NodeBatch_lt
+{
+  //For matching sum and avg the changes to the sum and to the number of sources with a value at
+  //each index of the batch, for matching min and max the min or max of the sources that changed.
+  std::vector<double> values;
+  std::vector<double> counts;
+
+  SampleBuffer samples; //!< The samples of the source of a trace node.
+  size_t next{0};       //!< The next of samples to be read into a window.
+  size_t source{0};     //!< The next of the node's sources to be read.
+
+  //The held value of a trace, the running sum and count of sum and avg, or for min and max the
+  //min or max of the sources that did not change.
+  double held{0.0};
+  double count{0.0};
+};
+}
+
+//##################################################################################################
+struct TraceExpression::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::TraceExpression::Private");
+  TP_NONCOPYABLE(Private);
+
+  std::string text;
+  std::string error;
+  std::string name;
+  std::vector<Node_lt> nodes;
+  bool readsTimes{false};
+
+  TraceID traceID{invalidTraceID};
+
+  //The parsed traces that have been checked against the names and patterns of the nodes.
+  size_t scannedTraces{0};
+  std::vector<TraceID> sources;
+  std::unordered_map<TraceID, size_t> sourceIndexes;
+
+  //The state after the sample indexes before committedEnd, these won't gain samples.
+  EvaluationState_lt committed;
+  uint64_t committedEnd{0};
+
+  //Added to the results so that negative results fit the unsigned values, and the bias that the
+  //results evaluated so far need, which is more than bias if some were left out.
+  uint64_t bias{0};
+  double requiredBias{0.0};
+
+  //The columns of a window, one for each node.
+  std::vector<std::vector<double>> columns;
+  std::vector<NodeBatch_lt> batches;
+  SampleBuffer buffer;
+  SampleBuffer sourceSamples;
+  std::vector<double> counts;
+  std::vector<double> times;
+  std::vector<uint32_t> indexes;
+  std::vector<uint8_t> present;
+  std::vector<const double*> inputs;
+
+  //################################################################################################
+  Private(const std::string& text_):
+    text(text_),
+    name("= " + text_),
+    counts(windowSize, 0.0),
+    times(windowSize, 0.0)
+  {
+    Parser_lt parser(text, nodes);
+    if(!parser.parse())
+    {
+      error = parser.error;
+      nodes.clear();
+      return;
+    }
+
+    columns.resize(nodes.size());
+    batches.resize(nodes.size());
+    for(size_t n=0; n<nodes.size(); n++)
+    {
+      const auto& node = nodes.at(n);
+      columns.at(n).assign(windowSize, node.value);
+      if(node.type==NodeType_lt::Rate)
+        readsTimes = true;
+    }
+
+    reset();
+  }
+
+  //################################################################################################
+  void reset()
+  {
+    traceID = invalidTraceID;
+    scannedTraces = 0;
+    sources.clear();
+    sourceIndexes.clear();
+    for(auto& node : nodes)
+      node.sources.clear();
+
+    bias = 0;
+    restart();
+  }
+
+  //################################################################################################
+  //! Evaluate from the first sample index again, keeping the sources.
+  void restart()
+  {
+    committed.held.assign(sources.size(), std::nan(""));
+    committed.previous.assign(nodes.size(), std::nan(""));
+    committed.previousTime.assign(nodes.size(), 0.0);
+    committedEnd = 0;
+    requiredBias = 0.0;
+  }
+
+  //################################################################################################
+  size_t addSource(TraceID t)
+  {
+    auto i = sourceIndexes.find(t);
+    if(i != sourceIndexes.end())
+      return i->second;
+
+    sourceIndexes.emplace(t, sources.size());
+    sources.push_back(t);
+    committed.held.push_back(std::nan(""));
+    return sources.size()-1;
+  }
+
+  //################################################################################################
+  //! Find the sources of the nodes among the traces added since the last call.
+  /*!
+  Traces are only ever added to the end of a store, and a new trace has no samples before the
+  samples already evaluated, so the sources of a node only grow. They stay in the order they were
+  added, which is the order readBatch() reads them in.
+  */
+  void resolve(const TraceStore& store)
+  {
+    for(TraceID t=TraceID(scannedTraces); t<store.traceCount(); t++)
+    {
+      const auto& trace = store.trace(t);
+      if(trace.derived)
+        continue;
+
+      for(auto& node : nodes)
+      {
+        if(node.matching?std::regex_match(trace.name.begin(), trace.name.end(), node.pattern):
+           (node.type==NodeType_lt::Trace && trace.name==node.text))
+          node.sources.push_back(addSource(t));
+      }
+    }
+    scannedTraces = store.traceCount();
+  }
+
+  //################################################################################################
+  const double* column(size_t n) const
+  {
+    return columns.at(n).data();
+  }
+
+  //################################################################################################
+  bool isExtreme(const Node_lt& node) const
+  {
+    return node.type==NodeType_lt::Min || node.type==NodeType_lt::Max;
+  }
+
+  //################################################################################################
+  //! Read the samples of each source in [batchFirst, batchFirst+batchSize) into the node batches.
+  /*!
+  Each source is read in turn into one buffer and applied to the nodes that read it, so a matching
+  aggregate keeps a running value rather than the samples of each of its sources.
+  */
+  void readBatch(std::vector<SourceCursor_lt>& cursors, uint64_t batchFirst, EvaluationState_lt& state)
+  {
+    present.assign(batchSize, 0);
+    for(size_t i=0; i<nodes.size(); i++)
+    {
+      const auto& node = nodes.at(i);
+      auto& batch = batches.at(i);
+      batch.next = 0;
+      batch.source = 0;
+      batch.held = (node.matching && !isExtreme(node))?0.0:std::nan("");
+      batch.count = 0.0;
+      if(node.matching)
+      {
+        batch.values.assign(batchSize, isExtreme(node)?std::nan(""):0.0);
+        batch.counts.assign(isExtreme(node)?0:batchSize, 0.0);
+      }
+    }
+
+    for(size_t s=0; s<cursors.size(); s++)
+    {
+      sourceSamples.indexes.clear();
+      sourceSamples.values.clear();
+      cursors.at(s).read(batchFirst+batchSize, buffer, [&](uint32_t index, uint64_t value)
+      {
+        present[size_t(index-batchFirst)] = 1;
+        sourceSamples.indexes.push_back(index);
+        sourceSamples.values.push_back(value);
+      });
+
+      double held = state.held.at(s);
+      if(!sourceSamples.values.empty())
+        state.held.at(s) = double(sourceSamples.values.back());
+
+      for(size_t i=0; i<nodes.size(); i++)
+      {
+        const auto& node = nodes.at(i);
+        auto& batch = batches.at(i);
+        if(batch.source<node.sources.size() && node.sources.at(batch.source)==s)
+        {
+          batch.source++;
+          applySource(node, batch, batchFirst, held);
+        }
+      }
+    }
+  }
+
+  //################################################################################################
+  //! Apply sourceSamples to a node, held is the value of the source before them.
+  void applySource(const Node_lt& node, NodeBatch_lt& batch, uint64_t batchFirst, double held)
+  {
+    const auto& sampleIndexes = sourceSamples.indexes;
+    const auto& sampleValues = sourceSamples.values;
+
+    if(!node.matching)
+    {
+      batch.held = held;
+      batch.samples.indexes.assign(sampleIndexes.begin(), sampleIndexes.end());
+      batch.samples.values.assign(sampleValues.begin(), sampleValues.end());
+      return;
+    }
+
+    //Each sample changes the sum by the difference from the value held before it.
+    if(!isExtreme(node))
+    {
+      if(held==held)
+      {
+        batch.held += held;
+        batch.count += 1.0;
+      }
+
+      for(size_t j=0; j<sampleIndexes.size(); j++)
+      {
+        size_t k = size_t(sampleIndexes[j]-batchFirst);
+        double value = double(sampleValues[j]);
+        batch.values[k] += (held==held)?value-held:value;
+        batch.counts[k] += (held==held)?0.0:1.0;
+        held = value;
+      }
+      return;
+    }
+
+    //A source that does not change in the batch is folded into held, fmin and fmax ignore NaN.
+    bool min = (node.type==NodeType_lt::Min);
+    auto extreme = [&](double a, double b){return min?std::fmin(a, b):std::fmax(a, b);};
+    if(sampleIndexes.empty())
+    {
+      batch.held = extreme(batch.held, held);
+      return;
+    }
+
+    double* values = batch.values.data();
+    size_t from=0;
+    for(size_t j=0; j<=sampleIndexes.size(); j++)
+    {
+      size_t k = (j<sampleIndexes.size())?size_t(sampleIndexes[j]-batchFirst):batchSize;
+      for(; from<k; from++)
+        values[from] = extreme(values[from], held);
+      if(j<sampleIndexes.size())
+        held = double(sampleValues[j]);
+    }
+  }
+
+  //################################################################################################
+  //! Append the results for the sample indexes in [first, end) to dst.
+  void evaluate(const TraceStore& store, uint64_t first, uint64_t end, EvaluationState_lt& state, Trace& dst)
+  {
+    if(first>=end)
+      return;
+
+    std::vector<SourceCursor_lt> cursors(sources.size());
+    for(size_t s=0; s<sources.size(); s++)
+      cursors.at(s).start(&store.trace(sources.at(s)), first, end, buffer);
+
+    for(;;)
+    {
+      //-- Find the sample indexes of the next batch ----------------------------------------------
+      uint64_t batchFirst = std::numeric_limits<uint64_t>::max();
+      for(const auto& cursor : cursors)
+        batchFirst = std::min(batchFirst, cursor.nextIndex);
+
+      if(batchFirst==std::numeric_limits<uint64_t>::max())
+        return;
+
+      readBatch(cursors, batchFirst, state);
+      for(size_t offset=0; offset<batchSize; offset+=windowSize)
+        evaluateWindow(store, batchFirst, offset, state, dst);
+    }
+  }
+
+  //################################################################################################
+  //! Evaluate the window of the batch that starts offset indexes after batchFirst.
+  void evaluateWindow(const TraceStore& store, uint64_t batchFirst, size_t offset, EvaluationState_lt& state, Trace& dst)
+  {
+    indexes.clear();
+    for(size_t i=offset; i<offset+windowSize; i++)
+      if(present[i])
+        indexes.push_back(uint32_t(batchFirst+i));
+
+    size_t n = indexes.size();
+    if(n==0)
+      return;
+
+    if(readsTimes)
+    {
+      const auto& sampleTimes = store.sampleTimes();
+      for(size_t k=0; k<n; k++)
+      {
+        if(sampleTimes.empty())
+          times[k] = double(indexes[k]);
+        else
+          times[k] = double(sampleTimes[std::min(size_t(indexes[k]), sampleTimes.size()-1)] - sampleTimes.front()) * 1e-9;
+      }
+    }
+
+    //-- Run each node over the window, arguments come before the nodes that read them ------------
+    for(size_t i=0; i<nodes.size(); i++)
+    {
+      const auto& node = nodes.at(i);
+      auto& batch = batches.at(i);
+      double* r = columns.at(i).data();
+      const double* a = node.args.empty()?nullptr:column(node.args.at(0));
+      const double* b = (node.args.size()<2)?nullptr:column(node.args.at(1));
+
+      switch(node.type)
+      {
+      case NodeType_lt::Constant:
+        break;
+
+      case NodeType_lt::Trace:
+      {
+        //Read the source at the indexes of the window, holding its last value.
+        const auto& samples = batch.samples;
+        double held = batch.held;
+        size_t j = batch.next;
+        for(size_t k=0; k<n; k++)
+        {
+          for(; j<samples.indexes.size() && samples.indexes[j]<=indexes[k]; j++)
+            held = double(samples.values[j]);
+          r[k] = held;
+        }
+        batch.held = held;
+        batch.next = j;
+        break;
+      }
+
+      case NodeType_lt::Negate:   for(size_t k=0; k<n; k++) r[k] = -a[k];       break;
+      case NodeType_lt::Add:      for(size_t k=0; k<n; k++) r[k] = a[k] + b[k]; break;
+      case NodeType_lt::Subtract: for(size_t k=0; k<n; k++) r[k] = a[k] - b[k]; break;
+      case NodeType_lt::Multiply: for(size_t k=0; k<n; k++) r[k] = a[k] * b[k]; break;
+      case NodeType_lt::Divide:   for(size_t k=0; k<n; k++) r[k] = a[k] / b[k]; break;
+
+      case NodeType_lt::Rate:
+      case NodeType_lt::Delta:
+      {
+        bool rate = (node.type==NodeType_lt::Rate);
+        r[0] = a[0] - state.previous.at(i);
+        for(size_t k=1; k<n; k++)
+          r[k] = a[k] - a[k-1];
+
+        if(rate)
+        {
+          r[0] /= times[0] - state.previousTime.at(i);
+          for(size_t k=1; k<n; k++)
+            r[k] /= times[k] - times[k-1];
+          state.previousTime.at(i) = times[n-1];
+        }
+
+        state.previous.at(i) = a[n-1];
+        break;
+      }
+
+      case NodeType_lt::Sum:
+      case NodeType_lt::Avg:
+      case NodeType_lt::Min:
+      case NodeType_lt::Max:
+      {
+        bool average = (node.type==NodeType_lt::Avg);
+        if(node.matching && isExtreme(node))
+        {
+          bool min = (node.type==NodeType_lt::Min);
+          for(size_t k=0; k<n; k++)
+          {
+            double value = batch.values[indexes[k]-batchFirst];
+            r[k] = min?std::fmin(value, batch.held):std::fmax(value, batch.held);
+          }
+          break;
+        }
+
+        if(node.matching)
+        {
+          for(size_t k=0; k<n; k++)
+          {
+            size_t j = size_t(indexes[k]-batchFirst);
+            batch.held += batch.values[j];
+            batch.count += batch.counts[j];
+            r[k] = (batch.count==0.0)?std::nan(""):(average?batch.held/batch.count:batch.held);
+          }
+          break;
+        }
+
+        inputs.clear();
+        for(auto arg : node.args)
+          inputs.push_back(column(arg));
+
+        //Inputs without a value yet are skipped, fmin and fmax already ignore NaN.
+        if(isExtreme(node))
+        {
+          std::fill(r, r+n, std::nan(""));
+          for(const double* x : inputs)
+          {
+            if(node.type==NodeType_lt::Min)
+              for(size_t k=0; k<n; k++) r[k] = std::fmin(r[k], x[k]);
+            else
+              for(size_t k=0; k<n; k++) r[k] = std::fmax(r[k], x[k]);
+          }
+          break;
+        }
+
+        double* c = counts.data();
+        std::fill(r, r+n, 0.0);
+        std::fill(c, c+n, 0.0);
+        for(const double* x : inputs)
+        {
+          for(size_t k=0; k<n; k++)
+          {
+            bool valid = (x[k]==x[k]);
+            r[k] += valid?x[k]:0.0;
+            c[k] += valid?1.0:0.0;
+          }
+        }
+
+        for(size_t k=0; k<n; k++)
+          r[k] = (c[k]==0.0)?std::nan(""):(average?r[k]/c[k]:r[k]);
+        break;
+      }
+      }
+    }
+
+    //-- Store the results in fixed point, offset by the bias ------------------------------------
+    const double* result = column(nodes.size()-1);
+    for(size_t k=0; k<n; k++)
+    {
+      double value = std::round(result[k] * double(derivedValueScale));
+      if(value<0.0 && -value<=maxBias)
+        requiredBias = std::max(requiredBias, -value);
+
+      value += double(bias);
+      if(value>=0.0 && value<maxStoredValue)
+        dst.append(indexes[k], uint64_t(value));
+    }
+  }
+};
+
+//##################################################################################################
+TraceExpression::TraceExpression(const std::string& text):
+  d(new Private(text))
+{
+
+}
+
+//##################################################################################################
+TraceExpression::~TraceExpression()
+{
+  delete d;
+}
+
+//##################################################################################################
+const std::string& TraceExpression::text() const
+{
+  return d->text;
+}
+
+//##################################################################################################
+const std::string& TraceExpression::error() const
+{
+  return d->error;
+}
+
+//##################################################################################################
+const std::string& TraceExpression::name() const
+{
+  return d->name;
+}
+
+//##################################################################################################
+TraceID TraceExpression::traceID() const
+{
+  return d->traceID;
+}
+
+//##################################################################################################
+TraceExpressionUpdate TraceExpression::update(TraceStore& store)
+{
+  TraceExpressionUpdate result;
+  if(!d->error.empty())
+    return result;
+
+  if(d->traceID==invalidTraceID)
+  {
+    d->traceID = store.addTrace(d->name);
+    auto& trace = store.trace(d->traceID);
+    trace.derived = true;
+
+    //The trace of an expression that was removed and added again.
+    if(trace.size())
+    {
+      trace.clear();
+      result.changed = true;
+    }
+  }
+
+  d->resolve(store);
+  auto& dst = store.trace(d->traceID);
+
+  //Take out the samples at or after committedEnd, they are evaluated again.
+  SampleBuffer buffer;
+  size_t first = dst.lowerBound(d->committedEnd);
+  auto taken = dst.samples(first, dst.size()-first, buffer);
+  std::vector<uint32_t> takenIndexes(taken.indexes, taken.indexes+taken.size);
+  std::vector<uint64_t> takenValues(taken.values, taken.values+taken.size);
+  dst.truncate(first);
+
+  //The last sample index can still gain samples, so it is evaluated from a copy of the state.
+  size_t sampleCount = store.sampleCount();
+  uint64_t boundary = std::max(d->committedEnd, uint64_t(sampleCount?sampleCount-1:0));
+  for(;;)
+  {
+    d->evaluate(store, d->committedEnd, boundary, d->committed, dst);
+    d->committedEnd = boundary;
+
+    auto state = d->committed;
+    d->evaluate(store, boundary, std::numeric_limits<uint64_t>::max(), state, dst);
+
+    if(d->requiredBias<=double(d->bias))
+      break;
+
+    //A result was below the bias, grow it to a power of two and store every result again.
+    while(double(d->bias)<d->requiredBias)
+      d->bias = d->bias?d->bias*2:1;
+
+    dst.clear();
+    d->restart();
+    first = 0;
+    takenIndexes.clear();
+    takenValues.clear();
+  }
+
+  //Compare with the samples that were taken out, so that an unchanged trace is not rebuilt.
+  size_t count = dst.size()-first;
+  auto added = dst.samples(first, std::min(count, takenIndexes.size()), buffer);
+  size_t same=0;
+  while(same<added.size && added.indexes[same]==takenIndexes.at(same) && added.values[same]==takenValues.at(same))
+    same++;
+
+  if(!result.changed && (same<added.size || count!=takenIndexes.size()))
+  {
+    result.changed = true;
+    result.firstChanged = first+same;
+  }
+
+  return result;
+}
+
+//##################################################################################################
+uint64_t TraceExpression::bias() const
+{
+  return d->bias;
+}
+
+//##################################################################################################
+void TraceExpression::reset()
+{
+  d->reset();
+}
+
+}
@@ -0,0 +1,254 @@
+#include "general_performance_stats_viewer/TraceGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#  define GPSV_SSE2
+#  include <emmintrin.h>
+#endif
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+static_assert(sizeof(TraceVertex) == 3*sizeof(float), "The vertex kernel writes packed {x, y, trace} vertices.");
+
+//##################################################################################################
+//! Convert a value to float as the SIMD kernel does, so that both paths give identical vertices.
+inline float valueToFloat(uint64_t value)
+{
+  return float(uint32_t(value>>32)) * 4294967296.0f + float(uint32_t(value));
+}
+
+#ifdef GPSV_SSE2
+//##################################################################################################
+//! SSE2 only converts signed integers, so convert the two 16 bit halves and combine them.
+inline __m128 u32ToFloat(__m128i value)
+{
+  __m128 hi = _mm_cvtepi32_ps(_mm_srli_epi32(value, 16));
+  __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(value, _mm_set1_epi32(0xFFFF)));
+  return _mm_add_ps(_mm_mul_ps(hi, _mm_set1_ps(65536.0f)), lo);
+}
+#endif
+}
+
+//##################################################################################################
+float TraceXAxis::vertexX(uint32_t index) const
+{
+  if(!times)
+    return float(index) * float(scale);
+
+  return float(double(times[std::min(size_t(index), timeCount-1)] - origin) * scale);
+}
+
+//##################################################################################################
+double TraceXAxis::originX() const
+{
+  return times?double(origin - first) * scale:0.0;
+}
+
+//##################################################################################################
+double TraceXAxis::sceneToIndex(double x) const
+{
+  if(!times)
+    return x / scale;
+
+  double time = double(first) + x / scale;
+  double back = double(times[timeCount-1]);
+  double front = double(times[0]);
+
+  //Beyond the samples extrapolate with the mean interval.
+  double interval = (timeCount>1 && back>front)?(back-front) / double(timeCount-1):1.0;
+  if(time<=front)
+    return (time-front) / interval;
+  if(time>=back)
+    return double(timeCount-1) + (time-back) / interval;
+
+  size_t p = size_t(std::upper_bound(times, times+timeCount, int64_t(time)) - times);
+  double a = double(times[p-1]);
+  double b = double(times[p]);
+  return double(p-1) + ((b>a)?(time-a) / (b-a):0.0);
+}
+
+//##################################################################################################
+glm::mat4 rebaseMatrix(const glm::mat4& matrix, double originX)
+{
+  glm::mat4 result = matrix;
+  for(int r=0; r<4; r++)
+    result[3][r] = float(double(matrix[3][r]) + double(matrix[0][r])*originX);
+  return result;
+}
+
+//##################################################################################################
+TraceViewSamples traceViewSamples(const Trace& trace, const TraceLOD& lod, double viewFirst, double viewLast, double samplesPerPixel, SampleBuffer& buffer)
+{
+  TraceViewSamples result;
+
+  double width = viewLast - viewFirst;
+  result.cropFirst = std::max(0.0, viewFirst - width);
+  result.cropLast = std::max(0.0, viewLast + width);
+
+  result.level = lod.selectLevel(samplesPerPixel);
+  result.samples = lod.levelSamples(trace, result.level).crop(uint64_t(result.cropFirst), uint64_t(result.cropLast), buffer);
+  return result;
+}
+
+//##################################################################################################
+void buildTraceVerticesScalar(const SampleSpan& samples, float xScale, float yScale, float trace, std::vector<TraceVertex>& vertices)
+{
+  vertices.resize(samples.size);
+  TraceVertex* dst = vertices.data();
+  for(size_t p=0; p<samples.size; p++)
+  {
+    dst[p].position.x = float(samples.indexes[p]) * xScale;
+    dst[p].position.y = valueToFloat(samples.values[p]) * yScale;
+    dst[p].trace = trace;
+  }
+}
+
+//##################################################################################################
+void buildTraceVertices(const SampleSpan& samples, float xScale, float yScale, float trace, std::vector<TraceVertex>& vertices)
+{
+#ifdef GPSV_SSE2
+  vertices.resize(samples.size);
+  float* dst = &vertices.data()->position.x;
+
+  const __m128 xs = _mm_set1_ps(xScale);
+  const __m128 ys = _mm_set1_ps(yScale);
+  const __m128 t  = _mm_set1_ps(trace);
+
+  size_t p=0;
+  for(; p+4<=samples.size; p+=4, dst+=12)
+  {
+    __m128 x = _mm_mul_ps(u32ToFloat(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples.indexes+p))), xs);
+
+    //Split the four 64 bit values into their low and high 32 bits.
+    __m128 v01 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples.values+p)));
+    __m128 v23 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples.values+p+2)));
+    __m128i lo = _mm_castps_si128(_mm_shuffle_ps(v01, v23, _MM_SHUFFLE(2,0,2,0)));
+    __m128i hi = _mm_castps_si128(_mm_shuffle_ps(v01, v23, _MM_SHUFFLE(3,1,3,1)));
+    __m128 v = _mm_add_ps(_mm_mul_ps(u32ToFloat(hi), _mm_set1_ps(4294967296.0f)), u32ToFloat(lo));
+    __m128 y = _mm_mul_ps(v, ys);
+
+    //Interleave into three registers of {x, y, trace} vertices.
+    __m128 xy01 = _mm_unpacklo_ps(x, y);
+    __m128 xy23 = _mm_unpackhi_ps(x, y);
+    __m128 tx1  = _mm_shuffle_ps(t, xy01, _MM_SHUFFLE(2,2,0,0));
+    __m128 y1t  = _mm_shuffle_ps(xy01, t, _MM_SHUFFLE(0,0,3,3));
+    __m128 xy3t = _mm_shuffle_ps(xy23, t, _MM_SHUFFLE(0,0,3,2));
+    __m128 tx3  = _mm_shuffle_ps(t, xy3t, _MM_SHUFFLE(0,0,0,0));
+
+    _mm_storeu_ps(dst+0, _mm_shuffle_ps(xy01, tx1, _MM_SHUFFLE(2,0,1,0)));
+    _mm_storeu_ps(dst+4, _mm_shuffle_ps(y1t, xy23, _MM_SHUFFLE(1,0,2,0)));
+    _mm_storeu_ps(dst+8, _mm_shuffle_ps(tx3, xy3t, _MM_SHUFFLE(2,1,2,0)));
+  }
+
+  for(; p<samples.size; p++)
+  {
+    auto& vertex = vertices[p];
+    vertex.position.x = float(samples.indexes[p]) * xScale;
+    vertex.position.y = valueToFloat(samples.values[p]) * yScale;
+    vertex.trace = trace;
+  }
+#else
+  buildTraceVerticesScalar(samples, xScale, yScale, trace, vertices);
+#endif
+}
+
+//##################################################################################################
+void buildTraceVertices(const SampleSpan& samples, const TraceXAxis& xAxis, float yScale, float trace, std::vector<TraceVertex>& vertices)
+{
+  buildTraceVertices(samples, float(xAxis.scale), yScale, trace, vertices);
+  if(!xAxis.times)
+    return;
+
+  TraceVertex* dst = vertices.data();
+  for(size_t p=0; p<samples.size; p++)
+    dst[p].position.x = xAxis.vertexX(samples.indexes[p]);
+}
+
+//##################################################################################################
+NearestSample findNearestSample(const SampleSpan& samples,
+                                const glm::mat4& matrix,
+                                const glm::vec2& viewport,
+                                const glm::vec2& position,
+                                const TraceXAxis& xAxis,
+                                const TraceYTransform& yTransform,
+                                float radius)
+{
+  NearestSample result;
+  if(samples.size==0 || viewport.x<1.0f || viewport.y<1.0f || xAxis.scale<=0.0)
+    return result;
+
+  glm::mat4 vertexMatrix = rebaseMatrix(matrix, xAxis.originX());
+  auto toScreen = [&](size_t p)
+  {
+    glm::vec4 clip = vertexMatrix * glm::vec4(xAxis.vertexX(samples.indexes[p]), yTransform(valueToFloat(samples.values[p])), 0.0f, 1.0f);
+    return glm::vec2(( clip.x/clip.w+1.0f) * 0.5f * viewport.x,
+                     (-clip.y/clip.w+1.0f) * 0.5f * viewport.y);
+  };
+
+  //The graph is not rotated so the sample index only depends on the screen X coordinate.
+  auto inverse = glm::inverse(matrix);
+  auto toIndex = [&](float x)
+  {
+    glm::vec4 scene = inverse * glm::vec4(x/viewport.x*2.0f-1.0f, 0.0f, 0.0f, 1.0f);
+    return xAxis.sceneToIndex(double(scene.x/scene.w));
+  };
+
+  double a = toIndex(position.x-radius);
+  double b = toIndex(position.x+radius);
+  double first = std::max(0.0, std::min(a, b));
+  double last = std::max(0.0, std::max(a, b));
+
+  const uint32_t* end = samples.indexes+samples.size;
+  const uint32_t* lo = std::lower_bound(samples.indexes, end, uint64_t(std::ceil(first)));
+  const uint32_t* hi = std::upper_bound(lo, end, uint64_t(std::min(last, double(std::numeric_limits<uint32_t>::max()))));
+
+  //Include the samples either side so that lines crossing the cursor are tested.
+  size_t pFirst = size_t(lo-samples.indexes);
+  size_t pLast = size_t(hi-samples.indexes);
+  if(pFirst>0)
+    pFirst--;
+  if(pLast<samples.size)
+    pLast++;
+
+  glm::vec2 previous = toScreen(pFirst);
+  auto test = [&](size_t p, const glm::vec2& screen)
+  {
+    float distance = glm::length(screen-position);
+    if(distance<=radius && distance<result.distance)
+    {
+      result.sample = p;
+      result.distance = distance;
+    }
+  };
+
+  test(pFirst, previous);
+  for(size_t p=pFirst+1; p<pLast; p++)
+  {
+    glm::vec2 current = toScreen(p);
+    test(p, current);
+
+    glm::vec2 line = current-previous;
+    float lengthSquared = glm::dot(line, line);
+    if(lengthSquared>0.0f)
+    {
+      float t = glm::clamp(glm::dot(position-previous, line) / lengthSquared, 0.0f, 1.0f);
+      float distance = glm::length(previous + line*t - position);
+      if(distance<=radius && distance<result.distance)
+      {
+        result.sample = (t<0.5f)?p-1:p;
+        result.distance = distance;
+      }
+    }
+
+    previous = current;
+  }
+
+  return result;
+}
+
+}
@@ -0,0 +1,185 @@
+#include "general_performance_stats_viewer/TraceLOD.h"
+
+#include <algorithm>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+constexpr uint64_t lodBranchFactor = 4;
+constexpr size_t lodMinimumSize = 1024;
+
+//##################################################################################################
+//! Appends the min and max of each bucket of the spans it is given, starting on a bucket boundary.
+struct Decimator_lt
+{
+  uint64_t bucketWidth;
+  Trace& dst;
+
+  bool open{false};
+  uint64_t bucketEnd{0};
+  uint32_t minIndex{0};
+  uint64_t minValue{0};
+  uint32_t maxIndex{0};
+  uint64_t maxValue{0};
+  bool minFirst{true};
+
+  //################################################################################################
+  Decimator_lt(uint64_t bucketWidth_, Trace& dst_):
+    bucketWidth(bucketWidth_),
+    dst(dst_)
+  {
+
+  }
+
+  //################################################################################################
+  void add(const SampleSpan& src)
+  {
+    for(size_t p=0; p<src.size; p++)
+    {
+      uint32_t index = src.indexes[p];
+      uint64_t value = src.values[p];
+
+      if(!open || index>=bucketEnd)
+      {
+        finish();
+        open = true;
+        bucketEnd = (index/bucketWidth + 1) * bucketWidth;
+        minIndex = maxIndex = index;
+        minValue = maxValue = value;
+        minFirst = true;
+        continue;
+      }
+
+      if(value<minValue)
+      {
+        minIndex = index;
+        minValue = value;
+        minFirst = false;
+      }
+
+      if(value>maxValue)
+      {
+        maxIndex = index;
+        maxValue = value;
+        minFirst = true;
+      }
+    }
+  }
+
+  //################################################################################################
+  //! Write the open bucket.
+  void finish()
+  {
+    if(!open)
+      return;
+    open = false;
+
+    if(minFirst)
+    {
+      dst.append(minIndex, minValue);
+      if(maxIndex!=minIndex || maxValue!=minValue)
+        dst.append(maxIndex, maxValue);
+    }
+    else
+    {
+      dst.append(maxIndex, maxValue);
+      dst.append(minIndex, minValue);
+    }
+  }
+};
+}
+
+//##################################################################################################
+void TraceLOD::update(const Trace& trace)
+{
+  if(trace.size()<sourceSize)
+    clear();
+
+  if(trace.size()==sourceSize)
+    return;
+
+  //Levels that are built in one go are not going to grow again soon.
+  bool rebuild = (sourceSize==0);
+
+  //The bucket of the last sample that is unchanged is rebuilt too, after truncate() it can hold
+  //samples that were replaced.
+  SampleBuffer buffer;
+  uint64_t firstChanged = sourceSize?trace.samples(sourceSize-1, 1, buffer).indexes[0]:0;
+  uint64_t bucketWidth = 1;
+
+  size_t l=0;
+  for(; levelSamples(trace, l).size()>lodMinimumSize; l++)
+  {
+    bucketWidth *= lodBranchFactor;
+
+    //A new level has to be built from the start of the level below it.
+    if(l==levels.size())
+    {
+      levels.emplace_back().bucketWidth = bucketWidth;
+      firstChanged = 0;
+    }
+    auto& level = levels.at(l);
+    const auto& src = levelSamples(trace, l);
+
+    //Discard the buckets that the new samples fall into and rebuild them.
+    uint64_t bucketStart = (firstChanged / bucketWidth) * bucketWidth;
+    level.samples.truncate(level.samples.lowerBound(bucketStart));
+
+    size_t from = src.lowerBound(bucketStart);
+    Decimator_lt decimator(bucketWidth, level.samples);
+    src.forEachSpan(from, src.size()-from, buffer, [&](const SampleSpan& span)
+    {
+      decimator.add(span);
+    });
+    decimator.finish();
+
+    firstChanged = bucketStart;
+  }
+
+  //A trace that was truncated can need fewer levels.
+  levels.resize(l);
+
+  if(rebuild)
+    for(auto& level : levels)
+      level.samples.shrinkToFit();
+
+  sourceSize = trace.size();
+}
+
+//##################################################################################################
+void TraceLOD::truncate(size_t size)
+{
+  sourceSize = std::min(sourceSize, size);
+}
+
+//##################################################################################################
+void TraceLOD::clear()
+{
+  levels.clear();
+  sourceSize = 0;
+}
+
+//##################################################################################################
+size_t TraceLOD::levelCount() const
+{
+  return levels.size()+1;
+}
+
+//##################################################################################################
+size_t TraceLOD::selectLevel(double samplesPerPixel) const
+{
+  size_t l=0;
+  while(l<levels.size() && double(levels.at(l).bucketWidth)<=samplesPerPixel)
+    l++;
+  return l;
+}
+
+//##################################################################################################
+const Trace& TraceLOD::levelSamples(const Trace& trace, size_t level) const
+{
+  return (level==0)?trace:levels.at(level-1).samples;
+}
+
+}
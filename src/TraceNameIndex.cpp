@@ -0,0 +1,173 @@
+#include "general_performance_stats_viewer/TraceNameIndex.h"
+
+#include "tp_utils/RefCount.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//##################################################################################################
+char toLower(char c)
+{
+  return (c>='A' && c<='Z')?char(c-'A'+'a'):c;
+}
+
+//##################################################################################################
+uint32_t trigram(const char* c)
+{
+  return uint32_t(uint8_t(c[0])) | (uint32_t(uint8_t(c[1]))<<8) | (uint32_t(uint8_t(c[2]))<<16);
+}
+}
+
+//##################################################################################################
+struct TraceNameIndex::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::TraceNameIndex::Private");
+  TP_NONCOPYABLE(Private);
+
+  //The lower case names packed end to end.
+  std::string names;
+  std::vector<size_t> offsets{0};
+  std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+
+  std::string lastQuery;
+  bool lastValid{false};
+  std::vector<size_t> results;
+  std::vector<size_t> candidates;
+  std::vector<size_t> intersection;
+
+  //################################################################################################
+  Private() = default;
+
+  //################################################################################################
+  std::string_view name(size_t n) const
+  {
+    return std::string_view(names).substr(offsets[n], offsets[n+1]-offsets[n]);
+  }
+
+  //################################################################################################
+  void filter(const std::string& query, const std::vector<size_t>& from)
+  {
+    results.clear();
+    for(auto n : from)
+      if(name(n).find(query) != std::string_view::npos)
+        results.push_back(n);
+  }
+};
+
+//##################################################################################################
+TraceNameIndex::TraceNameIndex():
+  d(new Private())
+{
+
+}
+
+//##################################################################################################
+TraceNameIndex::~TraceNameIndex()
+{
+  delete d;
+}
+
+//##################################################################################################
+void TraceNameIndex::clear()
+{
+  d->names.clear();
+  d->offsets.assign(1, 0);
+  d->postings.clear();
+  d->lastValid = false;
+  d->results.clear();
+}
+
+//##################################################################################################
+void TraceNameIndex::add(std::string_view name)
+{
+  auto n = uint32_t(size());
+  auto first = d->names.size();
+  for(auto c : name)
+    d->names.push_back(toLower(c));
+  d->offsets.push_back(d->names.size());
+
+  //Names are added in order so each posting list stays sorted, repeats within a name are skipped.
+  for(size_t i=first; i+3<=d->names.size(); i++)
+  {
+    auto& posting = d->postings[trigram(d->names.data()+i)];
+    if(posting.empty() || posting.back()!=n)
+      posting.push_back(n);
+  }
+
+  d->lastValid = false;
+}
+
+//##################################################################################################
+size_t TraceNameIndex::size() const
+{
+  return d->offsets.size()-1;
+}
+
+//##################################################################################################
+const std::vector<size_t>& TraceNameIndex::find(std::string_view query)
+{
+  std::string lower(query.size(), ' ');
+  std::transform(query.begin(), query.end(), lower.begin(), toLower);
+
+  if(d->lastValid && lower == d->lastQuery)
+    return d->results;
+
+  //Anything that matches the new query also matched the previous one if it is a substring of it.
+  if(d->lastValid && lower.find(d->lastQuery) != std::string::npos)
+  {
+    d->candidates.swap(d->results);
+    d->filter(lower, d->candidates);
+  }
+  else if(lower.size()<3)
+  {
+    d->candidates.resize(size());
+    for(size_t n=0; n<d->candidates.size(); n++)
+      d->candidates[n] = n;
+    d->filter(lower, d->candidates);
+  }
+  else
+  {
+    std::vector<const std::vector<uint32_t>*> lists;
+    for(size_t i=0; i+3<=lower.size(); i++)
+    {
+      auto p = d->postings.find(trigram(lower.data()+i));
+      if(p == d->postings.end())
+      {
+        lists.clear();
+        break;
+      }
+      lists.push_back(&p->second);
+    }
+
+    d->candidates.clear();
+    if(!lists.empty())
+    {
+      std::sort(lists.begin(), lists.end(), [](auto a, auto b){return a->size()<b->size();});
+      lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+      d->candidates.assign(lists.front()->begin(), lists.front()->end());
+      for(size_t l=1; l<lists.size() && !d->candidates.empty(); l++)
+      {
+        const auto& list = *lists.at(l);
+        d->intersection.clear();
+        std::set_intersection(d->candidates.begin(), d->candidates.end(), list.begin(), list.end(), std::back_inserter(d->intersection));
+        d->candidates.swap(d->intersection);
+      }
+    }
+
+    d->filter(lower, d->candidates);
+  }
+
+  d->lastQuery = lower;
+  d->lastValid = true;
+  return d->results;
+}
+
+}
@@ -0,0 +1,199 @@
+#include "general_performance_stats_viewer/TraceRangeMax.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//The table is built on the blocks of the trace so that whole blocks are never decoded.
+constexpr size_t rangeMaxBlockSize = sampleBlockSize;
+
+//##################################################################################################
+//! A block of a trace decoded on demand, block trace.blockCount() is the tail.
+struct DecodedBlock_lt
+{
+  size_t block{std::numeric_limits<size_t>::max()};
+  size_t count{0};
+  uint32_t indexes[sampleBlockSize];
+  uint64_t values[sampleBlockSize];
+
+  //################################################################################################
+  void load(const Trace& trace, size_t b)
+  {
+    if(b==block)
+      return;
+
+    block = b;
+    if(b<trace.blockCount())
+    {
+      trace.decodeBlock(b, indexes, values);
+      count = sampleBlockSize;
+    }
+    else
+    {
+      count = trace.tailIndexes.size();
+      std::copy(trace.tailIndexes.begin(), trace.tailIndexes.end(), indexes);
+      std::copy(trace.tailValues.begin(), trace.tailValues.end(), values);
+    }
+  }
+};
+
+//##################################################################################################
+//! Decodes the blocks at the ends of a query, each at most once.
+struct QueryBlocks_lt
+{
+  const Trace& trace;
+  DecodedBlock_lt decoded[2];
+  size_t next{0};
+
+  //################################################################################################
+  QueryBlocks_lt(const Trace& trace_):
+    trace(trace_)
+  {
+
+  }
+
+  //################################################################################################
+  const DecodedBlock_lt& load(size_t b)
+  {
+    for(const auto& block : decoded)
+      if(block.block==b)
+        return block;
+
+    auto& block = decoded[next];
+    next = (next+1)%2;
+    block.load(trace, b);
+    return block;
+  }
+
+  //################################################################################################
+  //! The position of the first sample with an index not less than index, or greater if upper.
+  size_t bound(uint64_t index, bool upper)
+  {
+    auto b = trace.findBlock([&](const SampleBlock& block)
+    {
+      return upper?(block.lastIndex<=index):(block.lastIndex<index);
+    });
+
+    const auto& block = load(b);
+    auto end = block.indexes+block.count;
+    auto i = upper?std::upper_bound(block.indexes, end, index):std::lower_bound(block.indexes, end, index);
+    return b*rangeMaxBlockSize + size_t(i-block.indexes);
+  }
+
+  //################################################################################################
+  //! The max of the samples from first to last, whole sealed blocks are not decoded.
+  uint64_t scan(size_t first, size_t last)
+  {
+    uint64_t result=0;
+    while(first<last)
+    {
+      size_t b = first/rangeMaxBlockSize;
+      size_t blockFirst = b*rangeMaxBlockSize;
+      size_t end = std::min(last, blockFirst+rangeMaxBlockSize);
+
+      if(b<trace.blockCount() && first==blockFirst && end==blockFirst+rangeMaxBlockSize)
+        result = std::max(result, trace.block(b).maxValue);
+      else
+      {
+        const auto& block = load(b);
+        result = std::max(result, *std::max_element(block.values+(first-blockFirst), block.values+(end-blockFirst)));
+      }
+      first = end;
+    }
+    return result;
+  }
+};
+}
+
+//##################################################################################################
+void TraceRangeMax::update(const Trace& trace)
+{
+  if(trace.size()<sourceSize)
+    clear();
+
+  if(trace.size()==sourceSize)
+    return;
+
+  size_t blockCount = (trace.size()+rangeMaxBlockSize-1) / rangeMaxBlockSize;
+
+  //The last block may have been partial so it is rebuilt along with any new blocks.
+  size_t firstChanged = sourceSize / rangeMaxBlockSize;
+
+  if(table.empty())
+    table.emplace_back();
+
+  auto& blocks = table.front();
+  blocks.resize(blockCount);
+  QueryBlocks_lt query(trace);
+  for(size_t b=firstChanged; b<blockCount; b++)
+    blocks.at(b) = query.scan(b*rangeMaxBlockSize, std::min(trace.size(), (b+1)*rangeMaxBlockSize));
+
+  for(size_t k=1; (size_t(1)<<k)<=blockCount; k++)
+  {
+    if(k==table.size())
+      table.emplace_back();
+
+    size_t width = size_t(1)<<k;
+    size_t half = width/2;
+    const auto& previous = table.at(k-1);
+    auto& level = table.at(k);
+
+    //Only entries that include a changed block need updating.
+    size_t first = (firstChanged+1>width)?firstChanged+1-width:0;
+    first = std::min(first, level.size());
+
+    level.resize(blockCount-width+1);
+    for(size_t b=first; b<level.size(); b++)
+      level.at(b) = std::max(previous.at(b), previous.at(b+half));
+  }
+
+  sourceSize = trace.size();
+}
+
+//##################################################################################################
+void TraceRangeMax::truncate(size_t size)
+{
+  sourceSize = std::min(sourceSize, size);
+}
+
+//##################################################################################################
+void TraceRangeMax::clear()
+{
+  table.clear();
+  sourceSize = 0;
+}
+
+//##################################################################################################
+uint64_t TraceRangeMax::max(const Trace& trace, uint64_t firstIndex, uint64_t lastIndex) const
+{
+  size_t size = std::min(sourceSize, trace.size());
+  QueryBlocks_lt query(trace);
+
+  size_t first = std::min(size, query.bound(firstIndex, false));
+  size_t last = std::min(size, query.bound(lastIndex, true));
+  if(first>=last)
+    return 0;
+
+  //The whole blocks between the partial blocks at either end.
+  size_t firstBlock = (first+rangeMaxBlockSize-1) / rangeMaxBlockSize;
+  size_t lastBlock = last / rangeMaxBlockSize;
+  if(firstBlock>=lastBlock)
+    return query.scan(first, last);
+
+  size_t count = lastBlock-firstBlock;
+  size_t k=0;
+  while((size_t(2)<<k)<=count)
+    k++;
+
+  const auto& level = table.at(k);
+  uint64_t result = std::max(level.at(firstBlock), level.at(lastBlock-(size_t(1)<<k)));
+  result = std::max(result, query.scan(first, firstBlock*rangeMaxBlockSize));
+  result = std::max(result, query.scan(lastBlock*rangeMaxBlockSize, last));
+  return result;
+}
+
+}
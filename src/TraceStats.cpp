@@ -0,0 +1,251 @@
+#include "general_performance_stats_viewer/TraceStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _MSC_VER
+#  include <intrin.h>
+#endif
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+constexpr int subBucketBits = 6;
+constexpr uint64_t subBucketCount = 1<<subBucketBits;
+constexpr size_t bucketCount = subBucketCount * (64-subBucketBits+1);
+
+//##################################################################################################
+int mostSignificantBit(uint64_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return int(index);
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+//##################################################################################################
+size_t bucketIndex(uint64_t value)
+{
+  if(value<subBucketCount)
+    return size_t(value);
+
+  int msb = mostSignificantBit(value);
+  int shift = msb - subBucketBits;
+  return size_t(subBucketCount*uint64_t(shift+1) + ((value>>shift) - subBucketCount));
+}
+
+//##################################################################################################
+//! The middle of the range of values counted by a bucket.
+double bucketValue(size_t bucket)
+{
+  if(bucket<subBucketCount)
+    return double(bucket);
+
+  int shift = int(bucket/subBucketCount) - 1;
+  uint64_t lower = (subBucketCount + bucket%subBucketCount) << shift;
+  return double(lower) + double((uint64_t(1)<<shift) - 1) / 2.0;
+}
+}
+
+//##################################################################################################
+QuantileSketch::QuantileSketch():
+  m_counts(bucketCount, 0)
+{
+
+}
+
+//##################################################################################################
+void QuantileSketch::add(uint64_t value)
+{
+  m_counts[bucketIndex(value)]++;
+  m_count++;
+  m_min = std::min(m_min, value);
+  m_max = std::max(m_max, value);
+}
+
+//##################################################################################################
+void QuantileSketch::add(const uint64_t* values, size_t count)
+{
+  for(size_t i=0; i<count; i++)
+    m_counts[bucketIndex(values[i])]++;
+
+  if(count)
+  {
+    auto [min, max] = std::minmax_element(values, values+count);
+    m_min = std::min(m_min, *min);
+    m_max = std::max(m_max, *max);
+  }
+
+  m_count += count;
+}
+
+//##################################################################################################
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+  for(size_t b=0; b<bucketCount; b++)
+    m_counts[b] += other.m_counts[b];
+
+  m_count += other.m_count;
+  m_min = std::min(m_min, other.m_min);
+  m_max = std::max(m_max, other.m_max);
+}
+
+//##################################################################################################
+double QuantileSketch::quantile(double q) const
+{
+  if(m_count==0)
+    return 0.0;
+
+  if(q<=0.0)
+    return double(m_min);
+
+  if(q>=1.0)
+    return double(m_max);
+
+  auto rank = uint64_t(q * double(m_count-1));
+  uint64_t seen=0;
+  for(size_t b=0; b<bucketCount; b++)
+  {
+    seen += m_counts[b];
+    if(seen>rank)
+      return std::clamp(bucketValue(b), double(m_min), double(m_max));
+  }
+
+  return double(m_max);
+}
+
+//##################################################################################################
+uint64_t QuantileSketch::count() const
+{
+  return m_count;
+}
+
+//##################################################################################################
+void QuantileSketch::clear()
+{
+  std::fill(m_counts.begin(), m_counts.end(), 0);
+  m_count = 0;
+  m_min = std::numeric_limits<uint64_t>::max();
+  m_max = 0;
+}
+
+namespace
+{
+//##################################################################################################
+//! Accumulates statistics over consecutive spans of samples.
+struct StatsAccumulator_lt
+{
+  size_t count{0};
+  double shift{0.0};
+  double sum[4] = {0.0, 0.0, 0.0, 0.0};
+  double sumSquares[4] = {0.0, 0.0, 0.0, 0.0};
+  QuantileSketch sketch;
+  uint64_t min{std::numeric_limits<uint64_t>::max()};
+  uint64_t max{0};
+  uint32_t firstIndex{0};
+  uint32_t lastIndex{0};
+  uint64_t firstValue{0};
+  uint64_t lastValue{0};
+
+  //################################################################################################
+  void add(const SampleSpan& samples)
+  {
+    if(samples.size==0)
+      return;
+
+    const uint64_t* values = samples.values;
+    size_t n = samples.size;
+
+    //Values are shifted by the first value to reduce cancellation in the variance, and the sums
+    //are split over four independent accumulators so that the loop can be pipelined and vectorized.
+    if(count==0)
+    {
+      shift = double(values[0]);
+      firstIndex = samples.indexes[0];
+      firstValue = values[0];
+    }
+
+    size_t i=0;
+    for(; i+4<=n; i+=4)
+    {
+      for(size_t l=0; l<4; l++)
+      {
+        double v = double(values[i+l]) - shift;
+        sum[l] += v;
+        sumSquares[l] += v*v;
+      }
+    }
+
+    for(; i<n; i++)
+    {
+      double v = double(values[i]) - shift;
+      sum[0] += v;
+      sumSquares[0] += v*v;
+    }
+
+    sketch.add(values, n);
+    auto [spanMin, spanMax] = std::minmax_element(values, values+n);
+    min = std::min(min, *spanMin);
+    max = std::max(max, *spanMax);
+    lastIndex = samples.indexes[n-1];
+    lastValue = values[n-1];
+    count += n;
+  }
+
+  //################################################################################################
+  TraceStats stats() const
+  {
+    TraceStats stats;
+    stats.count = count;
+    if(count==0)
+      return stats;
+
+    double s  = (sum[0]+sum[1]) + (sum[2]+sum[3]);
+    double s2 = (sumSquares[0]+sumSquares[1]) + (sumSquares[2]+sumSquares[3]);
+    double n = double(count);
+
+    stats.mean = shift + s/n;
+    stats.total = stats.mean * n;
+    stats.stddev = std::sqrt(std::max(0.0, s2/n - (s/n)*(s/n)));
+
+    stats.p50 = sketch.quantile(0.50);
+    stats.p95 = sketch.quantile(0.95);
+    stats.p99 = sketch.quantile(0.99);
+
+    stats.min = min;
+    stats.max = max;
+
+    if(count>1 && lastIndex>firstIndex)
+      stats.rate = (double(lastValue) - double(firstValue)) / double(lastIndex-firstIndex);
+
+    return stats;
+  }
+};
+}
+
+//##################################################################################################
+TraceStats computeTraceStats(const SampleSpan& samples)
+{
+  StatsAccumulator_lt accumulator;
+  accumulator.add(samples);
+  return accumulator.stats();
+}
+
+//##################################################################################################
+TraceStats computeTraceStats(const Trace& trace, size_t first, size_t count)
+{
+  StatsAccumulator_lt accumulator;
+  SampleBuffer buffer;
+  trace.forEachSpan(first, count, buffer, [&](const SampleSpan& span)
+  {
+    accumulator.add(span);
+  });
+  return accumulator.stats();
+}
+
+}
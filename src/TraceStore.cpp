@@ -0,0 +1,547 @@
+#include "general_performance_stats_viewer/TraceStore.h"
+#include "general_performance_stats_viewer/SampleTimes.h"
+
+#include "tp_utils/RefCount.h"
+
+#include <algorithm>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+void Trace::setPaged(PagedSamples&& samples)
+{
+  blocks.clear();
+  encoded.clear();
+  paged = std::move(samples);
+}
+
+//##################################################################################################
+void Trace::unpage()
+{
+  if(!paged.file)
+    return;
+
+  //The blocks sealed since paging follow the paged blocks, in place of their padding.
+  size_t offset = paged.blockCount?paged.encodedSize-sampleCodecPadding:0;
+  auto sealedBlocks = std::move(blocks);
+  auto sealedEncoded = std::move(encoded);
+
+  blocks.clear();
+  blocks.reserve(paged.blockCount+sealedBlocks.size());
+  blocks.assign(paged.blocks, paged.blocks+paged.blockCount);
+  for(auto block : sealedBlocks)
+  {
+    block.offset += offset;
+    blocks.push_back(block);
+  }
+
+  encoded.clear();
+  if(!blocks.empty())
+  {
+    encoded.reserve(offset+std::max(sealedEncoded.size(), sampleCodecPadding));
+    encoded.assign(paged.encoded, paged.encoded+offset);
+    if(sealedEncoded.empty())
+      encoded.resize(offset+sampleCodecPadding, 0);
+    else
+      encoded.insert(encoded.end(), sealedEncoded.begin(), sealedEncoded.end());
+  }
+
+  paged = PagedSamples();
+}
+
+//##################################################################################################
+void Trace::append(const SampleSpan& samples, uint32_t indexOffset)
+{
+  for(size_t p=0; p<samples.size; p++)
+    append(samples.indexes[p]+indexOffset, samples.values[p]);
+}
+
+//##################################################################################################
+void Trace::assign(const SampleSpan& samples)
+{
+  clear();
+
+  //Encode into scratch first so that the columns in the arena are allocated once.
+  size_t blockCount = samples.size/sampleBlockSize;
+  std::vector<uint8_t> scratch(blockCount*maxEncodedBlockSize(sampleBlockSize));
+  size_t encodedSize=0;
+
+  blocks.resize(blockCount);
+  for(size_t b=0; b<blockCount; b++)
+  {
+    auto block = samples.subspan(b*sampleBlockSize, sampleBlockSize);
+    auto& dst = blocks.at(b);
+    dst.offset = encodedSize;
+    dst.maxValue = *std::max_element(block.values, block.values+block.size);
+    dst.firstIndex = block.indexes[0];
+    dst.lastIndex = block.indexes[block.size-1];
+    maxValue = std::max(maxValue, dst.maxValue);
+    encodedSize += encodeSampleBlock(block, scratch.data()+encodedSize);
+  }
+
+  if(blockCount)
+  {
+    encoded.reserve(encodedSize+sampleCodecPadding);
+    encoded.assign(scratch.data(), scratch.data()+encodedSize);
+    encoded.resize(encodedSize+sampleCodecPadding, 0);
+  }
+
+  auto tail = samples.subspan(blockCount*sampleBlockSize, samples.size-blockCount*sampleBlockSize);
+  tailIndexes.assign(tail.indexes, tail.indexes+tail.size);
+  tailValues.assign(tail.values, tail.values+tail.size);
+  for(auto value : tailValues)
+    maxValue = std::max(maxValue, value);
+}
+
+//##################################################################################################
+void Trace::assign(const Trace& other)
+{
+  maxValue = other.maxValue;
+  blocks.assign(other.blocks.begin(), other.blocks.end());
+  encoded.assign(other.encoded.begin(), other.encoded.end());
+  tailIndexes.assign(other.tailIndexes.begin(), other.tailIndexes.end());
+  tailValues.assign(other.tailValues.begin(), other.tailValues.end());
+  paged = other.paged;
+}
+
+//##################################################################################################
+void Trace::truncate(size_t size)
+{
+  size_t sealed = blockCount()*sampleBlockSize;
+  if(size>=sealed)
+  {
+    tailIndexes.resize(std::min(size-sealed, tailIndexes.size()));
+    tailValues.resize(tailIndexes.size());
+    return;
+  }
+
+  //Unseal the block that size falls in, it becomes the tail.
+  size_t b = size/sampleBlockSize;
+  if(b<pagedBlockCount())
+    unpage();
+
+  uint32_t indexes[sampleBlockSize];
+  uint64_t values[sampleBlockSize];
+  decodeBlock(b, indexes, values);
+
+  //The index of the block in blocks, after any paged blocks.
+  size_t m = b-pagedBlockCount();
+  size_t offset = blocks.at(m).offset;
+  blocks.resize(m);
+  encoded.resize(m?offset+sampleCodecPadding:0);
+  std::fill(encoded.begin()+std::ptrdiff_t(std::min(offset, encoded.size())), encoded.end(), 0);
+
+  size_t count = size-b*sampleBlockSize;
+  tailIndexes.assign(indexes, indexes+count);
+  tailValues.assign(values, values+count);
+}
+
+//##################################################################################################
+void Trace::clear()
+{
+  maxValue = 1;
+  paged = PagedSamples();
+  blocks.clear();
+  encoded.clear();
+  tailIndexes.clear();
+  tailValues.clear();
+}
+
+//##################################################################################################
+void Trace::shrinkToFit()
+{
+  blocks.shrink_to_fit();
+  encoded.shrink_to_fit();
+  tailIndexes.shrink_to_fit();
+  tailValues.shrink_to_fit();
+}
+
+//##################################################################################################
+void Trace::decodeBlock(size_t b, uint32_t* indexes, uint64_t* values) const
+{
+  size_t pagedCount = pagedBlockCount();
+  if(b>=pagedCount)
+  {
+    const uint8_t* data = encoded.data();
+    decodeSampleBlock(data+blocks[b-pagedCount].offset, data+encoded.size(), sampleBlockSize, indexes, values);
+    return;
+  }
+
+  const uint8_t* data = paged.encoded;
+  size_t offset = paged.blocks[b].offset;
+  size_t next = (b+1<paged.blockCount)?paged.blocks[b+1].offset:paged.encodedSize;
+  paged.file->touch(data+offset, std::max(offset, next)-offset);
+  decodeSampleBlock(data+offset, data+paged.encodedSize, sampleBlockSize, indexes, values);
+}
+
+//##################################################################################################
+SampleSpan Trace::samples(size_t first, size_t count, SampleBuffer& buffer) const
+{
+  size_t sealed = blockCount()*sampleBlockSize;
+  if(first>=sealed)
+    return {tailIndexes.data()+(first-sealed), tailValues.data()+(first-sealed), count};
+
+  buffer.indexes.resize(count);
+  buffer.values.resize(count);
+  uint32_t* indexes = buffer.indexes.data();
+  uint64_t* values = buffer.values.data();
+
+  uint32_t blockIndexes[sampleBlockSize];
+  uint64_t blockValues[sampleBlockSize];
+
+  size_t p=first;
+  size_t end=first+count;
+  for(; p<end && p<sealed;)
+  {
+    size_t b = p/sampleBlockSize;
+    size_t from = p-b*sampleBlockSize;
+    size_t n = std::min(sampleBlockSize-from, end-p);
+
+    //Whole blocks are decoded straight into the buffer.
+    if(n==sampleBlockSize)
+      decodeBlock(b, indexes+(p-first), values+(p-first));
+    else
+    {
+      decodeBlock(b, blockIndexes, blockValues);
+      std::copy(blockIndexes+from, blockIndexes+from+n, indexes+(p-first));
+      std::copy(blockValues+from, blockValues+from+n, values+(p-first));
+    }
+    p += n;
+  }
+
+  if(p<end)
+  {
+    std::copy(tailIndexes.data()+(p-sealed), tailIndexes.data()+(end-sealed), indexes+(p-first));
+    std::copy(tailValues.data()+(p-sealed), tailValues.data()+(end-sealed), values+(p-first));
+  }
+
+  return {indexes, values, count};
+}
+
+//##################################################################################################
+size_t Trace::lowerBound(uint64_t index) const
+{
+  size_t count = blockCount();
+  auto b = findBlock([&](const SampleBlock& block){return block.lastIndex<index;});
+  if(b==count)
+    return b*sampleBlockSize + size_t(std::lower_bound(tailIndexes.begin(), tailIndexes.end(), index) - tailIndexes.begin());
+
+  if(block(b).firstIndex>=index)
+    return b*sampleBlockSize;
+
+  uint32_t indexes[sampleBlockSize];
+  uint64_t values[sampleBlockSize];
+  decodeBlock(b, indexes, values);
+  return b*sampleBlockSize + size_t(std::lower_bound(indexes, indexes+sampleBlockSize, index) - indexes);
+}
+
+//##################################################################################################
+size_t Trace::upperBound(uint64_t index) const
+{
+  size_t count = blockCount();
+  auto b = findBlock([&](const SampleBlock& block){return block.lastIndex<=index;});
+  if(b==count)
+    return b*sampleBlockSize + size_t(std::upper_bound(tailIndexes.begin(), tailIndexes.end(), index) - tailIndexes.begin());
+
+  if(block(b).firstIndex>index)
+    return b*sampleBlockSize;
+
+  uint32_t indexes[sampleBlockSize];
+  uint64_t values[sampleBlockSize];
+  decodeBlock(b, indexes, values);
+  return b*sampleBlockSize + size_t(std::upper_bound(indexes, indexes+sampleBlockSize, index) - indexes);
+}
+
+//##################################################################################################
+SampleSpan Trace::crop(uint64_t firstIndex, uint64_t lastIndex, SampleBuffer& buffer) const
+{
+  //Decode the blocks that can hold the range once and then search the decoded samples.
+  size_t count = blockCount();
+  auto firstBlock = findBlock([&](const SampleBlock& block){return block.lastIndex<firstIndex;});
+  auto lastBlock = findBlock([&](const SampleBlock& block){return block.firstIndex<=lastIndex;});
+
+  size_t first = firstBlock*sampleBlockSize;
+  size_t last = (lastBlock==count)?size():lastBlock*sampleBlockSize;
+  auto span = samples(first, last-first, buffer);
+
+  auto end = span.indexes+span.size;
+  auto lo = std::lower_bound(span.indexes, end, firstIndex);
+  auto hi = std::upper_bound(lo, end, lastIndex);
+  return span.subspan(size_t(lo-span.indexes), size_t(hi-lo));
+}
+
+//##################################################################################################
+void Trace::sealTail()
+{
+  uint8_t block[maxEncodedBlockSize(sampleBlockSize)];
+  size_t size = encodeSampleBlock({tailIndexes.data(), tailValues.data(), sampleBlockSize}, block);
+
+  //The padding at the end of encoded is overwritten by the new block.
+  size_t offset = encoded.empty()?0:encoded.size()-sampleCodecPadding;
+  encoded.resize(offset+size+sampleCodecPadding);
+  std::copy(block, block+size, encoded.data()+offset);
+  std::fill(encoded.end()-std::ptrdiff_t(sampleCodecPadding), encoded.end(), 0);
+
+  auto& dst = blocks.emplace_back();
+  dst.offset = offset;
+  dst.maxValue = *std::max_element(tailValues.begin(), tailValues.end());
+  dst.firstIndex = tailIndexes.front();
+  dst.lastIndex = tailIndexes.back();
+
+  tailIndexes.clear();
+  tailValues.clear();
+}
+
+//##################################################################################################
+struct TraceStore::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::TraceStore::Private");
+  TP_NONCOPYABLE(Private);
+
+  //Everything allocated from the arena, destroyed before the arena is released.
+  struct Contents
+  {
+    //A deque so that traces don't move as more are added.
+    std::pmr::deque<Trace> traces;
+    std::pmr::unordered_map<std::string_view, TraceID> traceIDs;
+
+    //##############################################################################################
+    Contents(std::pmr::memory_resource* resource):
+      traces(resource),
+      traceIDs(resource)
+    {
+
+    }
+  };
+
+  Arena arena;
+  std::optional<Contents> contents;
+
+  size_t sampleCount{0};
+  std::vector<int64_t> sampleTimes;
+  uint64_t maxValue{1};
+  size_t pointCount{0};
+  std::shared_ptr<PagedFile> pagedFile;
+
+  //################################################################################################
+  Private()
+  {
+    contents.emplace(&arena);
+  }
+};
+
+//##################################################################################################
+TraceStore::TraceStore():
+  d(new Private())
+{
+
+}
+
+//##################################################################################################
+TraceStore::~TraceStore()
+{
+  delete d;
+}
+
+//##################################################################################################
+TraceID TraceStore::addTrace(std::string_view name)
+{
+  auto& contents = *d->contents;
+  if(auto i = contents.traceIDs.find(name); i != contents.traceIDs.end())
+    return i->second;
+
+  auto traceID = TraceID(contents.traces.size());
+  std::string_view interned = d->arena.copyString(name);
+  contents.traces.emplace_back(&d->arena).name = interned;
+  contents.traceIDs.emplace(interned, traceID);
+  return traceID;
+}
+
+//##################################################################################################
+TraceID TraceStore::findTrace(std::string_view name) const
+{
+  const auto& traceIDs = d->contents->traceIDs;
+  auto i = traceIDs.find(name);
+  return (i != traceIDs.end())?i->second:invalidTraceID;
+}
+
+//##################################################################################################
+size_t TraceStore::traceCount() const
+{
+  return d->contents->traces.size();
+}
+
+//##################################################################################################
+const Trace& TraceStore::trace(TraceID traceID) const
+{
+  return d->contents->traces[traceID];
+}
+
+//##################################################################################################
+Trace& TraceStore::trace(TraceID traceID)
+{
+  return d->contents->traces[traceID];
+}
+
+//##################################################################################################
+void TraceStore::appendSample(TraceID traceID, uint32_t index, uint64_t value)
+{
+  d->contents->traces[traceID].append(index, value);
+
+  if(value>d->maxValue)
+    d->maxValue = value;
+
+  d->pointCount++;
+}
+
+//##################################################################################################
+void TraceStore::appendStore(const TraceStore& other, std::vector<TraceID>& changedTraces)
+{
+  //The first sample of other is the last sample of this store, its time is kept from this store.
+  auto& times = d->sampleTimes;
+  const auto& otherTimes = other.d->sampleTimes;
+  if(times.empty())
+  {
+    if(d->sampleCount==0 && d->pointCount==0)
+      times = otherTimes;
+  }
+  else if(otherTimes.empty())
+    times.resize(times.size()+other.d->sampleCount, times.back());
+  else
+  {
+    int64_t wrap = sampleTimeWrap(times.back(), otherTimes.front());
+    times.reserve(times.size()+otherTimes.size()-1);
+    for(size_t i=1; i<otherTimes.size(); i++)
+      times.push_back(std::max(times.back(), otherTimes.at(i)+wrap));
+  }
+
+  auto offset = uint32_t(d->sampleCount);
+  SampleBuffer buffer;
+  for(const auto& src : other.d->contents->traces)
+  {
+    if(src.size()==0)
+      continue;
+
+    auto traceID = addTrace(src.name);
+    auto& dst = d->contents->traces[traceID];
+    dst.append(src.samples(buffer), offset);
+
+    d->maxValue = std::max(d->maxValue, src.maxValue);
+    d->pointCount += src.size();
+    changedTraces.push_back(traceID);
+  }
+
+  d->sampleCount += other.d->sampleCount;
+}
+
+//##################################################################################################
+void TraceStore::mergeStore(const TraceStore& other, std::vector<TraceID>& changedTraces)
+{
+  if(other.d->sampleCount>d->sampleCount || (d->sampleCount==0 && d->pointCount==0))
+  {
+    d->sampleCount = other.d->sampleCount;
+    d->sampleTimes = other.d->sampleTimes;
+  }
+
+  for(const auto& src : other.d->contents->traces)
+  {
+    if(src.size()==0)
+      continue;
+
+    auto traceID = addTrace(src.name);
+    d->contents->traces[traceID].assign(src);
+
+    d->maxValue = std::max(d->maxValue, src.maxValue);
+    d->pointCount += src.size();
+    changedTraces.push_back(traceID);
+  }
+}
+
+//##################################################################################################
+size_t TraceStore::sampleCount() const
+{
+  return d->sampleCount;
+}
+
+//##################################################################################################
+void TraceStore::setSampleCount(size_t sampleCount)
+{
+  d->sampleCount = sampleCount;
+}
+
+//##################################################################################################
+const std::vector<int64_t>& TraceStore::sampleTimes() const
+{
+  return d->sampleTimes;
+}
+
+//##################################################################################################
+void TraceStore::setSampleTimes(std::vector<int64_t>&& sampleTimes)
+{
+  d->sampleTimes = std::move(sampleTimes);
+}
+
+//##################################################################################################
+uint64_t TraceStore::maxValue() const
+{
+  return d->maxValue;
+}
+
+//##################################################################################################
+size_t TraceStore::pointCount() const
+{
+  return d->pointCount;
+}
+
+//##################################################################################################
+void TraceStore::updateTotals()
+{
+  d->maxValue = 1;
+  d->pointCount = 0;
+  for(const auto& trace : d->contents->traces)
+  {
+    if(trace.derived)
+      continue;
+
+    d->pointCount += trace.size();
+    if(trace.maxValue>d->maxValue)
+      d->maxValue = trace.maxValue;
+  }
+}
+
+//##################################################################################################
+ArenaStats TraceStore::memoryStats() const
+{
+  return d->arena.stats();
+}
+
+//##################################################################################################
+void TraceStore::setPagedFile(const std::shared_ptr<PagedFile>& pagedFile)
+{
+  d->pagedFile = pagedFile;
+}
+
+//##################################################################################################
+const std::shared_ptr<PagedFile>& TraceStore::pagedFile() const
+{
+  return d->pagedFile;
+}
+
+//##################################################################################################
+void TraceStore::clear()
+{
+  d->contents.reset();
+  d->arena.release();
+  d->contents.emplace(&d->arena);
+  d->sampleCount = 0;
+  d->sampleTimes.clear();
+  d->maxValue = 1;
+  d->pointCount = 0;
+  d->pagedFile.reset();
+}
+
+}
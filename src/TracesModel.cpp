@@ -0,0 +1,164 @@
+#include "general_performance_stats_viewer/TracesModel.h"
+
+#include "tp_utils/RefCount.h"
+
+#include <QBrush>
+
+#include <algorithm>
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+struct TracesModel::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::TracesModel::Private");
+  TP_NONCOPYABLE(Private);
+
+  TracesModel* q;
+
+  std::vector<QString> names;
+  std::vector<QBrush> brushes;
+  std::vector<bool> checked;
+
+  std::vector<size_t> changedRows;
+
+  //################################################################################################
+  Private(TracesModel* q_):
+    q(q_)
+  {
+
+  }
+
+  //################################################################################################
+  void emitChanged()
+  {
+    if(changedRows.empty())
+      return;
+
+    emit q->dataChanged(q->index(int(changedRows.front())), q->index(int(changedRows.back())), {Qt::CheckStateRole});
+    emit q->checkedChanged(changedRows);
+  }
+};
+
+//##################################################################################################
+TracesModel::TracesModel(QObject* parent):
+  QAbstractListModel(parent),
+  d(new Private(this))
+{
+
+}
+
+//##################################################################################################
+TracesModel::~TracesModel()
+{
+  delete d;
+}
+
+//##################################################################################################
+void TracesModel::setRows(std::vector<QString>&& names, std::vector<QColor>&& colors, std::vector<bool>&& checked)
+{
+  beginResetModel();
+  d->names = std::move(names);
+  d->checked = std::move(checked);
+  d->brushes.clear();
+  d->brushes.reserve(colors.size());
+  for(const auto& color : colors)
+    d->brushes.emplace_back(color);
+  endResetModel();
+}
+
+//##################################################################################################
+size_t TracesModel::size() const
+{
+  return d->names.size();
+}
+
+//##################################################################################################
+const QString& TracesModel::name(size_t row) const
+{
+  return d->names.at(row);
+}
+
+//##################################################################################################
+bool TracesModel::checked(size_t row) const
+{
+  return d->checked.at(row);
+}
+
+//##################################################################################################
+void TracesModel::setChecked(const std::vector<size_t>& rows, bool checked)
+{
+  d->changedRows.clear();
+  for(auto row : rows)
+  {
+    if(row<d->checked.size() && d->checked[row]!=checked)
+    {
+      d->checked[row] = checked;
+      d->changedRows.push_back(row);
+    }
+  }
+
+  std::sort(d->changedRows.begin(), d->changedRows.end());
+  d->emitChanged();
+}
+
+//##################################################################################################
+void TracesModel::setChecked(const std::vector<bool>& checked)
+{
+  d->changedRows.clear();
+  size_t count = std::min(checked.size(), d->checked.size());
+  for(size_t row=0; row<count; row++)
+  {
+    if(d->checked[row]!=checked[row])
+    {
+      d->checked[row] = checked[row];
+      d->changedRows.push_back(row);
+    }
+  }
+
+  d->emitChanged();
+}
+
+//##################################################################################################
+int TracesModel::rowCount(const QModelIndex& parent) const
+{
+  return parent.isValid()?0:int(d->names.size());
+}
+
+//##################################################################################################
+QVariant TracesModel::data(const QModelIndex& index, int role) const
+{
+  auto row = size_t(index.row());
+  if(!index.isValid() || row>=d->names.size())
+    return QVariant();
+
+  switch(role)
+  {
+  case Qt::DisplayRole:    return d->names[row];
+  case Qt::BackgroundRole: return d->brushes[row];
+  case Qt::CheckStateRole: return d->checked[row]?Qt::Checked:Qt::Unchecked;
+  default:                 return QVariant();
+  }
+}
+
+//##################################################################################################
+bool TracesModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+  if(!index.isValid() || role!=Qt::CheckStateRole)
+    return false;
+
+  setChecked(std::vector<size_t>{size_t(index.row())}, value.toInt() == Qt::Checked);
+  return true;
+}
+
+//##################################################################################################
+Qt::ItemFlags TracesModel::flags(const QModelIndex& index) const
+{
+  if(!index.isValid())
+    return Qt::NoItemFlags;
+
+  return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable | Qt::ItemNeverHasChildren;
+}
+
+}
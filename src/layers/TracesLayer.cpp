@@ -0,0 +1,692 @@
+#include "general_performance_stats_viewer/layers/TracesLayer.h"
+#include "general_performance_stats_viewer/SelfProfile.h"
+
+#include "tp_maps/Map.h"
+#include "tp_maps/Controller.h"
+#include "tp_maps/RenderInfo.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+namespace general_performance_stats_viewer
+{
+
+namespace
+{
+//The trace table is a 2D texture with two texels per trace, color followed by parameters. The
+//shader is given the row length so that it reads the table as updateTable() lays it out.
+constexpr int tracesPerTableRow = 1024;
+constexpr int tableWidth = tracesPerTableRow*2;
+
+//Vertices are culled against the view a chunk at a time.
+constexpr size_t chunkSize = 256;
+
+#if defined(TP_GLES3) || defined(TP_EMSCRIPTEN)
+constexpr const char* shaderHeader = "#version 300 es\nprecision highp float;\nprecision highp int;\n";
+#else
+constexpr const char* shaderHeader = "#version 330\n";
+#endif
+
+//##################################################################################################
+std::string vertexShaderSource()
+{
+  return std::string(shaderHeader) +
+    "layout(location = 0) in vec2 inPosition;\n"
+    "layout(location = 1) in float inTrace;\n"
+    "uniform mat4 matrix;\n"
+    "uniform sampler2D traceTable;\n"
+    "uniform float pointSize;\n"
+    "uniform int logScale;\n"
+    "const int tracesPerTableRow = " + std::to_string(tracesPerTableRow) + ";\n"
+    "out vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "  int trace = int(inTrace);\n"
+    "  ivec2 t = ivec2((trace % tracesPerTableRow)*2, trace / tracesPerTableRow);\n"
+    "  color = texelFetch(traceTable, t, 0);\n"
+    "  vec4 params = texelFetch(traceTable, t+ivec2(1, 0), 0);\n"
+    "  float value = inPosition.y*params.z - params.w;\n"
+    "  float y = (logScale == 1)?sign(value)*log(1.0+abs(value)):value;\n"
+    "  gl_Position = matrix * vec4(inPosition.x, y*params.x+params.y, 0.0, 1.0);\n"
+    "  gl_PointSize = pointSize;\n"
+    "}\n";
+}
+
+//##################################################################################################
+std::string fragmentShaderSource()
+{
+  return std::string(shaderHeader) +
+    "in vec4 color;\n"
+    "uniform int drawPoints;\n"
+    "out vec4 fragColor;\n"
+    "void main()\n"
+    "{\n"
+    "  if(drawPoints == 1)\n"
+    "  {\n"
+    "    vec2 d = gl_PointCoord - vec2(0.5);\n"
+    "    if(dot(d, d) > 0.25)\n"
+    "      discard;\n"
+    "  }\n"
+    "  fragColor = color;\n"
+    "}\n";
+}
+
+//##################################################################################################
+GLuint compileShader(GLenum type, const char* src)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &src, nullptr);
+  glCompileShader(shader);
+
+  GLint status=0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if(!status)
+  {
+    std::string log(1024, '\0');
+    glGetShaderInfoLog(shader, GLsizei(log.size()), nullptr, log.data());
+    tpWarning() << "TracesLayer shader compile error: " << log.c_str();
+  }
+
+  return shader;
+}
+
+//##################################################################################################
+struct TraceSlot_lt
+{
+  size_t offset{0};
+  size_t capacity{0};
+  size_t count{0};
+  glm::vec4 color{1.0f};
+  float scale{1.0f};
+  float yOffset{0.0f};
+  float valueScale{1.0f};
+  float valueBias{0.0f};
+  bool visible{true};
+
+  //The X of the first vertex of each chunk, vertices are in order of increasing X.
+  std::vector<float> chunkX;
+
+  //Position of this trace in the index buffers.
+  size_t lineFirst{0};
+  size_t lineCount{0};
+  size_t pointFirst{0};
+  size_t pointCount{0};
+};
+}
+
+//##################################################################################################
+struct TracesLayer::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::TracesLayer::Private");
+  TP_NONCOPYABLE(Private);
+
+  TracesLayer* q;
+
+  std::vector<TraceSlot_lt> slots;
+  std::vector<size_t> drawOrder;
+  float pointSize{5.0f};
+  bool logScale{false};
+  double xOrigin{0.0};
+
+  //CPU copies of the GPU buffers.
+  std::vector<TraceVertex> vertices;
+  size_t wastedVertices{0};
+  std::vector<uint32_t> lineIndexes;
+  std::vector<uint32_t> pointIndexes;
+  std::vector<glm::vec4> table;
+
+  //The ranges of the index buffers drawn this frame, one per trace that is on screen.
+  std::vector<GLsizei> lineCounts;
+  std::vector<const void*> lineOffsets;
+  std::vector<GLsizei> pointCounts;
+  std::vector<const void*> pointOffsets;
+
+  //What needs to be sent to the GPU on the next render.
+  bool bufferResized{true};
+  size_t dirtyFirst{0};
+  size_t dirtyLast{0};
+  bool indexesDirty{true};
+  bool tableDirty{true};
+
+  //GL objects, created on first render.
+  bool glReady{false};
+  GLuint program{0};
+  GLuint vao{0};
+  GLuint vertexBuffer{0};
+  GLuint lineIndexBuffer{0};
+  GLuint pointIndexBuffer{0};
+  GLuint tableTexture{0};
+  size_t vertexBufferSize{0};
+
+  //The start of the last frame, the time between frames is only profiled while redrawing steadily.
+  std::chrono::steady_clock::time_point lastFrame;
+
+  GLint matrixLocation{-1};
+  GLint traceTableLocation{-1};
+  GLint pointSizeLocation{-1};
+  GLint logScaleLocation{-1};
+  GLint drawPointsLocation{-1};
+
+  //################################################################################################
+  Private(TracesLayer* q_):
+    q(q_)
+  {
+
+  }
+
+  //################################################################################################
+  void markDirty(size_t first, size_t last)
+  {
+    if(dirtyFirst==dirtyLast)
+    {
+      dirtyFirst = first;
+      dirtyLast = last;
+    }
+    else
+    {
+      dirtyFirst = std::min(dirtyFirst, first);
+      dirtyLast = std::max(dirtyLast, last);
+    }
+  }
+
+  //################################################################################################
+  //! Repack the slots when too much of the vertex buffer is taken by abandoned slots.
+  void compact()
+  {
+    std::vector<TraceVertex> packed;
+    size_t size=0;
+    for(const auto& slot : slots)
+      size += slot.capacity;
+    packed.resize(size);
+
+    size_t offset=0;
+    for(auto& slot : slots)
+    {
+      std::copy_n(vertices.data()+slot.offset, slot.count, packed.data()+offset);
+      slot.offset = offset;
+      offset += slot.capacity;
+    }
+
+    vertices.swap(packed);
+    wastedVertices = 0;
+    bufferResized = true;
+    indexesDirty = true;
+  }
+
+  //################################################################################################
+  void updateIndexes()
+  {
+    lineIndexes.clear();
+    pointIndexes.clear();
+
+    for(auto t : drawOrder)
+    {
+      auto& slot = slots.at(t);
+      slot.lineFirst  = lineIndexes.size();
+      slot.pointFirst = pointIndexes.size();
+
+      if(slot.visible)
+      {
+        auto offset = uint32_t(slot.offset);
+        for(size_t i=1; i<slot.count; i++)
+        {
+          lineIndexes.push_back(offset+uint32_t(i-1));
+          lineIndexes.push_back(offset+uint32_t(i));
+        }
+
+        for(size_t i=0; i<slot.count; i++)
+          pointIndexes.push_back(offset+uint32_t(i));
+      }
+
+      slot.lineCount  = lineIndexes.size()  - slot.lineFirst;
+      slot.pointCount = pointIndexes.size() - slot.pointFirst;
+    }
+
+    indexesDirty = false;
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lineIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(lineIndexes.size()*sizeof(uint32_t)), lineIndexes.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pointIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(pointIndexes.size()*sizeof(uint32_t)), pointIndexes.data(), GL_DYNAMIC_DRAW);
+    selfProfile().addCount("upload bytes", (lineIndexes.size()+pointIndexes.size())*sizeof(uint32_t));
+  }
+
+  //################################################################################################
+  //! The vertices of a trace that can be seen between xMin and xMax.
+  /*!
+  Whole chunks are drawn, from the chunk that starts at or before xMin through to the first vertex
+  after xMax, so that the lines that cross the edges of the view are included.
+  */
+  std::pair<size_t, size_t> visibleVertices(const TraceSlot_lt& slot, float xMin, float xMax) const
+  {
+    const auto& chunkX = slot.chunkX;
+    auto first = std::upper_bound(chunkX.begin(), chunkX.end(), xMin);
+    size_t firstChunk = (first==chunkX.begin())?0:size_t(first-chunkX.begin())-1;
+    size_t lastChunk = size_t(std::upper_bound(first, chunkX.end(), xMax) - chunkX.begin());
+    return {firstChunk*chunkSize, std::min(slot.count, lastChunk*chunkSize+1)};
+  }
+
+  //################################################################################################
+  //! Collect the index ranges of the vertices of each trace that are in view, in draw order.
+  size_t cull(float xMin, float xMax)
+  {
+    lineCounts.clear();
+    lineOffsets.clear();
+    pointCounts.clear();
+    pointOffsets.clear();
+
+    size_t vertexCount=0;
+    for(auto t : drawOrder)
+    {
+      const auto& slot = slots.at(t);
+      if(slot.pointCount==0)
+        continue;
+
+      auto [first, last] = visibleVertices(slot, xMin, xMax);
+      if(last-first>1)
+      {
+        lineCounts.push_back(GLsizei(2*(last-first-1)));
+        lineOffsets.push_back(reinterpret_cast<const void*>((slot.lineFirst+2*first)*sizeof(uint32_t)));
+        vertexCount += 2*(last-first-1);
+      }
+
+      pointCounts.push_back(GLsizei(last-first));
+      pointOffsets.push_back(reinterpret_cast<const void*>((slot.pointFirst+first)*sizeof(uint32_t)));
+      vertexCount += last-first;
+    }
+    return vertexCount;
+  }
+
+  //################################################################################################
+  void updateTable()
+  {
+    int rows = std::max(1, int((slots.size()+tracesPerTableRow-1) / tracesPerTableRow));
+    table.assign(size_t(tableWidth*rows), glm::vec4(0.0f));
+    for(size_t t=0; t<slots.size(); t++)
+    {
+      const auto& slot = slots.at(t);
+      table.at(t*2)   = slot.color;
+      table.at(t*2+1) = glm::vec4(slot.scale, slot.yOffset, slot.valueScale, slot.valueBias);
+    }
+
+    tableDirty = false;
+
+    glBindTexture(GL_TEXTURE_2D, tableTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, tableWidth, rows, 0, GL_RGBA, GL_FLOAT, table.data());
+    selfProfile().addCount("upload bytes", table.size()*sizeof(glm::vec4));
+  }
+
+  //################################################################################################
+  void updateVertices()
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+    if(bufferResized || vertexBufferSize<vertices.size())
+    {
+      glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(vertices.size()*sizeof(TraceVertex)), vertices.data(), GL_DYNAMIC_DRAW);
+      selfProfile().addCount("upload bytes", vertices.size()*sizeof(TraceVertex));
+      vertexBufferSize = vertices.size();
+      bufferResized = false;
+    }
+    else if(dirtyFirst!=dirtyLast)
+    {
+      glBufferSubData(GL_ARRAY_BUFFER,
+                      GLintptr(dirtyFirst*sizeof(TraceVertex)),
+                      GLsizeiptr((dirtyLast-dirtyFirst)*sizeof(TraceVertex)),
+                      vertices.data()+dirtyFirst);
+      selfProfile().addCount("upload bytes", (dirtyLast-dirtyFirst)*sizeof(TraceVertex));
+    }
+
+    dirtyFirst = 0;
+    dirtyLast = 0;
+  }
+
+  //################################################################################################
+  void initGL()
+  {
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource().c_str());
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource().c_str());
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    matrixLocation       = glGetUniformLocation(program, "matrix");
+    traceTableLocation   = glGetUniformLocation(program, "traceTable");
+    pointSizeLocation    = glGetUniformLocation(program, "pointSize");
+    logScaleLocation     = glGetUniformLocation(program, "logScale");
+    drawPointsLocation   = glGetUniformLocation(program, "drawPoints");
+
+    glGenBuffers(1, &vertexBuffer);
+    glGenBuffers(1, &lineIndexBuffer);
+    glGenBuffers(1, &pointIndexBuffer);
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TraceVertex), reinterpret_cast<void*>(offsetof(TraceVertex, position)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(TraceVertex), reinterpret_cast<void*>(offsetof(TraceVertex, trace)));
+    glBindVertexArray(0);
+
+    glGenTextures(1, &tableTexture);
+    glBindTexture(GL_TEXTURE_2D, tableTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glReady = true;
+    bufferResized = true;
+    indexesDirty = true;
+    tableDirty = true;
+  }
+
+  //################################################################################################
+  void deleteGL()
+  {
+    if(!glReady)
+      return;
+
+    glDeleteProgram(program);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteBuffers(1, &lineIndexBuffer);
+    glDeleteBuffers(1, &pointIndexBuffer);
+    glDeleteTextures(1, &tableTexture);
+    vertexBufferSize = 0;
+    glReady = false;
+  }
+};
+
+//##################################################################################################
+TracesLayer::TracesLayer():
+  d(new Private(this))
+{
+  setDefaultRenderPass(tp_maps::RenderPass::GUI);
+}
+
+//##################################################################################################
+TracesLayer::~TracesLayer()
+{
+  if(map())
+    map()->makeCurrent();
+  d->deleteGL();
+  delete d;
+}
+
+//##################################################################################################
+void TracesLayer::setTraceCount(size_t traceCount)
+{
+  d->slots.clear();
+  d->slots.resize(traceCount);
+  d->drawOrder.resize(traceCount);
+  for(size_t t=0; t<traceCount; t++)
+    d->drawOrder.at(t) = t;
+
+  d->vertices.clear();
+  d->wastedVertices = 0;
+  d->bufferResized = true;
+  d->indexesDirty = true;
+  d->tableDirty = true;
+  update();
+}
+
+//##################################################################################################
+size_t TracesLayer::traceCount() const
+{
+  return d->slots.size();
+}
+
+//##################################################################################################
+void TracesLayer::setTraceVertices(size_t trace, const std::vector<TraceVertex>& vertices)
+{
+  auto& slot = d->slots.at(trace);
+
+  if(vertices.size()>slot.capacity)
+  {
+    //Move the trace to the end of the buffer with room to grow.
+    d->wastedVertices += slot.capacity;
+    auto capacity = std::max(size_t(64), vertices.size() + vertices.size()/2);
+    auto offset = d->vertices.size();
+    d->vertices.resize(offset+capacity);
+    std::copy_n(d->vertices.data()+slot.offset, slot.count, d->vertices.data()+offset);
+    slot.offset = offset;
+    slot.capacity = capacity;
+    d->bufferResized = true;
+
+    if(d->wastedVertices>d->vertices.size()/2)
+      d->compact();
+  }
+
+  //Only upload the part of the trace that has changed, when appending this is just the new samples.
+  auto dst = d->vertices.data()+slot.offset;
+  size_t first=0;
+  size_t common = std::min(slot.count, vertices.size());
+  while(first<common && std::memcmp(dst+first, vertices.data()+first, sizeof(TraceVertex))==0)
+    first++;
+
+  if(first<vertices.size())
+  {
+    std::copy(vertices.begin()+std::ptrdiff_t(first), vertices.end(), dst+first);
+    d->markDirty(slot.offset+first, slot.offset+vertices.size());
+  }
+
+  if(slot.count!=vertices.size())
+  {
+    slot.count = vertices.size();
+    d->indexesDirty = true;
+  }
+
+  slot.chunkX.resize((vertices.size()+chunkSize-1)/chunkSize);
+  for(size_t c=0; c<slot.chunkX.size(); c++)
+    slot.chunkX.at(c) = vertices.at(c*chunkSize).position.x;
+
+  update();
+}
+
+//##################################################################################################
+void TracesLayer::setTraceColor(size_t trace, const glm::vec4& color)
+{
+  d->slots.at(trace).color = color;
+  d->tableDirty = true;
+  update();
+}
+
+//##################################################################################################
+void TracesLayer::setTraceYTransform(size_t trace, float scale, float offset)
+{
+  auto& slot = d->slots.at(trace);
+  if(slot.scale == scale && slot.yOffset == offset)
+    return;
+
+  slot.scale = scale;
+  slot.yOffset = offset;
+  d->tableDirty = true;
+  update();
+}
+
+//##################################################################################################
+void TracesLayer::setTraceValueScale(size_t trace, float valueScale, float valueBias)
+{
+  auto& slot = d->slots.at(trace);
+  if(slot.valueScale == valueScale && slot.valueBias == valueBias)
+    return;
+
+  slot.valueScale = valueScale;
+  slot.valueBias = valueBias;
+  d->tableDirty = true;
+  update();
+}
+
+//##################################################################################################
+TraceYTransform TracesLayer::traceYTransform(size_t trace) const
+{
+  const auto& slot = d->slots.at(trace);
+  TraceYTransform transform;
+  transform.valueScale = slot.valueScale;
+  transform.valueBias = slot.valueBias;
+  transform.scale = slot.scale;
+  transform.offset = slot.yOffset;
+  transform.log = d->logScale;
+  return transform;
+}
+
+//##################################################################################################
+void TracesLayer::setLogScale(bool logScale)
+{
+  if(d->logScale == logScale)
+    return;
+
+  d->logScale = logScale;
+  update();
+}
+
+//##################################################################################################
+bool TracesLayer::logScale() const
+{
+  return d->logScale;
+}
+
+//##################################################################################################
+void TracesLayer::setTraceVisible(size_t trace, bool visible)
+{
+  auto& slot = d->slots.at(trace);
+  if(slot.visible == visible)
+    return;
+
+  slot.visible = visible;
+  d->indexesDirty = true;
+  update();
+}
+
+//##################################################################################################
+bool TracesLayer::traceVisible(size_t trace) const
+{
+  return d->slots.at(trace).visible;
+}
+
+//##################################################################################################
+void TracesLayer::bringToFront(size_t trace)
+{
+  auto i = std::find(d->drawOrder.begin(), d->drawOrder.end(), trace);
+  if(i == d->drawOrder.end())
+    return;
+
+  d->drawOrder.erase(i);
+  d->drawOrder.push_back(trace);
+  d->indexesDirty = true;
+  update();
+}
+
+//##################################################################################################
+const std::vector<size_t>& TracesLayer::drawOrder() const
+{
+  return d->drawOrder;
+}
+
+//##################################################################################################
+void TracesLayer::setXOrigin(double xOrigin)
+{
+  d->xOrigin = xOrigin;
+  update();
+}
+
+//##################################################################################################
+void TracesLayer::setPointSize(float pointSize)
+{
+  d->pointSize = pointSize;
+  update();
+}
+
+//##################################################################################################
+void TracesLayer::render(tp_maps::RenderInfo& renderInfo)
+{
+  if(renderInfo.pass != defaultRenderPass())
+    return;
+
+  ProfileTimer timer("render");
+  auto now = std::chrono::steady_clock::now();
+  if(now-d->lastFrame < std::chrono::seconds(1))
+    selfProfile().addTime("frame", now-d->lastFrame);
+  d->lastFrame = now;
+
+  if(!d->glReady)
+    d->initGL();
+
+  if(d->bufferResized || d->dirtyFirst!=d->dirtyLast)
+    d->updateVertices();
+
+  if(d->indexesDirty)
+    d->updateIndexes();
+
+  if(d->tableDirty)
+    d->updateTable();
+
+  if(d->lineIndexes.empty() && d->pointIndexes.empty())
+    return;
+
+  glm::mat4 matrix = rebaseMatrix(map()->controller()->matrices(tp_maps::defaultSID()).vp, d->xOrigin);
+
+  glUseProgram(d->program);
+  glUniformMatrix4fv(d->matrixLocation, 1, GL_FALSE, &matrix[0][0]);
+  glUniform1f(d->pointSizeLocation, d->pointSize);
+  glUniform1i(d->logScaleLocation, d->logScale?1:0);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, d->tableTexture);
+  glUniform1i(d->traceTableLocation, 0);
+
+#ifdef GL_PROGRAM_POINT_SIZE
+  glEnable(GL_PROGRAM_POINT_SIZE);
+#endif
+
+  glBindVertexArray(d->vao);
+
+  //The X range of the view in vertex coordinates, widened by a point so that edge points are drawn.
+  glm::mat4 inverse = glm::inverse(matrix);
+  float margin = 1.0f + 2.0f*d->pointSize/std::max(1.0f, float(map()->width()));
+  glm::vec4 left  = inverse * glm::vec4(-margin, 0.0f, 0.0f, 1.0f);
+  glm::vec4 right = inverse * glm::vec4( margin, 0.0f, 0.0f, 1.0f);
+  float xMin = std::min(left.x/left.w, right.x/right.w);
+  float xMax = std::max(left.x/left.w, right.x/right.w);
+
+  auto drawRanges = [&](GLenum mode, GLuint indexBuffer, const std::vector<GLsizei>& counts, const std::vector<const void*>& offsets)
+  {
+    if(counts.empty())
+      return;
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glUniform1i(d->drawPointsLocation, (mode==GL_POINTS)?1:0);
+#if defined(TP_GLES3) || defined(TP_EMSCRIPTEN)
+    for(size_t i=0; i<counts.size(); i++)
+      glDrawElements(mode, counts.at(i), GL_UNSIGNED_INT, offsets.at(i));
+#else
+    glMultiDrawElements(mode, counts.data(), GL_UNSIGNED_INT, offsets.data(), GLsizei(counts.size()));
+#endif
+  };
+
+  size_t vertexCount = d->cull(xMin, xMax);
+  drawRanges(GL_LINES, d->lineIndexBuffer, d->lineCounts, d->lineOffsets);
+  drawRanges(GL_POINTS, d->pointIndexBuffer, d->pointCounts, d->pointOffsets);
+  selfProfile().addCount("vertices drawn", vertexCount);
+
+  glBindVertexArray(0);
+}
+
+//##################################################################################################
+void TracesLayer::invalidateBuffers()
+{
+  d->glReady = false;
+  d->vertexBufferSize = 0;
+  Layer::invalidateBuffers();
+}
+
+}
@@ -0,0 +1,62 @@
+#include "general_performance_stats_viewer/layers/ViewChangedLayer.h"
+
+#include "tp_maps/Map.h"
+#include "tp_maps/Controller.h"
+#include "tp_maps/RenderInfo.h"
+
+namespace general_performance_stats_viewer
+{
+
+//##################################################################################################
+struct ViewChangedLayer::Private
+{
+  TP_REF_COUNT_OBJECTS("general_performance_stats_viewer::ViewChangedLayer::Private");
+  TP_NONCOPYABLE(Private);
+
+  std::function<void(const glm::mat4&)> viewChanged;
+
+  glm::mat4 matrix{0.0f};
+  int width{0};
+  int height{0};
+
+  //################################################################################################
+  Private(const std::function<void(const glm::mat4&)>& viewChanged_):
+    viewChanged(viewChanged_)
+  {
+
+  }
+};
+
+//##################################################################################################
+ViewChangedLayer::ViewChangedLayer(const std::function<void(const glm::mat4&)>& viewChanged):
+  d(new Private(viewChanged))
+{
+  setDefaultRenderPass(tp_maps::RenderPass::GUI);
+}
+
+//##################################################################################################
+ViewChangedLayer::~ViewChangedLayer()
+{
+  delete d;
+}
+
+//##################################################################################################
+void ViewChangedLayer::render(tp_maps::RenderInfo& renderInfo)
+{
+  if(renderInfo.pass != defaultRenderPass())
+    return;
+
+  glm::mat4 matrix = map()->controller()->matrices(tp_maps::defaultSID()).vp;
+  int width = map()->width();
+  int height = map()->height();
+
+  if(matrix == d->matrix && width == d->width && height == d->height)
+    return;
+
+  d->matrix = matrix;
+  d->width = width;
+  d->height = height;
+  d->viewChanged(matrix);
+}
+
+}
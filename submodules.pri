@@ -20,3 +20,5 @@ SUBDIRS += tp_qt_maps
 SUBDIRS += tp_qt_maps_widget
 
 SUBDIRS += general_performance_stats_viewer
+SUBDIRS += general_performance_stats_viewer/benchmark
+SUBDIRS += general_performance_stats_viewer/checks
@@ -11,3 +11,79 @@ SOURCES += src/MainWindow.cpp
 
 HEADERS += inc/general_performance_stats_viewer/MapWidget.h
 SOURCES += src/MapWidget.cpp
+
+HEADERS += inc/general_performance_stats_viewer/MappedFile.h
+SOURCES += src/MappedFile.cpp
+
+HEADERS += inc/general_performance_stats_viewer/PagedFile.h
+SOURCES += src/PagedFile.cpp
+
+HEADERS += inc/general_performance_stats_viewer/StatsParser.h
+SOURCES += src/StatsParser.cpp
+
+HEADERS += inc/general_performance_stats_viewer/SampleTimes.h
+SOURCES += src/SampleTimes.cpp
+
+HEADERS += inc/general_performance_stats_viewer/Parallel.h
+SOURCES += src/Parallel.cpp
+
+HEADERS += inc/general_performance_stats_viewer/SelfProfile.h
+SOURCES += src/SelfProfile.cpp
+
+HEADERS += inc/general_performance_stats_viewer/StatsLoader.h
+SOURCES += src/StatsLoader.cpp
+
+HEADERS += inc/general_performance_stats_viewer/StatsMerge.h
+SOURCES += src/StatsMerge.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TraceDiff.h
+SOURCES += src/TraceDiff.cpp
+
+HEADERS += inc/general_performance_stats_viewer/Arena.h
+SOURCES += src/Arena.cpp
+
+HEADERS += inc/general_performance_stats_viewer/SampleCodec.h
+SOURCES += src/SampleCodec.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TraceStore.h
+SOURCES += src/TraceStore.cpp
+
+HEADERS += inc/general_performance_stats_viewer/StatsFollower.h
+SOURCES += src/StatsFollower.cpp
+
+HEADERS += inc/general_performance_stats_viewer/StatsLoadJob.h
+SOURCES += src/StatsLoadJob.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TraceLOD.h
+SOURCES += src/TraceLOD.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TraceCache.h
+SOURCES += src/TraceCache.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TraceGeometry.h
+SOURCES += src/TraceGeometry.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TraceStats.h
+SOURCES += src/TraceStats.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TraceRangeMax.h
+SOURCES += src/TraceRangeMax.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TraceExpression.h
+SOURCES += src/TraceExpression.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TraceNameIndex.h
+SOURCES += src/TraceNameIndex.cpp
+
+HEADERS += inc/general_performance_stats_viewer/TracesModel.h
+SOURCES += src/TracesModel.cpp
+
+HEADERS += inc/general_performance_stats_viewer/controllers/GraphController.h
+SOURCES += src/controllers/GraphController.cpp
+
+HEADERS += inc/general_performance_stats_viewer/layers/ViewChangedLayer.h
+SOURCES += src/layers/ViewChangedLayer.cpp
+
+HEADERS += inc/general_performance_stats_viewer/layers/TracesLayer.h
+SOURCES += src/layers/TracesLayer.cpp
+